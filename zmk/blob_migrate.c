@@ -0,0 +1,336 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <openssl/crypto.h>
+
+#include "test_blob.h"
+#include "blob_store.h"
+#include "blob_migrate.h"
+
+#define MIGRATE_CHUNK			64
+
+struct migrate_shared {
+	const struct blob_migrate_config *config;
+	char **paths;
+	size_t count;
+	uint8_t *done;			/* journaled by a previous run */
+	size_t next;
+	pthread_mutex_t lock;		/* journal and stats */
+	FILE *journal;
+	uint8_t old_id[BLOB_MKEY_ID_BYTES];
+	uint8_t new_id[BLOB_MKEY_ID_BYTES];
+	struct blob_migrate_stats *stats;
+};
+
+struct migrate_worker {
+	pthread_t thread;
+	struct migrate_shared *sh;
+	uint8_t *in, *plain, *out;
+	struct test_blob_ctx old_ctx, new_ctx;
+	uint8_t modifier[BLOB_KEY_MODIFIER_BYTES];
+	int ctx_valid;
+	struct blob_migrate_stats stats;
+};
+
+static int migrate_ctx(struct migrate_worker *w, const uint8_t *modifier)
+{
+	const struct blob_migrate_config *config = w->sh->config;
+
+	if (w->ctx_valid && !memcmp(w->modifier, modifier, BLOB_KEY_MODIFIER_BYTES))
+		return 0;
+	if (w->ctx_valid) {
+		test_blob_free(&w->old_ctx);
+		test_blob_free(&w->new_ctx);
+		w->ctx_valid = 0;
+	}
+	if (test_blob_init(&w->old_ctx, config->old_key, modifier))
+		return -1;
+	if (test_blob_init(&w->new_ctx, config->new_key, modifier)) {
+		test_blob_free(&w->old_ctx);
+		return -1;
+	}
+	memcpy(w->modifier, modifier, BLOB_KEY_MODIFIER_BYTES);
+	w->ctx_valid = 1;
+
+	return 0;
+}
+
+/* Returns 0 if the file was re-wrapped, 1 if it already was, -1 on failure */
+static int migrate_one(struct migrate_worker *w, const char *path)
+{
+	const struct blob_migrate_config *config = w->sh->config;
+	const struct blob_file_header *hdr;
+	struct blob_file_header *new_hdr;
+	char tmp[4096];
+	ssize_t len;
+	int fd, ret = -1;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		config->report(path, "cannot open");
+		return -1;
+	}
+	len = pread(fd, w->in, config->max_file, 0);
+	close(fd);
+
+	hdr = blob_file_parse(w->in, len < 0 ? 0 : len);
+	if (!hdr) {
+		config->report(path, "malformed blob file");
+		return -1;
+	}
+	if (!memcmp(hdr->mkey_id, w->sh->new_id, BLOB_MKEY_ID_BYTES))
+		return 1;
+	if (memcmp(hdr->mkey_id, w->sh->old_id, BLOB_MKEY_ID_BYTES)) {
+		config->report(path, "not encapsulated under the old master key");
+		return -1;
+	}
+	if (migrate_ctx(w, hdr->key_modifier))
+		return -1;
+
+	new_hdr = (struct blob_file_header *)w->out;
+	*new_hdr = *hdr;
+	new_hdr->mkey_source = config->new_source;
+	memcpy(new_hdr->mkey_id, w->sh->new_id, BLOB_MKEY_ID_BYTES);
+
+	if (test_blob_decap(&w->old_ctx, (const uint8_t *)(hdr + 1), hdr->payload_len + BLOB_OVERHEAD, w->plain)) {
+		config->report(path, "blob does not decapsulate with the old master key");
+		return -1;
+	}
+	if (test_blob_encap(&w->new_ctx, w->plain, hdr->payload_len, (uint8_t *)(new_hdr + 1)))
+		goto out;
+
+	snprintf(tmp, sizeof(tmp), "%s.migrating", path);
+	fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0)
+		goto out;
+	//The new blob is on disk before it replaces the only copy of the old one
+	int written = write(fd, w->out, len) == len && !fsync(fd);
+
+	if (close(fd))
+		written = 0;
+	if (written && !rename(tmp, path)) {
+		w->stats.bytes += len;
+		ret = 0;
+	} else {
+		config->report(path, "cannot replace the blob file");
+		unlink(tmp);
+	}
+
+out:
+	OPENSSL_cleanse(w->plain, hdr->payload_len);
+	return ret;
+}
+
+/* fsync the directory holding path, unless it is the one synced last (paths are sorted) */
+static void migrate_sync_dir(const char *path, char *last, size_t size)
+{
+	const char *slash = strrchr(path, '/');
+	char dir[4096];
+	int fd;
+
+	if (!slash)
+		snprintf(dir, sizeof(dir), ".");
+	else
+		snprintf(dir, sizeof(dir), "%.*s", slash == path ? 1 : (int)(slash - path), path);
+	if (!strcmp(dir, last))
+		return;
+	snprintf(last, size, "%s", dir);
+
+	fd = open(dir, O_RDONLY | O_DIRECTORY);
+	if (fd >= 0) {
+		fsync(fd);
+		close(fd);
+	}
+}
+
+static void migrate_journal(struct migrate_shared *sh, const size_t *index, unsigned int n)
+{
+	char last[4096] = "";
+	unsigned int i;
+
+	/* The renames must be on disk before the journal says so; the file data already is */
+	for (i = 0; i < n; i++)
+		migrate_sync_dir(sh->paths[index[i]], last, sizeof(last));
+
+	pthread_mutex_lock(&sh->lock);
+	for (i = 0; i < n; i++)
+		fprintf(sh->journal, "%s\n", sh->paths[index[i]]);
+	fflush(sh->journal);
+	fdatasync(fileno(sh->journal));
+	pthread_mutex_unlock(&sh->lock);
+}
+
+static void *migrate_worker(void *arg)
+{
+	struct migrate_worker *w = arg;
+	struct migrate_shared *sh = w->sh;
+	size_t index[MIGRATE_CHUNK], i, end;
+	unsigned int n;
+
+	while ((i = __atomic_fetch_add(&sh->next, MIGRATE_CHUNK, __ATOMIC_RELAXED)) < sh->count) {
+		end = i + MIGRATE_CHUNK < sh->count ? i + MIGRATE_CHUNK : sh->count;
+		for (n = 0; i < end; i++) {
+			if (sh->done[i]) {
+				w->stats.resumed++;
+				continue;
+			}
+			switch (migrate_one(w, sh->paths[i])) {
+			case 0:
+				w->stats.migrated++;
+				index[n++] = i;
+				break;
+			case 1:
+				w->stats.already++;
+				index[n++] = i;
+				break;
+			default:
+				w->stats.failed++;
+				break;
+			}
+		}
+		if (n)
+			migrate_journal(sh, index, n);
+	}
+
+	if (w->ctx_valid) {
+		test_blob_free(&w->old_ctx);
+		test_blob_free(&w->new_ctx);
+	}
+	return NULL;
+}
+
+static int cmp_path(const void *a, const void *b)
+{
+	return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/* Marks the files listed in the journal; paths must be sorted */
+static void migrate_resume(struct migrate_shared *sh, FILE *journal)
+{
+	char line[4096], *key = line, **found;
+
+	rewind(journal);
+	while (fgets(line, sizeof(line), journal)) {
+		line[strcspn(line, "\n")] = 0;
+		found = bsearch(&key, sh->paths, sh->count, sizeof(*sh->paths), cmp_path);
+		if (found)
+			sh->done[found - sh->paths] = 1;
+	}
+}
+
+static double migrate_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Re-wraps every blob file in paths (sorted in place) from config->old_key to config->new_key.
+ * Returns 0 if every file is now under the new key, -1 otherwise.
+ */
+int blob_migrate(const struct blob_migrate_config *config, char **paths, size_t count, struct blob_migrate_stats *stats)
+{
+	struct migrate_worker *workers;
+	struct migrate_shared sh;
+	unsigned int i, threads = config->threads ? config->threads : 1;
+	double t0 = migrate_now();
+	int ret = -1;
+
+	memset(stats, 0, sizeof(*stats));
+	memset(&sh, 0, sizeof(sh));
+	qsort(paths, count, sizeof(*paths), cmp_path);
+	sh.config = config;
+	sh.paths = paths;
+	sh.count = count;
+	sh.stats = stats;
+	blob_mkey_id(config->old_key, sh.old_id);
+	blob_mkey_id(config->new_key, sh.new_id);
+	pthread_mutex_init(&sh.lock, NULL);
+
+	sh.done = calloc(count ? count : 1, 1);
+	workers = calloc(threads, sizeof(*workers));
+	sh.journal = fopen(config->journal, "a+");
+	if (!sh.done || !workers || !sh.journal)
+		goto out;
+	migrate_resume(&sh, sh.journal);
+
+	for (i = 0; i < threads; i++) {
+		workers[i].sh = &sh;
+		workers[i].in = malloc(config->max_file);
+		workers[i].plain = malloc(config->max_file);
+		workers[i].out = malloc(config->max_file);
+		if (!workers[i].in || !workers[i].plain || !workers[i].out)
+			break;
+		if (pthread_create(&workers[i].thread, NULL, migrate_worker, &workers[i]))
+			break;
+	}
+	threads = i;
+
+	for (i = 0; i < threads; i++) {
+		pthread_join(workers[i].thread, NULL);
+		stats->migrated += workers[i].stats.migrated;
+		stats->already += workers[i].stats.already;
+		stats->resumed += workers[i].stats.resumed;
+		stats->failed += workers[i].stats.failed;
+		stats->bytes += workers[i].stats.bytes;
+	}
+	if (threads && !stats->failed && stats->migrated + stats->already + stats->resumed == count)
+		ret = 0;
+
+out:
+	if (workers)
+		for (i = 0; i < (config->threads ? config->threads : 1); i++) {
+			free(workers[i].in);
+			free(workers[i].plain);
+			free(workers[i].out);
+		}
+	if (sh.journal)
+		fclose(sh.journal);
+	free(workers);
+	free(sh.done);
+	pthread_mutex_destroy(&sh.lock);
+	stats->seconds = migrate_now() - t0;
+
+	return ret;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	Blob re-encryption for a master key change
+
+	When B.9 moves a board from one master key to another (for example OTPMK to ZMK), every blob
+	encapsulated under the old effective key has to be re-wrapped. blob_migrate() decapsulates
+	each blob file with the old key and encapsulates the payload again under the new key, keeping
+	the key modifier, on a pool of worker threads. The files hold test blobs (test_blob.h), so
+	this migrates this tool's own blob store, not blobs a board's CAAM made.
+
+	Memory is bounded: each worker owns one input and one output buffer of max_file bytes and
+	files are handed out in small chunks. Each file is replaced atomically (temporary file and
+	rename). After a chunk the file system is synced and the chunk's file names are appended to
+	the progress journal, so an interrupted run resumes where it stopped. A file whose header
+	already carries the new key id (replaced, but not yet journaled when the run stopped) is
+	recognised and skipped.
+*/
+
+#ifndef BLOB_MIGRATE_H
+#define BLOB_MIGRATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct blob_migrate_config {
+	const uint8_t *old_key;
+	const uint8_t *new_key;
+	int new_source;			/* enum snvs_mkey_source written in the new headers */
+	unsigned int threads;
+	size_t max_file;
+	const char *journal;
+	void (*report)(const char *path, const char *reason);
+};
+
+struct blob_migrate_stats {
+	size_t migrated;
+	size_t already;			/* found already under the new key */
+	size_t resumed;			/* skipped thanks to the journal */
+	size_t failed;
+	size_t bytes;
+	double seconds;
+};
+
+int blob_migrate(const struct blob_migrate_config *config, char **paths, size_t count, struct blob_migrate_stats *stats);
+
+#endif /* BLOB_MIGRATE_H */
@@ -0,0 +1,391 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+#include <openssl/sha.h>
+
+#include "snvs_mkey.h"
+#include "blob_store.h"
+
+void blob_mkey_id(const uint8_t *master_key, uint8_t *id)
+{
+	uint8_t digest[SHA256_DIGEST_LENGTH];
+
+	SHA256(master_key, MASTER_KEY_BYTES, digest);
+	memcpy(id, digest, BLOB_MKEY_ID_BYTES);
+}
+
+/* Encapsulates payload with master_key and writes header + blob to path */
+int blob_file_write(const char *path, int source, const uint8_t *master_key, const uint8_t *key_modifier,
+	const uint8_t *payload, size_t len)
+{
+	struct test_blob_ctx ctx;
+	struct blob_file_header *hdr;
+	size_t size = BLOB_FILE_SIZE(len);
+	int fd, ret = -1;
+
+	uint8_t *buf = malloc(size);
+	if (!buf || test_blob_init(&ctx, master_key, key_modifier)) {
+		free(buf);
+		return -1;
+	}
+
+	hdr = (struct blob_file_header *)buf;
+	memset(hdr, 0, sizeof(*hdr));
+	hdr->magic = BLOB_FILE_MAGIC;
+	hdr->version = BLOB_FILE_VERSION;
+	hdr->mkey_source = source;
+	hdr->payload_len = len;
+	blob_mkey_id(master_key, hdr->mkey_id);
+	memcpy(hdr->key_modifier, key_modifier, BLOB_KEY_MODIFIER_BYTES);
+
+	if (!test_blob_encap(&ctx, payload, len, buf + sizeof(*hdr))) {
+		fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+		if (fd >= 0) {
+			if (write(fd, buf, size) == (ssize_t)size)
+				ret = 0;
+			if (close(fd))
+				ret = -1;
+		}
+	}
+
+	test_blob_free(&ctx);
+	free(buf);
+	return ret;
+}
+
+/* Returns the header inside buf if buf holds one complete, well formed blob file */
+const struct blob_file_header *blob_file_parse(const uint8_t *buf, size_t len)
+{
+	const struct blob_file_header *hdr = (const struct blob_file_header *)buf;
+
+	if (len < sizeof(*hdr) || hdr->magic != BLOB_FILE_MAGIC || hdr->version != BLOB_FILE_VERSION ||
+	    hdr->payload_len > BLOB_MAX_PAYLOAD || len != BLOB_FILE_SIZE(hdr->payload_len))
+		return NULL;
+
+	return hdr;
+}
+
+struct blob_checker {
+	const struct blob_scan_config *config;
+	struct blob_scan_stats *stats;
+	uint8_t mkey_id[BLOB_MKEY_ID_BYTES];
+	struct test_blob_ctx ctx;
+	uint8_t modifier[BLOB_KEY_MODIFIER_BYTES];
+	int ctx_valid;
+	uint8_t *scratch;
+	uint8_t *plain;			/* pread() buffer, apart from the registered ones */
+};
+
+static void blob_check(struct blob_checker *c, const char *path, const uint8_t *buf, ssize_t len)
+{
+	const struct blob_scan_config *config = c->config;
+	const struct blob_file_header *hdr;
+
+	c->stats->files++;
+	if (len < 0) {
+		c->stats->corrupt++;
+		config->report(path, strerror(-len));
+		return;
+	}
+	c->stats->bytes += len;
+
+	/* Reads ask for one byte more than max_file, so only a longer file fills the buffer */
+	if ((size_t)len > config->max_file) {
+		c->stats->corrupt++;
+		config->report(path, "larger than the scan buffer");
+		return;
+	}
+	hdr = blob_file_parse(buf, len);
+	if (!hdr) {
+		c->stats->corrupt++;
+		config->report(path, "malformed blob file");
+		return;
+	}
+
+	if (hdr->mkey_source != config->source) {
+		c->stats->mismatched++;
+		config->report(path, "encapsulated under a different master key selection");
+		return;
+	}
+	if (!config->master_key)
+		return;
+	if (memcmp(hdr->mkey_id, c->mkey_id, BLOB_MKEY_ID_BYTES)) {
+		c->stats->mismatched++;
+		config->report(path, "encapsulated under a different master key value");
+		return;
+	}
+
+	/* Blobs sharing a key modifier reuse the derived key encryption key */
+	if (!c->ctx_valid || memcmp(c->modifier, hdr->key_modifier, BLOB_KEY_MODIFIER_BYTES)) {
+		if (c->ctx_valid)
+			test_blob_free(&c->ctx);
+		c->ctx_valid = !test_blob_init(&c->ctx, config->master_key, hdr->key_modifier);
+		memcpy(c->modifier, hdr->key_modifier, BLOB_KEY_MODIFIER_BYTES);
+	}
+	if (!c->ctx_valid || test_blob_decap(&c->ctx, (const uint8_t *)(hdr + 1), hdr->payload_len + BLOB_OVERHEAD, c->scratch)) {
+		c->stats->corrupt++;
+		config->report(path, "blob does not decapsulate (MAC mismatch)");
+		return;
+	}
+	c->stats->decapsulated++;
+}
+
+struct uring {
+	int fd;
+	unsigned int *sq_head, *sq_tail, *sq_mask, *sq_array;
+	unsigned int *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *sq_ring, *cq_ring;
+	size_t sq_ring_len, cq_ring_len, sqes_len;
+};
+
+static int uring_init(struct uring *r, unsigned int entries)
+{
+	struct io_uring_params p;
+
+	memset(&p, 0, sizeof(p));
+	memset(r, 0, sizeof(*r));
+	r->fd = syscall(__NR_io_uring_setup, entries, &p);
+	if (r->fd < 0)
+		return -1;
+
+	r->sq_ring_len = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	r->cq_ring_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (r->cq_ring_len > r->sq_ring_len)
+			r->sq_ring_len = r->cq_ring_len;
+		r->cq_ring_len = 0;
+	}
+	r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+
+	r->sq_ring = mmap(NULL, r->sq_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+	r->cq_ring = r->cq_ring_len ? mmap(NULL, r->cq_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		r->fd, IORING_OFF_CQ_RING) : r->sq_ring;
+	r->sqes = mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+	if (r->sq_ring == MAP_FAILED || r->cq_ring == MAP_FAILED || r->sqes == MAP_FAILED) {
+		close(r->fd);
+		return -1;
+	}
+
+	r->sq_head = (unsigned int *)((char *)r->sq_ring + p.sq_off.head);
+	r->sq_tail = (unsigned int *)((char *)r->sq_ring + p.sq_off.tail);
+	r->sq_mask = (unsigned int *)((char *)r->sq_ring + p.sq_off.ring_mask);
+	r->sq_array = (unsigned int *)((char *)r->sq_ring + p.sq_off.array);
+	r->cq_head = (unsigned int *)((char *)r->cq_ring + p.cq_off.head);
+	r->cq_tail = (unsigned int *)((char *)r->cq_ring + p.cq_off.tail);
+	r->cq_mask = (unsigned int *)((char *)r->cq_ring + p.cq_off.ring_mask);
+	r->cqes = (struct io_uring_cqe *)((char *)r->cq_ring + p.cq_off.cqes);
+
+	return 0;
+}
+
+static void uring_exit(struct uring *r)
+{
+	munmap(r->sqes, r->sqes_len);
+	if (r->cq_ring_len)
+		munmap(r->cq_ring, r->cq_ring_len);
+	munmap(r->sq_ring, r->sq_ring_len);
+	close(r->fd);
+}
+
+static void uring_read_fixed(struct uring *r, int fd, void *buf, unsigned int len, unsigned int buf_index, uint64_t user_data)
+{
+	unsigned int tail = *r->sq_tail, idx = tail & *r->sq_mask;
+	struct io_uring_sqe *sqe = &r->sqes[idx];
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_READ_FIXED;
+	sqe->fd = fd;
+	sqe->addr = (uint64_t)(uintptr_t)buf;
+	sqe->len = len;
+	sqe->off = 0;
+	sqe->buf_index = buf_index;
+	sqe->user_data = user_data;
+	r->sq_array[idx] = idx;
+	__atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+static double scan_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void scan_pread(struct blob_checker *c, const char *path)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		blob_check(c, path, NULL, -errno);
+		return;
+	}
+	ssize_t len = pread(fd, c->plain, c->config->max_file + 1, 0);
+	blob_check(c, path, c->plain, len < 0 ? -errno : len);
+	close(fd);
+}
+
+/*
+ * Returns 0 if io_uring read every file. Otherwise the ring is torn down and the files it had
+ * not completed, in flight or not opened yet, are read with pread() instead.
+ */
+static int scan_uring(struct blob_checker *c, uint8_t *bufs, char * const *paths, size_t count)
+{
+	const struct blob_scan_config *config = c->config;
+	size_t stride = config->max_file + 1;
+	unsigned int qd = config->queue_depth, slot, inflight = 0, queued = 0;
+	struct iovec *iov = calloc(qd, sizeof(*iov));
+	size_t *file = calloc(qd, sizeof(*file));
+	int *fds = calloc(qd, sizeof(*fds));
+	unsigned int *free_slots = calloc(qd, sizeof(*free_slots));
+	unsigned int nfree = qd;
+	size_t next = 0;
+	struct uring r;
+	int ret = -1;
+
+	if (!iov || !file || !fds || !free_slots || uring_init(&r, qd))
+		goto out;
+	for (slot = 0; slot < qd; slot++) {
+		iov[slot].iov_base = bufs + slot * stride;
+		iov[slot].iov_len = stride;
+		free_slots[slot] = slot;
+		fds[slot] = -1;
+	}
+	if (syscall(__NR_io_uring_register, r.fd, IORING_REGISTER_BUFFERS, iov, qd) < 0)
+		goto out_ring;
+
+	while (next < count || inflight) {
+		/* Keep the queue full */
+		while (nfree && next < count) {
+			int fd = open(paths[next], O_RDONLY);
+			if (fd < 0) {
+				blob_check(c, paths[next++], NULL, -errno);
+				continue;
+			}
+			slot = free_slots[--nfree];
+			file[slot] = next++;
+			fds[slot] = fd;
+			uring_read_fixed(&r, fd, iov[slot].iov_base, stride, slot, slot);
+			queued++;
+			inflight++;
+		}
+		if (!inflight)
+			break;
+
+		if (syscall(__NR_io_uring_enter, r.fd, queued, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR)
+			goto out_ring;
+		queued = 0;
+
+		/* Parse straight out of the registered buffers */
+		unsigned int head = *r.cq_head;
+		while (head != __atomic_load_n(r.cq_tail, __ATOMIC_ACQUIRE)) {
+			struct io_uring_cqe *cqe = &r.cqes[head & *r.cq_mask];
+			slot = cqe->user_data;
+			blob_check(c, paths[file[slot]], iov[slot].iov_base, cqe->res);
+			close(fds[slot]);
+			fds[slot] = -1;
+			free_slots[nfree++] = slot;
+			inflight--;
+			head++;
+		}
+		__atomic_store_n(r.cq_head, head, __ATOMIC_RELEASE);
+	}
+	ret = 0;
+
+out_ring:
+	uring_exit(&r);
+	/* Without the ring nothing is in flight any more: close those files and read them again */
+	for (slot = 0; slot < qd; slot++)
+		if (fds[slot] >= 0) {
+			close(fds[slot]);
+			scan_pread(c, paths[file[slot]]);
+		}
+out:
+	if (ret)
+		for (; next < count; next++)
+			scan_pread(c, paths[next]);
+	free(iov);
+	free(file);
+	free(fds);
+	free(free_slots);
+	return ret;
+}
+
+/* Returns 0 when every file was looked at; the findings are in stats and passed to config->report */
+int blob_store_scan(const struct blob_scan_config *config, char * const *paths, size_t count, struct blob_scan_stats *stats)
+{
+	struct blob_checker c;
+	double t0 = scan_now();
+	uint8_t *bufs;
+
+	memset(stats, 0, sizeof(*stats));
+	memset(&c, 0, sizeof(c));
+	c.config = config;
+	c.stats = stats;
+	if (config->master_key)
+		blob_mkey_id(config->master_key, c.mkey_id);
+
+	bufs = mmap(NULL, config->queue_depth * (config->max_file + 1), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	c.scratch = malloc(config->max_file);
+	c.plain = malloc(config->max_file + 1);
+	if (bufs == MAP_FAILED || !c.scratch || !c.plain) {
+		if (bufs != MAP_FAILED)
+			munmap(bufs, config->queue_depth * (config->max_file + 1));
+		free(c.scratch);
+		free(c.plain);
+		return -1;
+	}
+
+	stats->io_uring = !scan_uring(&c, bufs, paths, count);
+	stats->seconds = scan_now() - t0;
+
+	if (c.ctx_valid)
+		test_blob_free(&c.ctx);
+	munmap(bufs, config->queue_depth * (config->max_file + 1));
+	free(c.scratch);
+	free(c.plain);
+
+	return stats->files == count ? 0 : -1;
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	Blob store: blob files on storage and a bulk scanner for them
+
+	Every blob file is a small header followed by a test blob (test_blob.h layout, not a CAAM
+	blob; it does not open on a board):
+
+		magic "ZBLB", version, master key source (enum snvs_mkey_source) at encapsulation time,
+		payload length, master key id (first 8 bytes of SHA-256 of the effective master key),
+		key modifier, then payload length + BLOB_OVERHEAD bytes of blob.
+
+	blob_store_scan() reads a list of files through io_uring with many reads in flight into
+	registered (fixed) buffers and parses the header in place, without copying it out of the
+	buffer. Each blob is checked against the current master key selection and, when the current
+	effective key is known (simulator), decapsulated with the software test blob engine. Kernels
+	without io_uring fall back to pread().
+*/
+
+#ifndef BLOB_STORE_H
+#define BLOB_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "test_blob.h"
+
+#define BLOB_FILE_MAGIC			0x424c425a	//"ZBLB"
+#define BLOB_FILE_VERSION		2	//2: BKEK label of the test blob engine
+#define BLOB_MKEY_ID_BYTES		8
+
+struct blob_file_header {
+	uint32_t magic;
+	uint16_t version;
+	uint8_t mkey_source;
+	uint8_t reserved;
+	uint32_t payload_len;
+	uint8_t mkey_id[BLOB_MKEY_ID_BYTES];
+	uint8_t key_modifier[BLOB_KEY_MODIFIER_BYTES];
+} __attribute__((packed));
+
+#define BLOB_FILE_SIZE(payload_len)	(sizeof(struct blob_file_header) + (payload_len) + BLOB_OVERHEAD)
+
+struct blob_scan_config {
+	unsigned int queue_depth;	/* reads in flight */
+	size_t max_file;		/* size of each registered buffer */
+	int source;			/* current enum snvs_mkey_source */
+	const uint8_t *master_key;	/* current effective key, NULL to only check the header */
+	void (*report)(const char *path, const char *reason);
+};
+
+struct blob_scan_stats {
+	size_t files;
+	size_t bytes;
+	size_t mismatched;		/* wrong master key source or id */
+	size_t corrupt;			/* unreadable, bad header or MAC mismatch */
+	size_t decapsulated;
+	int io_uring;			/* 1 if io_uring was used, 0 for the pread() fallback */
+	double seconds;
+};
+
+void blob_mkey_id(const uint8_t *master_key, uint8_t *id);
+int blob_file_write(const char *path, int source, const uint8_t *master_key, const uint8_t *key_modifier,
+	const uint8_t *payload, size_t len);
+const struct blob_file_header *blob_file_parse(const uint8_t *buf, size_t len);
+int blob_store_scan(const struct blob_scan_config *config, char * const *paths, size_t count, struct blob_scan_stats *stats);
+
+#endif /* BLOB_STORE_H */
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	CAAM job descriptor builder for blob encapsulation / decapsulation (header only)
+
+	After B.9 the next step of a provisioning flow is to have CAAM encapsulate keys in blobs.
+	The job descriptor for that is:
+
+		HEADER		CMD_DESC_HDR | HDR_ONE | length
+		LOAD		key modifier, 16 bytes immediate, into the class 2 key register
+		SEQ IN PTR	input pointer and length
+		SEQ OUT PTR	output pointer and length
+		OPERATION	blob encap / decap protocol
+
+	caam_blob_desc() writes it into a caller provided buffer, without heap use, and returns the
+	number of words. CAAM_BLOB_DESC() expands to the same words as a constant initializer, so a
+	descriptor whose modifier, buffers and lengths are known at build time is built by the compiler.
+	The command encodings follow the CAAM reference manual (and Linux drivers/crypto/caam/desc.h).
+	Pointers are 32 bits, as on i.MX6.
+*/
+
+#ifndef CAAM_DESC_H
+#define CAAM_DESC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define CMD_SHIFT			27
+#define CMD_LOAD			(0x02u << CMD_SHIFT)
+#define CMD_OPERATION			(0x10u << CMD_SHIFT)
+#define CMD_DESC_HDR			(0x16u << CMD_SHIFT)
+#define CMD_SEQ_IN_PTR			(0x1eu << CMD_SHIFT)
+#define CMD_SEQ_OUT_PTR			(0x1fu << CMD_SHIFT)
+
+#define HDR_ONE				0x00800000u
+#define HDR_DESCLEN_MASK		0x7fu
+
+#define LDST_CLASS_2_CCB		(0x02u << 25)
+#define LDST_IMM			0x00800000u
+#define LDST_SRCDST_BYTE_KEY		(0x40u << 16)
+#define LDST_LEN_MASK			0xffu
+
+#define SQIN_EXT			0x00400000u
+#define SQOUT_EXT			0x00400000u
+#define SQ_LEN_MASK			0xffffu
+
+#define OP_TYPE_DECAP_PROTOCOL		(0x06u << 24)
+#define OP_TYPE_ENCAP_PROTOCOL		(0x07u << 24)
+#define OP_PCLID_BLOB			(0x0du << 16)
+
+#define CAAM_KEY_MODIFIER_BYTES		16
+#define CAAM_BLOB_OVERHEAD		48
+#define CAAM_BLOB_DESC_WORDS		11		//without extended lengths
+#define CAAM_BLOB_DESC_MAX_WORDS	13
+
+enum caam_blob_op {
+	CAAM_BLOB_ENCAP,
+	CAAM_BLOB_DECAP,
+};
+
+#define CAAM_DESC_HDR(words)		(CMD_DESC_HDR | HDR_ONE | ((words) & HDR_DESCLEN_MASK))
+#define CAAM_LOAD_KEY_MODIFIER		(CMD_LOAD | LDST_CLASS_2_CCB | LDST_IMM | LDST_SRCDST_BYTE_KEY | CAAM_KEY_MODIFIER_BYTES)
+#define CAAM_BLOB_OPERATION(op)		(CMD_OPERATION | OP_PCLID_BLOB | \
+					 ((op) == CAAM_BLOB_ENCAP ? OP_TYPE_ENCAP_PROTOCOL : OP_TYPE_DECAP_PROTOCOL))
+#define CAAM_BLOB_OUT_LEN(op, len)	((op) == CAAM_BLOB_ENCAP ? (len) + CAAM_BLOB_OVERHEAD : (len) - CAAM_BLOB_OVERHEAD)
+
+/*
+ * Constant initializer of a blob descriptor (lengths below 64 KiB); km0..km3 are the key
+ * modifier words as they are laid out in memory.
+ */
+#define CAAM_BLOB_DESC(op, km0, km1, km2, km3, in_ptr, in_len, out_ptr) {		\
+	CAAM_DESC_HDR(CAAM_BLOB_DESC_WORDS),						\
+	CAAM_LOAD_KEY_MODIFIER, (km0), (km1), (km2), (km3),				\
+	CMD_SEQ_IN_PTR | ((in_len) & SQ_LEN_MASK), (in_ptr),				\
+	CMD_SEQ_OUT_PTR | (CAAM_BLOB_OUT_LEN(op, in_len) & SQ_LEN_MASK), (out_ptr),	\
+	CAAM_BLOB_OPERATION(op),							\
+}
+
+/* Golden encodings from the CAAM reference manual */
+_Static_assert(CAAM_DESC_HDR(CAAM_BLOB_DESC_WORDS) == 0xB080000B, "descriptor header encoding");
+_Static_assert(CAAM_LOAD_KEY_MODIFIER == 0x14C00010, "key modifier LOAD encoding");
+_Static_assert(CAAM_BLOB_OPERATION(CAAM_BLOB_ENCAP) == 0x870D0000, "blob encap OPERATION encoding");
+_Static_assert(CAAM_BLOB_OPERATION(CAAM_BLOB_DECAP) == 0x860D0000, "blob decap OPERATION encoding");
+
+static inline unsigned int caam_seq_ptr(uint32_t *desc, unsigned int i, uint32_t cmd, uint32_t ptr, uint32_t len)
+{
+	if (len > SQ_LEN_MASK) {
+		desc[i++] = cmd | (cmd == CMD_SEQ_IN_PTR ? SQIN_EXT : SQOUT_EXT);
+		desc[i++] = ptr;
+		desc[i++] = len;
+	} else {
+		desc[i++] = cmd | len;
+		desc[i++] = ptr;
+	}
+
+	return i;
+}
+
+/*
+ * Builds a blob encap/decap job descriptor in desc (room for max_words words).
+ * in_len is the payload length for encap and the blob length for decap.
+ * Returns the descriptor length in words, or 0 if it does not fit or the lengths are invalid.
+ */
+static inline unsigned int caam_blob_desc(uint32_t *desc, unsigned int max_words, enum caam_blob_op op,
+	const uint8_t *key_modifier, uint32_t in_ptr, uint32_t in_len, uint32_t out_ptr)
+{
+	unsigned int i = 1;
+
+	if (max_words < CAAM_BLOB_DESC_MAX_WORDS || (op == CAAM_BLOB_DECAP && in_len < CAAM_BLOB_OVERHEAD) ||
+	    (op == CAAM_BLOB_ENCAP && in_len > UINT32_MAX - CAAM_BLOB_OVERHEAD))
+		return 0;
+
+	desc[i++] = CAAM_LOAD_KEY_MODIFIER;
+	memcpy(&desc[i], key_modifier, CAAM_KEY_MODIFIER_BYTES);
+	i += CAAM_KEY_MODIFIER_BYTES / 4;
+	i = caam_seq_ptr(desc, i, CMD_SEQ_IN_PTR, in_ptr, in_len);
+	i = caam_seq_ptr(desc, i, CMD_SEQ_OUT_PTR, out_ptr, CAAM_BLOB_OUT_LEN(op, in_len));
+	desc[i++] = CAAM_BLOB_OPERATION(op);
+	desc[0] = CAAM_DESC_HDR(i);
+
+	return i;
+}
+
+#endif /* CAAM_DESC_H */
@@ -0,0 +1,295 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "caam_jr_sim.h"
+
+#define JR_CACHE_LINE			64
+
+struct jr_entry {
+	uint32_t index;			/* job index, stands in for the descriptor bus address */
+	int32_t status;
+};
+
+/* Single producer / single consumer ring; head and tail only ever grow */
+struct jr_ring {
+	uint32_t mask;
+	struct jr_entry *slots;
+	uint32_t head __attribute__((aligned(JR_CACHE_LINE)));
+	uint32_t tail __attribute__((aligned(JR_CACHE_LINE)));
+};
+
+struct jr_sim {
+	const struct caam_jr_config *config;
+	struct jr_ring in, out;
+	uint32_t (*desc)[CAAM_BLOB_DESC_MAX_WORDS];
+	struct test_blob_job *jobs;
+	struct test_blob_ctx ctx;
+	int doorbell;			/* eventfd: jobs added to the input ring */
+	int irq;			/* eventfd: jobs completed on the output ring */
+	int stop;
+	size_t interrupts;
+	uint32_t seed;
+};
+
+static int jr_ring_init(struct jr_ring *ring, unsigned int depth)
+{
+	ring->mask = depth - 1;
+	ring->head = ring->tail = 0;
+	ring->slots = calloc(depth, sizeof(*ring->slots));
+	return ring->slots ? 0 : -1;
+}
+
+static unsigned int jr_ring_space(struct jr_ring *ring)
+{
+	return ring->mask + 1 - (ring->tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE));
+}
+
+/* Producer side: fill one slot, publish later with jr_ring_publish() */
+static void jr_ring_put(struct jr_ring *ring, uint32_t pos, uint32_t index, int32_t status)
+{
+	ring->slots[pos & ring->mask].index = index;
+	ring->slots[pos & ring->mask].status = status;
+}
+
+static void jr_ring_publish(struct jr_ring *ring, uint32_t tail)
+{
+	__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+}
+
+/* Consumer side: returns 1 and the entry if one is available */
+static int jr_ring_get(struct jr_ring *ring, struct jr_entry *entry)
+{
+	uint32_t head = ring->head;
+
+	if (head == __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE))
+		return 0;
+	*entry = ring->slots[head & ring->mask];
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+static uint64_t jr_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void jr_wait_until(uint64_t deadline)
+{
+	while (jr_now_ns() < deadline)
+		sched_yield();
+}
+
+static uint32_t jr_random(struct jr_sim *sim)
+{
+	sim->seed ^= sim->seed << 13;
+	sim->seed ^= sim->seed >> 17;
+	sim->seed ^= sim->seed << 5;
+	return sim->seed;
+}
+
+/* The simulated CAAM: takes descriptors from the input ring and completes them in order */
+static void *jr_caam(void *arg)
+{
+	struct jr_sim *sim = arg;
+	const struct caam_jr_config *config = sim->config;
+	struct jr_entry entry;
+	uint64_t count;
+
+	for (;;) {
+		if (!jr_ring_get(&sim->in, &entry)) {
+			if (__atomic_load_n(&sim->stop, __ATOMIC_ACQUIRE))
+				break;
+			if (read(sim->doorbell, &count, sizeof(count)) < 0)
+				break;
+			continue;
+		}
+
+		uint64_t done = jr_now_ns() + config->latency_ns;
+		if (config->jitter_ns)
+			done += jr_random(sim) % config->jitter_ns;
+
+		uint32_t *desc = sim->desc[entry.index];
+		struct test_blob_job *job = &sim->jobs[entry.index];
+		uint32_t op = desc[(desc[0] & HDR_DESCLEN_MASK) - 1];
+		if (op == CAAM_BLOB_OPERATION(CAAM_BLOB_ENCAP))
+			job->result = test_blob_encap(&sim->ctx, job->in, job->len, job->out);
+		else if (op == CAAM_BLOB_OPERATION(CAAM_BLOB_DECAP))
+			job->result = test_blob_decap(&sim->ctx, job->in, job->len, job->out);
+		else
+			job->result = -1;
+		jr_wait_until(done);
+
+		/* The submitter keeps at most depth jobs in flight, so the output ring has room */
+		jr_ring_put(&sim->out, sim->out.tail, entry.index, job->result);
+		jr_ring_publish(&sim->out, sim->out.tail + 1);
+		if (config->interrupt) {
+			count = 1;
+			if (write(sim->irq, &count, sizeof(count)) == sizeof(count))
+				sim->interrupts++;
+		}
+	}
+
+	return NULL;
+}
+
+static int jr_cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/*
+ * Runs count blob jobs through the simulated job ring and fills stats.
+ * Returns 0 when every job went through the ring (individual job results are in jobs[].result).
+ */
+int caam_jr_sim_run(const struct caam_jr_config *config, const uint8_t *master_key, const uint8_t *key_modifier,
+	struct test_blob_job *jobs, size_t count, enum caam_blob_op op, struct caam_jr_stats *stats)
+{
+	uint8_t modifier[CAAM_KEY_MODIFIER_BYTES];
+	size_t submitted = 0, completed = 0, i;
+	uint64_t *submit_ns, *latency_ns, t0;
+	struct jr_sim sim;
+	pthread_t caam;
+	int ret = -1;
+
+	if (!config->depth || (config->depth & (config->depth - 1)) || !config->batch || config->batch > config->depth)
+		return -1;
+
+	memset(&sim, 0, sizeof(sim));
+	memset(stats, 0, sizeof(*stats));
+	memcpy(modifier, key_modifier, sizeof(modifier));
+	sim.config = config;
+	sim.jobs = jobs;
+	sim.seed = 0x2017;
+	sim.doorbell = eventfd(0, 0);
+	sim.irq = eventfd(0, 0);
+	sim.desc = malloc(count * sizeof(*sim.desc));
+	submit_ns = malloc(count * sizeof(*submit_ns));
+	latency_ns = malloc(count * sizeof(*latency_ns));
+	if (sim.doorbell < 0 || sim.irq < 0 || !sim.desc || !submit_ns || !latency_ns ||
+	    jr_ring_init(&sim.in, config->depth) || jr_ring_init(&sim.out, config->depth) ||
+	    test_blob_init(&sim.ctx, master_key, key_modifier))
+		goto out;
+
+	for (i = 0; i < count; i++)
+		if (!caam_blob_desc(sim.desc[i], CAAM_BLOB_DESC_MAX_WORDS, op, modifier, i, jobs[i].len, i))
+			goto out_ctx;
+
+	if (pthread_create(&caam, NULL, jr_caam, &sim))
+		goto out_ctx;
+
+	t0 = jr_now_ns();
+	while (completed < count) {
+		/*
+		 * Add a full batch, or whatever is left, when the ring has room for it. An input slot
+		 * is free once CAAM took the job, its completion is not reaped yet: the jobs in flight
+		 * are bounded by the depth of the output ring instead.
+		 */
+		size_t n = count - submitted < config->batch ? count - submitted : config->batch;
+		if (n && jr_ring_space(&sim.in) >= n && submitted - completed + n <= config->depth) {
+			uint32_t tail = sim.in.tail;
+			uint64_t now = jr_now_ns(), one = 1;
+
+			for (i = 0; i < n; i++, submitted++) {
+				submit_ns[submitted] = now;
+				jr_ring_put(&sim.in, tail++, submitted, 0);
+			}
+			jr_ring_publish(&sim.in, tail);
+			if (write(sim.doorbell, &one, sizeof(one)) == sizeof(one))
+				stats->doorbells++;
+			continue;
+		}
+
+		struct jr_entry entry;
+		int reaped = 0;
+		while (jr_ring_get(&sim.out, &entry)) {
+			latency_ns[completed++] = jr_now_ns() - submit_ns[entry.index];
+			stats->failed += entry.status != 0;
+			reaped++;
+		}
+		if (reaped)
+			continue;
+
+		if (config->interrupt) {
+			uint64_t irqs;
+			if (read(sim.irq, &irqs, sizeof(irqs)) < 0)
+				break;
+		} else {
+			sched_yield();
+		}
+	}
+	stats->seconds = (jr_now_ns() - t0) / 1e9;
+
+	__atomic_store_n(&sim.stop, 1, __ATOMIC_RELEASE);
+	uint64_t one = 1;
+	if (write(sim.doorbell, &one, sizeof(one)) != sizeof(one))
+		goto out_ctx;
+	pthread_join(caam, NULL);
+
+	stats->jobs = completed;
+	stats->interrupts = sim.interrupts;
+	if (completed) {
+		qsort(latency_ns, completed, sizeof(*latency_ns), jr_cmp_u64);
+		stats->p50_ns = latency_ns[completed / 2];
+		stats->p99_ns = latency_ns[completed * 99 / 100];
+		stats->p999_ns = latency_ns[completed * 999 / 1000];
+		stats->max_ns = latency_ns[completed - 1];
+	}
+	ret = completed == count ? 0 : -1;
+
+out_ctx:
+	test_blob_free(&sim.ctx);
+out:
+	if (sim.doorbell >= 0)
+		close(sim.doorbell);
+	if (sim.irq >= 0)
+		close(sim.irq);
+	free(sim.in.slots);
+	free(sim.out.slots);
+	free(sim.desc);
+	free(submit_ns);
+	free(latency_ns);
+	return ret;
+}
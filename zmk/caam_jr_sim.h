@@ -0,0 +1,78 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	CAAM job ring simulator
+
+	Models one CAAM job ring for tuning blob job batching without hardware: a single producer /
+	single consumer lock-free input ring carries job descriptors (built with caam_desc.h) to a
+	simulated CAAM thread, which waits a configurable completion latency plus random jitter, runs
+	the job on the software test blob engine (test_blob.h, not CAAM's blob format) and posts the
+	result on an SPSC output ring.
+
+	The submitter adds jobs in batches and rings the input doorbell once per batch (like writing
+	the number of added jobs to IRJAR). Completions are either polled from the output ring or
+	signalled by a simulated interrupt (an eventfd the CAAM thread writes). The run reports
+	throughput and the submit-to-completion latency distribution.
+*/
+
+#ifndef CAAM_JR_SIM_H
+#define CAAM_JR_SIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "test_blob.h"
+#include "caam_desc.h"
+
+struct caam_jr_config {
+	unsigned int depth;		/* ring entries, power of two */
+	unsigned int batch;		/* jobs added per doorbell */
+	unsigned int latency_ns;	/* fixed completion latency per job */
+	unsigned int jitter_ns;		/* uniform random extra latency per job */
+	int interrupt;			/* 0 = poll the output ring, 1 = wait for the completion interrupt */
+};
+
+struct caam_jr_stats {
+	size_t jobs;
+	size_t failed;
+	size_t doorbells;
+	size_t interrupts;
+	double seconds;
+	double p50_ns, p99_ns, p999_ns, max_ns;
+};
+
+int caam_jr_sim_run(const struct caam_jr_config *config, const uint8_t *master_key, const uint8_t *key_modifier,
+	struct test_blob_job *jobs, size_t count, enum caam_blob_op op, struct caam_jr_stats *stats);
+
+#endif /* CAAM_JR_SIM_H */
@@ -0,0 +1,197 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	libsnvs - SNVS access library
+
+	Stable C ABI around the SNVS register page: mapping (/dev/mem or the simulator), register
+	reads and writes, the device identity (OCOTP unique ID, SNVS version and lock state),
+	snapshots, field decoding, write-combining, polling with a deadline and the A/B ZMK
+	provisioning sequence. A process opens the page once with snvs_open() and keeps the handle
+	for as many operations as it needs, instead of running the zmk tool per operation.
+
+	Only the functions marked SNVS_API are exported from libsnvs.so. Register offsets and field
+	masks come from snvs.h. Structures passed across the ABI only grow at their end, and any
+	incompatible change bumps LIBSNVS_ABI_VERSION together with the library soname.
+
+	The register access macros in snvs.h share one simulator switch (snvs_sim) per process, so a
+	process drives either the simulator or the hardware, not both. SNVS_OPEN_ATOMIC likewise
+	turns on atomic read-modify-writes (snvs_atomic) for the whole process, and SNVS_OPEN_MU or
+	SNVS_OPEN_TEE route every access to one backend. snvs_open() therefore fails with EBUSY
+	while handles of another mode are open; closing the last handle of a mode undoes it.
+*/
+
+#ifndef LIBSNVS_H
+#define LIBSNVS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "snvs_regs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LIBSNVS_ABI_VERSION		1
+
+#define SNVS_API			__attribute__((visibility("default")))
+
+typedef struct snvs snvs_t;
+
+//snvs_open() flags
+#define SNVS_OPEN_SIM			0x1		//use the SNVS simulator instead of /dev/mem
+#define SNVS_OPEN_READONLY		0x2		//map the page read-only, writes fail
+#define SNVS_OPEN_MU			0x4		//reach SNVS through a messaging unit (snvs_mu.h), simulated controller
+#define SNVS_OPEN_TEE			0x8		//reach SNVS through a trusted application (snvs_tee.h), simulated
+#define SNVS_OPEN_ATOMIC		0x10		//serialize read-modify-writes between threads and processes (snvs_atomic)
+
+//Registers a write-combining batch can hold before it must be flushed
+#define SNVS_WC_MAX			16
+
+//Default time snvs_provision() waits for the ZMK to read as zero once it is read locked
+#define SNVS_ZEROIZE_TIMEOUT_US		1000
+
+//Provisioning steps, recorded in SNVS_LPGPR as they complete (must fit in 4 bits)
+enum snvs_step {
+	STEP_NONE, STEP_A1, STEP_A2, STEP_A3, STEP_A4,
+	STEP_B1, STEP_B2, STEP_B3, STEP_B4, STEP_B5, STEP_B6, STEP_B7, STEP_B8, STEP_B9, STEP_B10,
+	STEP_DONE
+};
+
+/* Identity of the device, read in one pass over OCOTP and SNVS */
+struct snvs_identity {
+	uint64_t uid;				//OCOTP_CFG1:OCOTP_CFG0, 0 when the OCOTP could not be mapped
+	uint32_t hpvidr1;
+	uint32_t hpvidr2;
+	uint32_t hplr;
+	uint32_t lplr;
+	uint32_t lpmkcr;
+	uint32_t hpsr;
+};
+
+struct snvs_provision_config {
+	uint32_t zmk[8];			//key written to SNVS_LPZMKR0..7
+	unsigned int zmk_words;			//number of ZMK words to program (1..8)
+	int hard_locks;				//lock with SNVS_LPLR (cleared by POR) instead of SNVS_HPLR (cleared by system reset)
+	unsigned int master_key_sel;		//SNVS_LPMKCR[MASTER_KEY_SEL]
+	unsigned int zeroize_timeout_us;	//0 selects SNVS_ZEROIZE_TIMEOUT_US
+	FILE *log;				//step by step report, NULL for none
+};
+
+struct snvs_rotate_config {
+	uint32_t zmk[8];			//new key for SNVS_LPZMKR0..7
+	unsigned int zmk_words;			//words given in zmk (1..8), the remaining words are zero
+	int soft_lock;				//set ZMK_WSL, ZMK_RSL and MKS_SL once the new key is in use
+	int dry_run;				//stage and report the plan, write nothing
+	FILE *log;				//report, NULL for none
+};
+
+/* What snvs_rotate() did; the window is the time CAAM was given a master key other than the old or new one */
+struct snvs_rotate_result {
+	unsigned int words_written;
+	unsigned int window_accesses;		//register accesses inside the window, 0 when there was none
+	uint64_t staging_ns;
+	uint64_t window_ns;
+	uint64_t total_ns;
+};
+
+SNVS_API unsigned int snvs_abi_version(void);
+
+/* Map the SNVS page; returns NULL with errno set on failure */
+SNVS_API snvs_t *snvs_open(unsigned int flags);
+SNVS_API void snvs_close(snvs_t *snvs);
+
+/* Base of the mapped register page, for the register macros in snvs.h */
+SNVS_API void *snvs_base(snvs_t *snvs);
+
+SNVS_API uint32_t snvs_read(const snvs_t *snvs, unsigned int offset);
+SNVS_API int snvs_write(snvs_t *snvs, unsigned int offset, uint32_t value);
+SNVS_API int snvs_set_bits(snvs_t *snvs, unsigned int offset, uint32_t bits);
+SNVS_API int snvs_modify(snvs_t *snvs, unsigned int offset, uint32_t clear, uint32_t set);
+SNVS_API void snvs_read_many(const snvs_t *snvs, const unsigned int *offsets, uint32_t *values, unsigned int count);
+SNVS_API void snvs_snapshot(const snvs_t *snvs, struct snvs_snapshot *snap);
+
+/*
+ * Identity snapshot, read on first use and cached in the handle for its lifetime. Writes to
+ * the lock registers through the handle refresh it on the next call.
+ */
+SNVS_API const struct snvs_identity *snvs_identity(snvs_t *snvs);
+
+/*
+ * Write-combining: bits queued for the same register are merged and set with one
+ * read-modify-write when the batch is flushed. snvs_wc_flush() returns the number of
+ * register writes it issued, or -1 if a register did not keep the queued bits.
+ */
+SNVS_API int snvs_wc_set(snvs_t *snvs, unsigned int offset, uint32_t bits);
+SNVS_API int snvs_wc_flush(snvs_t *snvs);
+
+/* Wait until (register & mask) == value; returns 0, or -1 once timeout_us has passed */
+SNVS_API int snvs_poll(const snvs_t *snvs, unsigned int offset, uint32_t mask, uint32_t value, unsigned int timeout_us);
+
+/*
+ * Send register writes a backend still holds (SNVS_OPEN_MU); snvs_close() does it too. Returns 0,
+ * or -1 once the backend lost the other side: reads then return all ones (SNVS_BACKEND_POISON), polls and
+ * snvs_provision() fail, and the caller decides whether to close the handle or stop.
+ */
+SNVS_API int snvs_flush(snvs_t *snvs);
+
+/* Run the A/B ZMK programming sequence; returns 0 on success */
+SNVS_API int snvs_provision(snvs_t *snvs, const struct snvs_provision_config *config);
+SNVS_API const char *snvs_step_name(unsigned int step);
+
+/*
+ * Replace the ZMK of a board whose ZMK and MASTER_KEY_SEL are not locked (soft locks cleared by
+ * a system reset, or never set). Returns 0 on success, -1 if the board cannot be rotated or
+ * the new key did not verify; the master key selection is then left on the OTPMK.
+ */
+SNVS_API int snvs_rotate(snvs_t *snvs, const struct snvs_rotate_config *config, struct snvs_rotate_result *result);
+
+/*
+ * Timeline tracing of steps, register accesses, polls and log output (snvs_trace.h).
+ * snvs_trace_save() stops tracing and writes a Chrome trace JSON file; it returns the
+ * number of spans written or -1.
+ */
+SNVS_API int snvs_trace_start(void);
+SNVS_API int snvs_trace_save(const char *path);
+
+static inline uint32_t snvs_field(uint32_t value, uint32_t mask)
+{
+	return (value & mask) / (mask & -mask);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBSNVS_H */
@@ -0,0 +1,520 @@
+#!/usr/bin/env python3
+#
+# Copyright 2017 NXP
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in
+#    the documentation and/or other materials provided with the
+#    distribution.
+#
+# 3. Neither the name of the copyright holder nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+# INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+# BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+# OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+# AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+# WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+# POSSIBILITY OF SUCH DAMAGE.
+#
+# Register map generator: reads a register description (see snvs_regs.yaml) and writes
+#   <prefix>_regs.h  register/field #defines, table types, snapshot structs
+#   <prefix>_regs.c  field tables, batched readers, reset values, simulator write handler, decoder
+#
+# Only the Python standard library is used, so the YAML reader covers the subset the
+# description needs: block mappings and lists, inline [a, b] lists, scalars and comments.
+#
+# usage: regmap.py DESCRIPTION.yaml OUT.h OUT.c
+
+import os
+import sys
+
+ACCESS = ("rw", "ro", "sticky", "w1c")
+SNAPSHOT = ("no", "yes")
+MACROS = ("mask_offset", "mask", "raw", "none")
+
+
+class DescriptionError(Exception):
+	pass
+
+
+class Number(int):
+	"""Integer that remembers how the description spelled it, for the generated #defines"""
+
+	def __new__(cls, text):
+		value = int.__new__(cls, text, 0)
+		value.text = text
+		return value
+
+
+def scalar(text):
+	text = text.strip()
+	if len(text) >= 2 and text[0] == text[-1] and text[0] in "\"'":
+		return text[1:-1]
+	if text.startswith("[") and text.endswith("]"):
+		return [scalar(item) for item in text[1:-1].split(",") if item.strip()]
+	try:
+		return Number(text)
+	except ValueError:
+		return text
+
+
+def strip_comment(line):
+	quote = None
+	for i, c in enumerate(line):
+		if quote:
+			if c == quote:
+				quote = None
+		elif c in "\"'":
+			quote = c
+		elif c == "#" and (i == 0 or line[i - 1] in " \t"):
+			return line[:i]
+	return line
+
+
+def load_yaml(path):
+	lines = []
+	with open(path) as f:
+		for number, raw in enumerate(f, 1):
+			line = strip_comment(raw.rstrip("\n")).rstrip()
+			if not line.strip():
+				continue
+			if "\t" in line[:len(line) - len(line.lstrip())]:
+				raise DescriptionError("%s:%d: tab in indentation" % (path, number))
+			lines.append((len(line) - len(line.lstrip(" ")), line.strip(), number))
+
+	def block(pos, indent):
+		if lines[pos][1].startswith("- "):
+			return sequence(pos, indent)
+		return mapping(pos, indent, {})
+
+	def mapping(pos, indent, result):
+		while pos < len(lines) and lines[pos][0] == indent and not lines[pos][1].startswith("- "):
+			_, text, number = lines[pos]
+			key, sep, value = text.partition(":")
+			if not sep:
+				raise DescriptionError("%s:%d: expected 'key: value'" % (path, number))
+			pos += 1
+			if value.strip():
+				result[key.strip()] = scalar(value)
+			elif pos < len(lines) and lines[pos][0] > indent:
+				result[key.strip()], pos = block(pos, lines[pos][0])
+			elif pos < len(lines) and lines[pos][0] == indent and lines[pos][1].startswith("- "):
+				result[key.strip()], pos = sequence(pos, indent)
+			else:
+				result[key.strip()] = None
+		return result, pos
+
+	def sequence(pos, indent):
+		result = []
+		while pos < len(lines) and lines[pos][0] == indent and lines[pos][1].startswith("- "):
+			_, text, number = lines[pos]
+			item = text[2:]
+			if ":" in item and not item.startswith(("\"", "'", "[")):
+				# "- key: value" opens a mapping indented two columns deeper
+				lines[pos] = (indent + 2, item, number)
+				entry, pos = mapping(pos, indent + 2, {})
+				result.append(entry)
+			else:
+				result.append(scalar(item))
+				pos += 1
+		return result, pos
+
+	if not lines:
+		raise DescriptionError("%s: empty description" % path)
+	result, pos = block(0, lines[0][0])
+	if pos != len(lines):
+		raise DescriptionError("%s:%d: unexpected indentation" % (path, lines[pos][2]))
+	return result
+
+
+def shift_of(mask):
+	return (mask & -mask).bit_length() - 1
+
+
+def check(desc):
+	registers = desc.get("registers") or []
+	by_name = {}
+	for reg in registers:
+		for key in ("name", "offset"):
+			if key not in reg:
+				raise DescriptionError("register without %s: %r" % (key, reg))
+		reg.setdefault("access", "rw")
+		reg.setdefault("reset", 0)
+		reg.setdefault("count", 1)
+		reg.setdefault("fields", [])
+		reg.setdefault("constants", [])
+		reg.setdefault("locked_by", [])
+		reg.setdefault("snapshot", "no")
+		if reg["access"] not in ACCESS:
+			raise DescriptionError("%s: unknown access %s" % (reg["name"], reg["access"]))
+		if reg["snapshot"] not in SNAPSHOT or (reg["snapshot"] == "yes" and reg["count"] > 1):
+			raise DescriptionError("%s: snapshot is yes or no, for single registers only" % reg["name"])
+		used = 0
+		for field in reg["fields"]:
+			field.setdefault("macros", "mask_offset")
+			field.setdefault("access", reg["access"])
+			field.setdefault("locked_by", [])
+			if not field.get("mask"):
+				raise DescriptionError("%s.%s: missing mask" % (reg["name"], field.get("name")))
+			if field["macros"] not in MACROS or field["access"] not in ACCESS:
+				raise DescriptionError("%s.%s: bad macros/access" % (reg["name"], field["name"]))
+			if field["mask"] & used:
+				raise DescriptionError("%s.%s: overlaps another field" % (reg["name"], field["name"]))
+			used |= field["mask"]
+		by_name[reg["name"]] = reg
+
+	# lock references are REG.FIELD names
+	for reg in registers:
+		for owner in [reg] + reg["fields"]:
+			refs = owner["locked_by"]
+			if not isinstance(refs, list):
+				refs = owner["locked_by"] = [refs]
+			resolved = []
+			for ref in refs:
+				reg_name, _, field_name = ref.partition(".")
+				lock = by_name.get(reg_name)
+				fields = [f for f in lock["fields"] if f["name"] == field_name] if lock else []
+				if not fields:
+					raise DescriptionError("%s: unknown lock %s" % (owner["name"], ref))
+				resolved.append((lock, fields[0]))
+			owner["locks"] = resolved
+	return registers
+
+
+def column(text, col):
+	width = 0
+	for c in text:
+		width = (width // 8 + 1) * 8 if c == "\t" else width + 1
+	tabs = 1
+	width = (width // 8 + 1) * 8
+	while width < col:
+		width += 8
+		tabs += 1
+	return text + "\t" * tabs
+
+
+def define(name, value, comment=None, indent=""):
+	line = column(indent + "#define " + name, 40) + value
+	if comment:
+		line = column(line, 56) + "//" + comment
+	return line
+
+
+def spelled(value):
+	return getattr(value, "text", "0x%x" % value)
+
+
+def lock_test(locks):
+	return " || ".join("(%s_reg32(mem, %s) & 0x%x)" % (desc_prefix, lock["name"], field["mask"]) for lock, field in locks)
+
+
+def member(reg):
+	name = reg["name"].lower()
+	prefix = desc_prefix + "_"
+	if name.startswith(prefix):
+		name = name[len(prefix):]
+	if name.endswith("n") and reg["count"] > 1:
+		name = name[:-1]
+	return name
+
+
+def snapshot(registers):
+	return [reg for reg in registers if reg["snapshot"] == "yes"]
+
+
+def reader(out, name, struct, var, registers):
+	p = desc_prefix
+	words = sum(reg["count"] for reg in registers)
+	out.append("static const unsigned int %s_offsets[] = {" % name)
+	for reg in registers:
+		if reg["count"] > 1:
+			for i in range(reg["count"]):
+				out.append("\t%s + %d," % (reg["name"], 4 * i))
+		else:
+			out.append("\t%s," % reg["name"])
+	out.append("};")
+	out.append("")
+	out.append("void %s(const struct %s *%s, struct %s *%s)" % (name, p, p, struct, var))
+	out.append("{")
+	out.append("\tuint32_t v[%d];" % words)
+	if any(reg["count"] > 1 for reg in registers):
+		out.append("\tunsigned int i;")
+	out.append("")
+	out.append("\t//One batch, so a backend behind a controller fetches every register in one exchange")
+	out.append("\t%s_read_many(%s, %s_offsets, v, %d);" % (p, p, name, words))
+	index = 0
+	for reg in registers:
+		if reg["count"] > 1:
+			out.append("\tfor (i = 0; i < %d; i++)" % reg["count"])
+			out.append("\t\t%s->%s[i] = v[%d + i];" % (var, member(reg), index))
+		else:
+			out.append("\t%s->%s = v[%d];" % (var, member(reg), index))
+		index += reg["count"]
+	out.append("}")
+	out.append("")
+
+
+def header(desc, registers, source, guard):
+	out = []
+	out.append(" /**")
+	out.append("\t%s register map" % desc["device"])
+	out.append("")
+	out.append("\tGenerated by regmap.py from %s, do not edit; run \"make regs\" instead." % source)
+	out.append("*/")
+	out.append("")
+	out.append("#ifndef %s" % guard)
+	out.append("#define %s" % guard)
+	out.append("")
+	out.append("#include <stddef.h>")
+	out.append("#include <stdint.h>")
+	out.append("")
+	out.append("//%s = Secure Non-Volatile Storage registers" % desc["device"])
+	out.append(define(desc["base_macro"], "0x%08x" % desc["base"]))
+	out.append("")
+	out.append("//%s registers offsets (all these need to be referred using %s)" % (desc["device"], desc["base_macro"]))
+	for reg in registers:
+		out.append(define(reg["name"], spelled(reg["offset"]), reg.get("description")))
+		if "count_macro" in reg:
+			out.append(define(reg["count_macro"], str(reg["count"]), indent="\t"))
+		for field in reg["fields"]:
+			comment = field.get("description")
+			if field["macros"] == "mask_offset":
+				out.append(define(field["name"] + "_MASK", spelled(field["mask"]), comment, "\t"))
+				out.append(define(field["name"] + "_OFFSET", str(shift_of(field["mask"])), indent="\t"))
+			elif field["macros"] == "mask":
+				out.append(define(field["name"] + "_MASK", spelled(field["mask"]), comment, "\t"))
+			elif field["macros"] == "raw":
+				out.append(define(field["name"], spelled(field["mask"]), comment, "\t"))
+		for const in reg["constants"]:
+			out.append(define(const["name"], spelled(const["value"]), const.get("description"), "\t"))
+		out.append("")
+
+	p = desc_prefix
+	out.append("struct %s_reg_field {" % p)
+	out.append("\tconst char *name;")
+	out.append("\tuint32_t mask;")
+	out.append("\tunsigned int shift;")
+	out.append("};")
+	out.append("")
+	out.append("struct %s_reg {" % p)
+	out.append("\tconst char *name;")
+	out.append("\tunsigned int offset;")
+	out.append("\tunsigned int count;")
+	out.append("\tuint32_t reset;")
+	out.append("\tconst struct %s_reg_field *fields;" % p)
+	out.append("\tunsigned int nfields;")
+	out.append("};")
+	out.append("")
+	out.append("/* Snapshot of every register, in address order */")
+	out.append("struct %s_regs {" % p)
+	for reg in registers:
+		if reg["count"] > 1:
+			out.append("\tuint32_t %s[%d];" % (member(reg), reg["count"]))
+		else:
+			out.append("\tuint32_t %s;" % member(reg))
+	out.append("};")
+	out.append("")
+	out.append("/* Registers captured together by %s_snapshot() (snapshot: yes in %s) */" % (p, source))
+	out.append("struct %s_snapshot {" % p)
+	for reg in snapshot(registers):
+		out.append("\tuint32_t %s;" % member(reg))
+	out.append("};")
+	out.append("")
+	out.append("struct %s;" % p)
+	out.append("")
+	out.append("extern const struct %s_reg %s_regs_table[];" % (p, p))
+	out.append("extern const unsigned int %s_regs_count;" % p)
+	out.append("")
+	out.append("const struct %s_reg *%s_reg_lookup(unsigned int offset);" % (p, p))
+	out.append("void %s_regs_read(const struct %s *%s, struct %s_regs *regs);" % (p, p, p, p))
+	out.append("void %s_regs_snapshot(const struct %s *%s, struct %s_snapshot *snap);" % (p, p, p, p))
+	out.append("void %s_regs_reset(volatile void *mem);" % p)
+	out.append("uint32_t %s_regs_sim_update(const volatile void *mem, unsigned int offset, uint32_t old, uint32_t value);" % p)
+	out.append("size_t %s_regs_decode(unsigned int offset, uint32_t value, char *buf, size_t len);" % p)
+	out.append("")
+	out.append("#endif /* %s */" % guard)
+	return out
+
+
+def masks(reg):
+	ro = sticky = w1c = 0
+	covered = 0
+	for field in reg["fields"]:
+		covered |= field["mask"]
+		access = field["access"]
+		if access == "ro":
+			ro |= field["mask"]
+		elif access == "sticky":
+			sticky |= field["mask"]
+		elif access == "w1c":
+			w1c |= field["mask"]
+	rest = 0xFFFFFFFF & ~covered
+	if reg["access"] == "ro":
+		ro |= rest
+	elif reg["access"] == "sticky":
+		sticky |= rest
+	elif reg["access"] == "w1c":
+		w1c |= rest
+	return ro, sticky, w1c
+
+
+def source(desc, registers, source_name, header_name):
+	p = desc_prefix
+	out = []
+	out.append(" /**")
+	out.append("\t%s register tables, reset values, simulator write handler and decoder" % desc["device"])
+	out.append("")
+	out.append("\tGenerated by regmap.py from %s, do not edit; run \"make regs\" instead." % source_name)
+	out.append("*/")
+	out.append("")
+	out.append("#include <stdio.h>")
+	out.append("")
+	out.append("#include \"%s\"" % header_name)
+	out.append("#include \"lib%s.h\"" % p)
+	out.append("")
+	out.append("#define %s_reg32(mem, offset)\t(*(const volatile uint32_t *)((const volatile char *)(mem) + (offset)))" % p)
+	out.append("")
+	for reg in registers:
+		if not reg["fields"]:
+			continue
+		out.append("static const struct %s_reg_field %s_fields[] = {" % (p, member(reg)))
+		for field in reg["fields"]:
+			out.append("\t{ \"%s\", 0x%08x, %d }," % (field["name"], field["mask"], shift_of(field["mask"])))
+		out.append("};")
+		out.append("")
+	out.append("const struct %s_reg %s_regs_table[] = {" % (p, p))
+	for reg in registers:
+		fields = "%s_fields, %d" % (member(reg), len(reg["fields"])) if reg["fields"] else "NULL, 0"
+		out.append("\t{ \"%s\", %s, %d, 0x%08x, %s }," % (reg["name"], reg["name"], reg["count"], reg["reset"], fields))
+	out.append("};")
+	out.append("")
+	out.append("const unsigned int %s_regs_count = sizeof(%s_regs_table) / sizeof(%s_regs_table[0]);" % (p, p, p))
+	out.append("")
+	out.append("const struct %s_reg *%s_reg_lookup(unsigned int offset)" % (p, p))
+	out.append("{")
+	out.append("\tunsigned int i;")
+	out.append("")
+	out.append("\tfor (i = 0; i < %s_regs_count; i++)" % p)
+	out.append("\t\tif (offset >= %s_regs_table[i].offset && offset < %s_regs_table[i].offset + 4 * %s_regs_table[i].count)" % (p, p, p))
+	out.append("\t\t\treturn &%s_regs_table[i];" % p)
+	out.append("")
+	out.append("\treturn NULL;")
+	out.append("}")
+	out.append("")
+	reader(out, "%s_regs_read" % p, "%s_regs" % p, "regs", registers)
+	reader(out, "%s_regs_snapshot" % p, "%s_snapshot" % p, "snap", snapshot(registers))
+	out.append("void %s_regs_reset(volatile void *mem)" % p)
+	out.append("{")
+	for reg in registers:
+		if reg["reset"]:
+			out.append("\t*(volatile uint32_t *)((volatile char *)mem + %s) = 0x%08x;" % (reg["name"], reg["reset"]))
+	out.append("}")
+	out.append("")
+	out.append("/*")
+	out.append(" * Value a register holds after software writes value over old: read-only and locked bits")
+	out.append(" * keep old, sticky bits only set, write-1-to-clear bits only clear.")
+	out.append(" */")
+	out.append("uint32_t %s_regs_sim_update(const volatile void *mem, unsigned int offset, uint32_t old, uint32_t value)" % p)
+	out.append("{")
+	out.append("\tuint32_t ro, sticky, w1c;")
+	out.append("")
+	out.append("\tswitch (offset) {")
+	for reg in registers:
+		ro, sticky, w1c = masks(reg)
+		locked = [f for f in reg["fields"] if f["locks"]]
+		if not (ro or sticky or w1c or locked or reg["locks"]):
+			continue
+		if reg["count"] > 1:
+			out.append("\tcase %s ... %s + %d:" % (reg["name"], reg["name"], 4 * (reg["count"] - 1)))
+		else:
+			out.append("\tcase %s:" % reg["name"])
+		if reg["locks"]:
+			out.append("\t\tif (%s)" % lock_test(reg["locks"]))
+			out.append("\t\t\treturn old;")
+		out.append("\t\tro = 0x%08x;" % ro)
+		for field in locked:
+			out.append("\t\tif (%s)" % lock_test(field["locks"]))
+			out.append("\t\t\tro |= 0x%08x;\t//%s" % (field["mask"], field["name"]))
+		out.append("\t\tsticky = 0x%08x;" % sticky)
+		out.append("\t\tw1c = 0x%08x;" % w1c)
+		out.append("\t\tbreak;")
+	out.append("\tdefault:")
+	out.append("\t\treturn value;")
+	out.append("\t}")
+	out.append("")
+	out.append("\treturn (old & ro) | ((old | value) & sticky & ~ro) | (old & ~value & w1c & ~ro) |")
+	out.append("\t\t(value & ~(ro | sticky | w1c));")
+	out.append("}")
+	out.append("")
+	out.append("/* Formats \"NAME = 0xVALUE FIELD=x ...\"; returns the length snprintf() would need */")
+	out.append("size_t %s_regs_decode(unsigned int offset, uint32_t value, char *buf, size_t len)" % p)
+	out.append("{")
+	out.append("\tconst struct %s_reg *reg = %s_reg_lookup(offset);" % (p, p))
+	out.append("\tsize_t n;")
+	out.append("\tunsigned int i;")
+	out.append("")
+	out.append("\tif (!reg)")
+	out.append("\t\treturn snprintf(buf, len, \"0x%03x = 0x%08x\", offset, value);")
+	out.append("")
+	out.append("\tif (reg->count > 1)")
+	out.append("\t\tn = snprintf(buf, len, \"%s[%u] = 0x%08x\", reg->name, (offset - reg->offset) / 4, value);")
+	out.append("\telse")
+	out.append("\t\tn = snprintf(buf, len, \"%s = 0x%08x\", reg->name, value);")
+	out.append("\tfor (i = 0; i < reg->nfields; i++)")
+	out.append("\t\tn += snprintf(n < len ? buf + n : NULL, n < len ? len - n : 0, \" %s=0x%x\", reg->fields[i].name,")
+	out.append("\t\t\t(value & reg->fields[i].mask) >> reg->fields[i].shift);")
+	out.append("")
+	out.append("\treturn n;")
+	out.append("}")
+	return out
+
+
+def main(argv):
+	global desc_prefix
+
+	if len(argv) != 4:
+		sys.stderr.write("usage: %s DESCRIPTION.yaml OUT.h OUT.c\n" % argv[0])
+		return 2
+
+	try:
+		desc = load_yaml(argv[1])
+		for key in ("device", "prefix", "base", "base_macro"):
+			if key not in desc:
+				raise DescriptionError("%s: missing %s" % (argv[1], key))
+		desc_prefix = desc["prefix"]
+		registers = check(desc)
+	except (OSError, DescriptionError) as e:
+		sys.stderr.write("regmap: %s\n" % e)
+		return 1
+
+	here = os.path.dirname(os.path.abspath(__file__))
+	with open(os.path.join(here, "zmk.c")) as f:
+		license = "".join(f.readline() for _ in range(32))
+
+	source_name = os.path.basename(argv[1])
+	header_name = os.path.basename(argv[2])
+	guard = header_name.upper().replace(".", "_")
+	for path, lines in ((argv[2], header(desc, registers, source_name, guard)),
+			(argv[3], source(desc, registers, source_name, header_name))):
+		with open(path, "w") as f:
+			f.write(license + "\n" + "\n".join(lines) + "\n")
+	return 0
+
+
+if __name__ == "__main__":
+	sys.exit(main(sys.argv))
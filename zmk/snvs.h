@@ -0,0 +1,69 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	SNVS register map and register access helpers shared by the zmk tool and its services.
+*/
+
+#ifndef SNVS_H
+#define SNVS_H
+
+#include <stdint.h>
+
+#define ADDR_SIZE 4
+
+//Register and field definitions are generated from snvs_regs.yaml
+#include "snvs_regs.h"
+
+#define get_value_of_SNVS_reg_field(virt_addr, add_offset, field, offset)  ((read_SNVS_reg(virt_addr, add_offset) & field) >> offset)
+#define get_SNVS_reg(virt_addr, add_offset)  (int*)(((void*)virt_addr)+add_offset)
+#define set_value_of_SNVS_reg(virt_addr, add_offset, value)	modify_SNVS_reg(virt_addr, add_offset, 0, (unsigned int)value)
+
+//All register accesses go through these two, so the simulator sees (and can time) every one of them
+unsigned int read_SNVS_reg(const void *virt_addr, unsigned int add_offset);
+void write_SNVS_reg(void *virt_addr, unsigned int add_offset, unsigned int value);
+
+/*
+ * Read-modify-write: clear, then set bits. With snvs_atomic set no other thread or process
+ * using the same switch can update any register between the read and the write.
+ */
+void modify_SNVS_reg(void *virt_addr, unsigned int add_offset, unsigned int clear, unsigned int set);
+extern int snvs_atomic;
+
+#ifndef SNVS_UPDATE_LOCK
+#define SNVS_UPDATE_LOCK		"/run/lock/snvs.lock"	//serializes atomic updates between processes on hardware
+#endif
+
+#include "snvs_srtc.h"
+
+#endif /* SNVS_H */
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	Header-only C++ layer over libsnvs
+
+	libsnvs::device owns an snvs_t handle and forwards to the C ABI through inline members, so
+	C++ callers get RAII and typed register fields without an extra library or any cost over
+	calling libsnvs directly. libsnvs::field<OFFSET, MASK> decodes a register field with the shift
+	computed at compile time from the mask.
+*/
+
+#ifndef SNVS_HPP
+#define SNVS_HPP
+
+#include <cerrno>
+#include <cstdint>
+#include <system_error>
+#include <utility>
+
+#include "snvs.h"
+#include "libsnvs.h"
+
+namespace libsnvs {
+
+template <unsigned int Offset, uint32_t Mask>
+struct field {
+	static_assert(Mask != 0, "empty register field");
+
+	static constexpr unsigned int offset = Offset;
+	static constexpr uint32_t mask = Mask;
+	static constexpr unsigned int shift = __builtin_ctz(Mask);
+
+	static constexpr uint32_t get(uint32_t value) { return (value & Mask) >> shift; }
+};
+
+using ssm_state = field<SNVS_HPSR, SSM_ST_MASK>;
+using zmk_hwp = field<SNVS_LPMKCR, ZMK_HWP_MASK>;
+using master_key_sel = field<SNVS_LPMKCR, 0x3>;
+using zmk_rhl = field<SNVS_LPLR, ZMK_RHL_MASK>;
+using zmk_whl = field<SNVS_LPLR, ZMK_WHL_MASK>;
+using mks_hl = field<SNVS_LPLR, MKS_HL_MASK>;
+using zmk_rsl = field<SNVS_HPLR, ZMK_RSL_MASK>;
+using zmk_wsl = field<SNVS_HPLR, ZMK_WSL_MASK>;
+using mks_sl = field<SNVS_HPLR, MKS_SL_MASK>;
+using ip_id = field<SNVS_HPVIDR1, IP_ID_MASK>;
+
+class device {
+public:
+	explicit device(unsigned int flags = 0) : h_(snvs_open(flags))
+	{
+		if (!h_)
+			throw std::system_error(errno, std::generic_category(), "snvs_open");
+	}
+
+	~device() { snvs_close(h_); }
+
+	device(const device &) = delete;
+	device &operator=(const device &) = delete;
+	device(device &&other) noexcept : h_(std::exchange(other.h_, nullptr)) {}
+	device &operator=(device &&other) noexcept
+	{
+		std::swap(h_, other.h_);
+		return *this;
+	}
+
+	snvs_t *handle() const noexcept { return h_; }
+	void *base() const noexcept { return snvs_base(h_); }
+
+	uint32_t read(unsigned int offset) const noexcept { return snvs_read(h_, offset); }
+	bool write(unsigned int offset, uint32_t value) noexcept { return !snvs_write(h_, offset, value); }
+	bool set_bits(unsigned int offset, uint32_t bits) noexcept { return !snvs_set_bits(h_, offset, bits); }
+
+	template <typename Field>
+	uint32_t get() const noexcept { return Field::get(read(Field::offset)); }
+
+	struct snvs_snapshot snapshot() const noexcept
+	{
+		struct snvs_snapshot snap;
+		snvs_snapshot(h_, &snap);
+		return snap;
+	}
+
+	bool queue(unsigned int offset, uint32_t bits) noexcept { return !snvs_wc_set(h_, offset, bits); }
+	int flush() noexcept { return snvs_wc_flush(h_); }
+
+	bool poll(unsigned int offset, uint32_t mask, uint32_t value, unsigned int timeout_us) const noexcept
+	{
+		return !snvs_poll(h_, offset, mask, value, timeout_us);
+	}
+
+	template <typename Field>
+	bool poll(uint32_t value, unsigned int timeout_us) const noexcept
+	{
+		return poll(Field::offset, Field::mask, value << Field::shift, timeout_us);
+	}
+
+	bool provision(const snvs_provision_config &config) noexcept { return !snvs_provision(h_, &config); }
+
+private:
+	snvs_t *h_;
+};
+
+} // namespace libsnvs
+
+#endif /* SNVS_HPP */
@@ -0,0 +1,283 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "snvs_regs.h"
+#include "snvs_script.h"
+#include "snvs_archive.h"
+
+#define ARCHIVE_VERSION			1
+#define ARCHIVE_HEADER_SIZE		64
+#define ARCHIVE_LANES			4
+
+typedef uint32_t archive_vec __attribute__((vector_size(4 * ARCHIVE_LANES)));
+
+struct archive_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t columns;
+	uint64_t count;
+	uint64_t stride;
+	uint8_t reserved[ARCHIVE_HEADER_SIZE - 32];
+};
+
+const unsigned int snvs_archive_offset[ARCHIVE_COLUMNS] = {
+	[ARCHIVE_HPLR] = SNVS_HPLR,
+	[ARCHIVE_HPCOMR] = SNVS_HPCOMR,
+	[ARCHIVE_LPLR] = SNVS_LPLR,
+	[ARCHIVE_LPMKCR] = SNVS_LPMKCR,
+};
+
+static size_t archive_size(uint64_t stride)
+{
+	return ARCHIVE_HEADER_SIZE + stride * (sizeof(uint64_t) + ARCHIVE_COLUMNS * sizeof(uint32_t));
+}
+
+static void archive_layout(struct snvs_archive *ar)
+{
+	char *p = (char *)ar->map + ARCHIVE_HEADER_SIZE;
+	unsigned int c;
+
+	ar->uid = (uint64_t *)p;
+	p += ar->stride * sizeof(uint64_t);
+	for (c = 0; c < ARCHIVE_COLUMNS; c++, p += ar->stride * sizeof(uint32_t))
+		ar->column[c] = (uint32_t *)p;
+}
+
+int snvs_archive_create(const char *path, uint64_t count, struct snvs_archive *ar)
+{
+	struct archive_header header = {
+		.magic = SNVS_ARCHIVE_MAGIC,
+		.version = ARCHIVE_VERSION,
+		.columns = ARCHIVE_COLUMNS,
+		.count = count,
+		.stride = (count + SNVS_ARCHIVE_BLOCK - 1) / SNVS_ARCHIVE_BLOCK * SNVS_ARCHIVE_BLOCK,
+	};
+	int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+	if (fd < 0)
+		return -1;
+	memset(ar, 0, sizeof(*ar));
+	ar->count = count;
+	ar->stride = header.stride;
+	ar->size = archive_size(header.stride);
+	if (ftruncate(fd, ar->size)) {
+		close(fd);
+		return -1;
+	}
+	ar->map = mmap(NULL, ar->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (ar->map == MAP_FAILED) {
+		ar->map = NULL;
+		return -1;
+	}
+	memcpy(ar->map, &header, sizeof(header));
+	archive_layout(ar);
+	return 0;
+}
+
+int snvs_archive_open(const char *path, struct snvs_archive *ar)
+{
+	struct archive_header header;
+	struct stat st;
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0)
+		return -1;
+	memset(ar, 0, sizeof(*ar));
+	if (fstat(fd, &st) || st.st_size < ARCHIVE_HEADER_SIZE || pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+	    memcmp(header.magic, SNVS_ARCHIVE_MAGIC, sizeof(header.magic)) || header.version != ARCHIVE_VERSION ||
+	    header.columns != ARCHIVE_COLUMNS || header.count > header.stride || header.stride % SNVS_ARCHIVE_BLOCK ||
+	    header.stride > (uint64_t)st.st_size || (uint64_t)st.st_size != archive_size(header.stride)) {
+		close(fd);
+		errno = EINVAL;
+		return -1;
+	}
+	ar->count = header.count;
+	ar->stride = header.stride;
+	ar->size = st.st_size;
+	ar->map = mmap(NULL, ar->size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (ar->map == MAP_FAILED) {
+		ar->map = NULL;
+		return -1;
+	}
+	madvise(ar->map, ar->size, MADV_SEQUENTIAL);
+	archive_layout(ar);
+	return 0;
+}
+
+void snvs_archive_close(struct snvs_archive *ar)
+{
+	if (ar->map)
+		munmap(ar->map, ar->size);
+	ar->map = NULL;
+}
+
+int snvs_archive_term(struct snvs_archive_query *query, const char *term)
+{
+	struct snvs_op op;
+	unsigned long value = 0;
+	unsigned int c;
+	uint32_t want;
+	int negate = term[0] == '!';
+	const char *eq;
+
+	term += negate;
+	eq = strchr(term, '=');
+
+	size_t len = eq ? (size_t)(eq - term) : strlen(term);
+	if (!len || len >= sizeof(op.name) || (negate && eq))
+		return -1;
+	memcpy(op.name, term, len);
+	op.name[len] = '\0';
+	if (snvs_script_resolve(op.name, &op))
+		return -1;
+
+	for (c = 0; c < ARCHIVE_COLUMNS; c++)
+		if (snvs_archive_offset[c] == op.offset)
+			break;
+	if (c == ARCHIVE_COLUMNS)
+		return -1;
+
+	if (eq) {
+		char *end;
+
+		value = strtoul(eq + 1, &end, 0);
+		if (!eq[1] || *end || value > op.mask >> op.shift)
+			return -1;
+		want = value << op.shift;
+	} else {
+		//A bare field asks for every bit of it set, !FIELD for none
+		want = negate ? 0 : op.mask;
+	}
+
+	if (query->mask[c] & op.mask & (query->want[c] ^ want))
+		query->empty = 1;
+	query->mask[c] |= op.mask;
+	query->want[c] |= want;
+	return 0;
+}
+
+size_t snvs_archive_select(const struct snvs_archive *ar, const struct snvs_archive_query *query, uint64_t *ids, size_t max)
+{
+	const archive_vec *column[ARCHIVE_COLUMNS];
+	archive_vec mask[ARCHIVE_COLUMNS], want[ARCHIVE_COLUMNS];
+	const archive_vec lane_bit = { 1, 2, 4, 8 };
+	unsigned int c, i, n = 0;
+	size_t matches = 0;
+	uint64_t row;
+
+	if (query->empty)
+		return 0;
+	for (c = 0; c < ARCHIVE_COLUMNS; c++) {
+		if (!query->mask[c])
+			continue;
+		column[n] = (const archive_vec *)ar->column[c];
+		mask[n] = (archive_vec){ 0 } + query->mask[c];
+		want[n++] = (archive_vec){ 0 } + query->want[c];
+	}
+
+	for (row = 0; row < ar->count; row += SNVS_ARCHIVE_BLOCK) {
+		archive_vec miss[SNVS_ARCHIVE_BLOCK / ARCHIVE_LANES] = { { 0 } };
+
+		//A row matches when no tested bit differs from the expected value
+		for (c = 0; c < n; c++) {
+			const archive_vec *p = column[c] + row / ARCHIVE_LANES;
+
+			for (i = 0; i < SNVS_ARCHIVE_BLOCK / ARCHIVE_LANES; i++)
+				miss[i] |= (p[i] ^ want[c]) & mask[c];
+		}
+
+		//One bit per row of the block, set when the row matches
+		archive_vec bits = { 0 };
+		for (i = 0; i < SNVS_ARCHIVE_BLOCK / ARCHIVE_LANES; i++)
+			bits |= (archive_vec)(miss[i] == 0) & (lane_bit << (i * ARCHIVE_LANES));
+
+		uint32_t hits = bits[0] | bits[1] | bits[2] | bits[3];
+		if (row + SNVS_ARCHIVE_BLOCK > ar->count)
+			hits &= (1U << (ar->count - row)) - 1;
+		if (!ids) {
+			matches += __builtin_popcount(hits);
+			continue;
+		}
+		for (; hits; hits &= hits - 1) {
+			if (matches < max)
+				ids[matches] = ar->uid[row + __builtin_ctz(hits)];
+			matches++;
+		}
+	}
+
+	return matches;
+}
+
+size_t snvs_archive_select_scalar(const struct snvs_archive *ar, const struct snvs_archive_query *query, uint64_t *ids,
+	size_t max)
+{
+	const uint32_t *column[ARCHIVE_COLUMNS];
+	uint32_t mask[ARCHIVE_COLUMNS], want[ARCHIVE_COLUMNS];
+	unsigned int c, n = 0;
+	size_t matches = 0;
+	uint64_t row;
+
+	if (query->empty)
+		return 0;
+	for (c = 0; c < ARCHIVE_COLUMNS; c++) {
+		if (!query->mask[c])
+			continue;
+		column[n] = ar->column[c];
+		mask[n] = query->mask[c];
+		want[n++] = query->want[c];
+	}
+
+	for (row = 0; row < ar->count; row++) {
+		uint32_t miss = 0;
+
+		for (c = 0; c < n; c++)
+			miss |= (column[c][row] ^ want[c]) & mask[c];
+		if (miss)
+			continue;
+		if (matches < max)
+			ids[matches] = ar->uid[row];
+		matches++;
+	}
+
+	return matches;
+}
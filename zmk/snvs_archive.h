@@ -0,0 +1,105 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	Columnar snapshot archive
+
+	An archive keeps the lock and master key state of many boards for audits: the SoC unique ID
+	and SNVS_HPLR, SNVS_HPCOMR, SNVS_LPLR and SNVS_LPMKCR as captured at the end of provisioning.
+	Each register is stored as its own column, so a query reads only the columns it tests:
+
+		header		64 bytes, magic "SNVSARC1", row count, padded row count (stride)
+		uid		stride x 64 bit
+		HPLR		stride x 32 bit	(then HPCOMR, LPLR and LPMKCR)
+
+	The stride is a multiple of SNVS_ARCHIVE_BLOCK rows, which keeps every column 64 byte
+	aligned. Archives are mapped, not read.
+
+	A query is a conjunction of field terms ("ZMK_VAL !ZMK_RHL", "MKS_EN !MKS_HL",
+	"SNVS_LPMKCR.MASTER_KEY_SEL=2") and compiles to one mask and expected value per column.
+	snvs_archive_select() evaluates SNVS_ARCHIVE_BLOCK rows at a time with vector operations
+	(GCC vector extensions: NEON on the i.MX, SSE on a PC) and only looks at single rows of a
+	block that holds a match.
+*/
+
+#ifndef SNVS_ARCHIVE_H
+#define SNVS_ARCHIVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SNVS_ARCHIVE_MAGIC		"SNVSARC1"
+#define SNVS_ARCHIVE_BLOCK		16
+
+enum snvs_archive_column {
+	ARCHIVE_HPLR,
+	ARCHIVE_HPCOMR,
+	ARCHIVE_LPLR,
+	ARCHIVE_LPMKCR,
+	ARCHIVE_COLUMNS,
+};
+
+struct snvs_archive {
+	void *map;
+	size_t size;
+	uint64_t count;
+	uint64_t stride;
+	uint64_t *uid;
+	uint32_t *column[ARCHIVE_COLUMNS];
+};
+
+struct snvs_archive_query {
+	uint32_t mask[ARCHIVE_COLUMNS];
+	uint32_t want[ARCHIVE_COLUMNS];
+	int empty;			/* contradicting terms, nothing can match */
+};
+
+extern const unsigned int snvs_archive_offset[ARCHIVE_COLUMNS];
+
+/* Create an archive of count zeroed rows, mapped writable for the caller to fill */
+int snvs_archive_create(const char *path, uint64_t count, struct snvs_archive *ar);
+int snvs_archive_open(const char *path, struct snvs_archive *ar);
+void snvs_archive_close(struct snvs_archive *ar);
+
+/* Add a term [!]FIELD or FIELD=VALUE (see snvs_script.h for names); returns 0 or -1 */
+int snvs_archive_term(struct snvs_archive_query *query, const char *term);
+
+/*
+ * Store the IDs of the first max matching rows in ids and return the number of matches;
+ * ids may be NULL with max 0 to count. _scalar is the row by row reference.
+ */
+size_t snvs_archive_select(const struct snvs_archive *ar, const struct snvs_archive_query *query, uint64_t *ids, size_t max);
+size_t snvs_archive_select_scalar(const struct snvs_archive *ar, const struct snvs_archive_query *query, uint64_t *ids,
+	size_t max);
+
+#endif /* SNVS_ARCHIVE_H */
@@ -0,0 +1,293 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/wait.h>
+
+#include "snvs.h"
+#include "snvs_mkey.h"
+#include "snvs_sim.h"
+#include "snvs_backend.h"
+#include "snvs_async.h"
+
+#define ASYNC_EVENTS			64
+
+static uint64_t now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void board_finish(struct snvs_async_board *b, int error)
+{
+	if (b->transport == SNVS_ASYNC_MU) {
+		//Writes still queued are posted; the stand-in applies them before it sees end of file
+		if (b->request.count && !error)
+			send(b->fd, &b->request, snvs_mu_request_size(b->request.count), MSG_NOSIGNAL);
+		close(b->fd);
+		waitpid(b->pid, NULL, 0);
+	} else {
+		close(b->fd);
+	}
+	b->fd = -1;
+	b->error = error;
+	b->done = 1;
+	b->end_us = now_us();
+	b->loop->running--;
+	if (b->loop->done)
+		b->loop->done(b);
+}
+
+static int board_send(struct snvs_async_board *b)
+{
+	size_t size = snvs_mu_request_size(b->request.count);
+	ssize_t n = send(b->fd, &b->request, size, MSG_NOSIGNAL);
+
+	b->sent = b->request.count;
+	b->request.count = 0;
+	return n == (ssize_t)size ? 0 : -1;
+}
+
+static struct snvs_mu_op *board_queue(struct snvs_async_board *b, uint32_t code, unsigned int offset, uint32_t value)
+{
+	//A full batch holds only writes, which need no answer
+	if (b->request.count == SNVS_MU_MAX_OPS && board_send(b))
+		b->error = errno;
+
+	struct snvs_mu_op *op = &b->request.ops[b->request.count++];
+
+	memset(op, 0, sizeof(*op));
+	op->code = code;
+	op->offset = offset;
+	op->value = value;
+	return op;
+}
+
+static void board_write(void *ctx, unsigned int offset, uint32_t value)
+{
+	struct snvs_async_board *b = ctx;
+
+	if (b->transport == SNVS_ASYNC_PAGE)
+		write_SNVS_reg(b->mem, offset, value);
+	else
+		board_queue(b, MU_WRITE, offset, value);
+}
+
+static void board_step(void *ctx, unsigned int step)
+{
+	struct snvs_async_board *b = ctx;
+	struct snvs_gpr_record rec = b->loop->record;
+	uint32_t words[SNVS_LPGPR_WORDS];
+	unsigned int i;
+
+	//The B.8 poll left the last value of SNVS_LPZMKRn it read; non zero means it timed out
+	if (step == STEP_B8)
+		b->zeroized = !b->vm.a;
+	rec.step = b->step = step;
+	snvs_gpr_encode(&rec, words);
+	for (i = 0; i < SNVS_LPGPR_WORDS; i++)
+		board_write(b, SNVS_LPGPR + 4 * i, words[i]);
+}
+
+/*
+ * Time of a page board: the simulated clock under the timing model, as snvs_poll() uses. It
+ * starts at 1 us, since snvs_bc_feed() takes 0 for no clock at all.
+ */
+static uint64_t board_now_us(const struct snvs_async_board *b)
+{
+	if (snvs_sim && !snvs_backend && snvs_sim_timed())
+		return snvs_sim_clock(b->mem) / 1000 + 1;
+	return now_us();
+}
+
+static int arm_poll_timer(struct snvs_async_board *b)
+{
+	struct itimerspec its = { .it_value.tv_nsec = SNVS_ASYNC_POLL_US * 1000 };
+
+	b->suspensions++;
+	b->suspended_us = now_us();
+	return timerfd_settime(b->fd, 0, &its, NULL);
+}
+
+/* Run a board until it has to wait or its program stops */
+static void board_run(struct snvs_async_board *b)
+{
+	const struct snvs_bc_io io = { b, board_write, board_step };
+	unsigned int wait;
+
+	while (!b->error && (wait = snvs_bc_resume(&b->vm, &io)) != BC_WAIT_NONE) {
+		if (b->transport == SNVS_ASYNC_PAGE) {
+			snvs_bc_feed(&b->vm, read_SNVS_reg(b->mem, b->vm.offset), wait == BC_WAIT_POLL ? board_now_us(b) : 0);
+			if (b->vm.wait == BC_WAIT_POLL && arm_poll_timer(b))
+				break;
+			if (b->vm.wait == BC_WAIT_POLL)
+				return;
+			continue;
+		}
+
+		if (wait == BC_WAIT_POLL) {
+			struct snvs_mu_op *op = board_queue(b, MU_POLL, b->vm.offset, 0);
+
+			snvs_bc_poll_args(&b->vm, &op->mask, &op->value, &op->timeout_us);
+		} else {
+			board_queue(b, MU_READ, b->vm.offset, 0);
+		}
+		if (board_send(b))
+			break;
+		b->round_trips++;
+		b->suspensions++;
+		return;
+	}
+
+	board_finish(b, b->error ? b->error : (b->vm.stopped ? 0 : errno));
+}
+
+/* The descriptor of a waiting board became readable */
+static void board_event(struct snvs_async_board *b)
+{
+	if (b->transport == SNVS_ASYNC_PAGE) {
+		uint64_t expirations;
+
+		if (read(b->fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+			return;
+		//The board went on while it was suspended, a simulated one only counts accesses
+		if (snvs_sim && !snvs_backend)
+			snvs_sim_wait(b->mem, (now_us() - b->suspended_us) * 1000);
+		snvs_bc_feed(&b->vm, read_SNVS_reg(b->mem, b->vm.offset), board_now_us(b));
+		if (b->vm.wait == BC_WAIT_POLL) {
+			if (arm_poll_timer(b))
+				board_finish(b, errno);
+			return;
+		}
+		board_run(b);
+		return;
+	}
+
+	struct snvs_mu_reply reply;
+	ssize_t n = recv(b->fd, &reply, sizeof(reply), MSG_DONTWAIT);
+
+	if (n < 0 && errno == EAGAIN)
+		return;
+	if (n <= 0 || (size_t)n != snvs_mu_reply_size(b->sent) || !b->sent) {
+		board_finish(b, n < 0 ? errno : EPIPE);
+		return;
+	}
+	//The read or poll is the last operation; a poll already ran to its end on the controller
+	snvs_bc_feed(&b->vm, reply.results[b->sent - 1].value, 0);
+	board_run(b);
+}
+
+int snvs_async_init(struct snvs_async *loop, const struct snvs_provision_config *config)
+{
+	memset(loop, 0, sizeof(*loop));
+	int len = snvs_bc_compile_provision(config, loop->code, sizeof(loop->code));
+
+	if (len < 0) {
+		errno = ENOSPC;
+		return -1;
+	}
+	loop->len = len;
+	loop->record.policy = (config->hard_locks ? GPR_POLICY_HARD_LOCKS : 0) |
+		((config->master_key_sel & MASTER_KEY_SEL_MASK) << GPR_POLICY_MKS_OFFSET);
+	snvs_gpr_fingerprint(config->zmk, config->zmk_words, loop->record.fingerprint);
+
+	loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	return loop->epoll_fd < 0 ? -1 : 0;
+}
+
+int snvs_async_add(struct snvs_async *loop, struct snvs_async_board *board, unsigned int transport, void *mem)
+{
+	struct epoll_event ev = { .events = EPOLLIN, .data.ptr = board };
+	void *user = board->user;
+
+	memset(board, 0, sizeof(*board));
+	board->loop = loop;
+	board->transport = transport;
+	board->mem = mem;
+	board->user = user;
+	board->start_us = now_us();
+
+	if (transport == SNVS_ASYNC_PAGE)
+		board->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	else
+		board->fd = snvs_mu_spawn(&snvs_mu_socket, &board->pid, 1);
+	if (board->fd < 0)
+		return -1;
+	if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, board->fd, &ev)) {
+		int err = errno;
+
+		close(board->fd);
+		if (transport == SNVS_ASYNC_MU)
+			waitpid(board->pid, NULL, 0);
+		errno = err;
+		return -1;
+	}
+
+	snvs_bc_start(&board->vm, loop->code, loop->len);
+	if (++loop->running > loop->peak)
+		loop->peak = loop->running;
+	board_run(board);
+	return 0;
+}
+
+int snvs_async_dispatch(struct snvs_async *loop, int timeout_ms)
+{
+	struct epoll_event events[ASYNC_EVENTS];
+	int i, n;
+
+	if (!loop->running)
+		return 0;
+	n = epoll_wait(loop->epoll_fd, events, ASYNC_EVENTS, timeout_ms);
+	if (n < 0)
+		return errno == EINTR ? (int)loop->running : -1;
+	for (i = 0; i < n; i++)
+		board_event(events[i].data.ptr);
+
+	return loop->running;
+}
+
+void snvs_async_close(struct snvs_async *loop)
+{
+	if (loop->epoll_fd >= 0)
+		close(loop->epoll_fd);
+	loop->epoll_fd = -1;
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	Asynchronous provisioning
+
+	Drives the provisioning sequence of many boards from one thread. Every board runs the
+	provisioning bytecode (snvs_bc.h) in its own resumable interpreter. Where snvs_provision()
+	would block - a register read that has to come back from a controller, a poll for a status
+	bit or for the ZMK zeroization - the board suspends, and the event loop resumes it once its
+	file descriptor is readable. Each board owns one descriptor registered in a single epoll
+	instance; an orchestrator with its own loop adds snvs_async.epoll_fd to its epoll set and
+	calls snvs_async_dispatch(loop, 0) whenever it is readable.
+
+	A board reaches its registers through one of two transports:
+
+		SNVS_ASYNC_PAGE	a mapped register page (the simulator, or /dev/mem for the board
+				the tool runs on). Reads complete at once; a poll that is not
+				satisfied reads again when a timerfd fires every SNVS_ASYNC_POLL_US.
+		SNVS_ASYNC_MU	a messaging unit controller stand-in per board (snvs_mu.h), each on
+				a simulator of its own (ZMK_SIM_STATE does not apply). Writes
+				are queued and travel with the next read; reads and polls are round
+				trips, and a poll waits on the controller side.
+
+	Steps are recorded in SNVS_LPGPR as with snvs_provision(), written without the read back.
+*/
+
+#ifndef SNVS_ASYNC_H
+#define SNVS_ASYNC_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "libsnvs.h"
+#include "snvs_bc.h"
+#include "snvs_gpr.h"
+#include "snvs_mu.h"
+
+#define SNVS_ASYNC_POLL_US		50
+
+enum snvs_async_transport {
+	SNVS_ASYNC_PAGE,
+	SNVS_ASYNC_MU,
+};
+
+struct snvs_async;
+
+struct snvs_async_board {
+	struct snvs_async *loop;
+	unsigned int transport;		/* enum snvs_async_transport */
+	struct snvs_bc_vm vm;
+	void *mem;			/* SNVS_ASYNC_PAGE */
+	int fd;				/* controller socket, or poll timer of a page */
+	pid_t pid;			/* controller stand-in */
+	struct snvs_mu_request request;	/* writes queued for the controller */
+	unsigned int step;		/* last step recorded */
+	int zeroized;			/* the ZMK read as zero before the B.8 poll timed out */
+	unsigned int sent;		/* operations of the request waiting for its reply */
+	int error;			/* errno when the controller was lost */
+	unsigned int round_trips;
+	unsigned int suspensions;
+	uint64_t start_us, end_us;
+	uint64_t suspended_us;		/* when the poll timer of a page was armed */
+	int done;
+	void *user;
+};
+
+struct snvs_async {
+	int epoll_fd;
+	uint8_t code[SNVS_BC_MAX];
+	size_t len;
+	struct snvs_gpr_record record;	/* policy and key fingerprint of the step records */
+	unsigned int running;
+	unsigned int peak;		/* most boards in flight at once */
+	void (*done)(struct snvs_async_board *board);
+};
+
+/* Compile the sequence for config and create the epoll instance; returns 0 or -1 */
+int snvs_async_init(struct snvs_async *loop, const struct snvs_provision_config *config);
+
+/*
+ * Start provisioning a board; it runs until it first has to wait. mem is the register page of
+ * SNVS_ASYNC_PAGE, SNVS_ASYNC_MU forks its controller stand-in. Returns 0 or -1.
+ */
+int snvs_async_add(struct snvs_async *loop, struct snvs_async_board *board, unsigned int transport, void *mem);
+
+/* Wait up to timeout_ms (-1 forever) and resume the boards that can go on; returns the boards still running */
+int snvs_async_dispatch(struct snvs_async *loop, int timeout_ms);
+
+void snvs_async_close(struct snvs_async *loop);
+
+#endif /* SNVS_ASYNC_H */
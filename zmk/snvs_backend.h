@@ -0,0 +1,83 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	SNVS register backends
+
+	read_SNVS_reg() and write_SNVS_reg() reach the registers through a mapped page: /dev/mem or
+	the simulator (snvs_sim). On SoCs where SNVS sits behind a security controller there is no
+	page to map, and a backend carries the accesses instead. While snvs_backend is set every
+	register access of the process goes to it; the page returned by snvs_open() is then only a
+	placeholder. Like snvs_sim it is a process wide switch.
+
+	read_many and poll let a backend run a whole group of accesses in one exchange; snvs_lib.c
+	uses them for snapshots and snvs_poll(). flush pushes accesses the backend still holds.
+	provision hands the whole A/B sequence to the other side in one exchange.
+
+	A backend that loses the other side does not end the process. It latches the error: reads
+	return SNVS_BACKEND_POISON, writes are dropped, poll fails, and flush (and so snvs_flush()
+	and snvs_provision()) returns -1 until it is detached. What to do then is up to the caller.
+*/
+
+#ifndef SNVS_BACKEND_H
+#define SNVS_BACKEND_H
+
+#include <stdint.h>
+
+struct snvs_provision_config;
+
+//Value of every read once the other side is lost; all lock bits set, so no sequence goes ahead
+#define SNVS_BACKEND_POISON		0xFFFFFFFF
+
+struct snvs_backend_stats {
+	uint64_t round_trips;		//exchanges that waited for the other side
+	uint64_t messages;		//messages sent, including the ones nobody waited for
+	uint64_t ops;			//register operations carried
+	uint64_t world_switches;	//entries into and returns from a trusted execution environment
+};
+
+struct snvs_backend {
+	const char *name;
+	unsigned int (*read)(unsigned int offset);
+	void (*write)(unsigned int offset, unsigned int value);
+	void (*read_many)(const unsigned int *offsets, uint32_t *values, unsigned int count);
+	int (*poll)(unsigned int offset, uint32_t mask, uint32_t value, unsigned int timeout_us);
+	int (*flush)(void);		//0, or -1 once the other side is lost
+	void (*stats)(struct snvs_backend_stats *stats);
+	/* Optional: run snvs_provision() on the other side as a whole, returns its result */
+	int (*provision)(const struct snvs_provision_config *config);
+};
+
+extern const struct snvs_backend *snvs_backend;
+
+#endif /* SNVS_BACKEND_H */
@@ -0,0 +1,219 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "snvs.h"
+#include "snvs_bc.h"
+
+//Instructions a program may execute before it is considered to be looping
+#define BC_MAX_EXECUTED			(1U << 20)
+
+const uint8_t snvs_bc_length[BC_OPCODES] = {
+	[BC_END] = 1, [BC_FAIL] = 2, [BC_READ] = 3, [BC_WRITE] = 7, [BC_MODIFY] = 11, [BC_POLL] = 15,
+	[BC_BEQ] = 11, [BC_BNE] = 11, [BC_BLT] = 11, [BC_JMP] = 3, [BC_STEP] = 2,
+};
+
+static inline uint32_t u16(const uint8_t *p)
+{
+	return p[0] | p[1] << 8;
+}
+
+static inline uint32_t u32(const uint8_t *p)
+{
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline int bad_offset(uint32_t offset)
+{
+	return (offset & 3) || offset >= SNVS_PAGE_SIZE;
+}
+
+void snvs_bc_start(struct snvs_bc_vm *vm, const uint8_t *code, size_t len)
+{
+	memset(vm, 0, sizeof(*vm));
+	vm->code = code;
+	vm->len = len;
+	vm->fail = BC_FAIL_MALFORMED;
+}
+
+static unsigned int bc_stop(struct snvs_bc_vm *vm, unsigned int fail)
+{
+	vm->fail = fail;
+	vm->stopped = 1;
+	vm->wait = BC_WAIT_NONE;
+	return BC_WAIT_NONE;
+}
+
+unsigned int snvs_bc_resume(struct snvs_bc_vm *vm, const struct snvs_bc_io *io)
+{
+	const uint8_t *code = vm->code;
+	uint32_t offset;
+	size_t next;
+
+	if (vm->stopped || vm->wait != BC_WAIT_NONE)
+		return vm->wait;
+
+	for (;;) {
+		size_t pc = vm->pc;
+
+		if (pc >= vm->len || code[pc] >= BC_OPCODES || snvs_bc_length[code[pc]] > vm->len - pc ||
+		    vm->executed == BC_MAX_EXECUTED)
+			return bc_stop(vm, BC_FAIL_MALFORMED);
+
+		const uint8_t *p = code + pc + 1;
+		next = pc + snvs_bc_length[code[pc]];
+		vm->executed++;
+
+		switch (code[pc]) {
+		case BC_END:
+			return bc_stop(vm, BC_FAIL_NONE);
+		case BC_FAIL:
+			return bc_stop(vm, p[0] ? p[0] : BC_FAIL_MALFORMED);
+		case BC_READ:
+		case BC_POLL:
+			if (bad_offset(offset = u16(p)))
+				return bc_stop(vm, BC_FAIL_MALFORMED);
+			//The instruction completes in snvs_bc_feed()
+			vm->offset = offset;
+			vm->wait = code[pc] == BC_READ ? BC_WAIT_READ : BC_WAIT_POLL;
+			return vm->wait;
+		case BC_WRITE:
+			if (bad_offset(offset = u16(p)))
+				return bc_stop(vm, BC_FAIL_MALFORMED);
+			vm->a = u32(p + 2);
+			io->write(io->ctx, offset, vm->a);
+			break;
+		case BC_MODIFY:
+			if (bad_offset(offset = u16(p)))
+				return bc_stop(vm, BC_FAIL_MALFORMED);
+			vm->a = (vm->a & ~u32(p + 2)) | u32(p + 6);
+			if (io->modify)
+				io->modify(io->ctx, offset, u32(p + 2), u32(p + 6));
+			else
+				io->write(io->ctx, offset, vm->a);
+			break;
+		case BC_BEQ:
+			if ((vm->a & u32(p)) == u32(p + 4))
+				next += (int16_t)u16(p + 8);
+			break;
+		case BC_BNE:
+			if ((vm->a & u32(p)) != u32(p + 4))
+				next += (int16_t)u16(p + 8);
+			break;
+		case BC_BLT:
+			if ((vm->a & u32(p)) < u32(p + 4))
+				next += (int16_t)u16(p + 8);
+			break;
+		case BC_JMP:
+			next += (int16_t)u16(p);
+			break;
+		case BC_STEP:
+			if (io->step)
+				io->step(io->ctx, p[0]);
+			break;
+		}
+		vm->pc = next;
+	}
+}
+
+void snvs_bc_feed(struct snvs_bc_vm *vm, uint32_t value, uint64_t now_us)
+{
+	const uint8_t *p = vm->code + vm->pc + 1;
+
+	if (vm->wait == BC_WAIT_NONE)
+		return;
+	vm->a = value;
+	if (vm->wait == BC_WAIT_POLL && now_us) {
+		if (!vm->deadline_us)
+			vm->deadline_us = now_us + u32(p + 10);
+		if ((value & u32(p + 2)) != u32(p + 6) && now_us < vm->deadline_us)
+			return;
+	}
+	vm->deadline_us = 0;
+	vm->pc += snvs_bc_length[vm->code[vm->pc]];
+	vm->wait = BC_WAIT_NONE;
+}
+
+void snvs_bc_poll_args(const struct snvs_bc_vm *vm, uint32_t *mask, uint32_t *value, uint32_t *timeout_us)
+{
+	const uint8_t *p = vm->code + vm->pc + 1;
+
+	*mask = u32(p + 2);
+	*value = u32(p + 6);
+	*timeout_us = u32(p + 10);
+}
+
+struct bc_run_ctx {
+	void *mem;
+	const struct snvs_bc_host *host;
+};
+
+static void bc_run_write(void *ctx, unsigned int offset, uint32_t value)
+{
+	write_SNVS_reg(((struct bc_run_ctx *)ctx)->mem, offset, value);
+}
+
+/* In process, MODIFY takes the update lock like every other read-modify-write (snvs_atomic) */
+static void bc_run_modify(void *ctx, unsigned int offset, uint32_t clear, uint32_t set)
+{
+	modify_SNVS_reg(((struct bc_run_ctx *)ctx)->mem, offset, clear, set);
+}
+
+static void bc_run_step(void *ctx, unsigned int step)
+{
+	const struct snvs_bc_host *host = ((struct bc_run_ctx *)ctx)->host;
+
+	if (host && host->step)
+		host->step(host->ctx, step);
+}
+
+int snvs_bc_run(const uint8_t *code, size_t len, void *mem, const struct snvs_bc_host *host, struct snvs_bc_result *result)
+{
+	struct bc_run_ctx ctx = { mem, host };
+	const struct snvs_bc_io io = { &ctx, bc_run_write, bc_run_step, bc_run_modify };
+	struct snvs_bc_vm vm;
+	unsigned int wait;
+
+	snvs_bc_start(&vm, code, len);
+	while ((wait = snvs_bc_resume(&vm, &io)) != BC_WAIT_NONE) {
+		uint32_t value = read_SNVS_reg(mem, vm.offset);
+
+		snvs_bc_feed(&vm, value, wait == BC_WAIT_POLL && host && host->now_us ? host->now_us(host->ctx) : 0);
+	}
+
+	result->fail = vm.fail;
+	result->pc = vm.pc;
+	result->executed = vm.executed;
+	return vm.fail == BC_FAIL_NONE ? 0 : -1;
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	Provisioning bytecode
+
+	The A/B sequence compiled into a compact bytecode, so the same logic runs wherever a small
+	interpreter can be linked (Linux user space, an early boot stage, a trusted application)
+	without porting snvs_provision(). The interpreter keeps one 32-bit accumulator (A), never
+	allocates, does no I/O of its own and touches SNVS only through read_SNVS_reg(),
+	write_SNVS_reg() and, for MODIFY, modify_SNVS_reg(). Progress is handed to the host through a step callback, which is where a
+	host logs or records the step in SNVS_LPGPR.
+
+	Instructions are one opcode byte followed by little-endian operands:
+
+		END					stop, success
+		FAIL	code8				stop with code
+		READ	off16				A = reg
+		WRITE	off16 imm32			reg = A = imm
+		MODIFY	off16 clear32 set32		reg = A = (A & ~clear) | set
+		POLL	off16 mask32 val32 us32		A = reg until (A & mask) == val or us passed
+		BEQ	mask32 imm32 rel16		branch if (A & mask) == imm
+		BNE	mask32 imm32 rel16		branch if (A & mask) != imm
+		BLT	mask32 imm32 rel16		branch if (A & mask) < imm
+		JMP	rel16				branch
+		STEP	step8				host->step(step), enum snvs_step
+
+	Branch offsets are relative to the next instruction. snvs_bc_run() checks every operand and
+	branch target against the code length, so a corrupt program stops instead of running away.
+
+	snvs_bc_run() executes a program in one go. The same interpreter is also resumable: state
+	lives in a struct snvs_bc_vm, snvs_bc_resume() runs until the program needs a register value
+	and returns, and snvs_bc_feed() hands the value in. A caller that has to wait for the value
+	(a controller round trip, a poll interval) keeps the VM and carries on with other work.
+*/
+
+#ifndef SNVS_BC_H
+#define SNVS_BC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libsnvs.h"
+
+//Longest program snvs_bc_compile_provision() produces is well below this
+#define SNVS_BC_MAX			1024
+
+enum snvs_bc_opcode {
+	BC_END, BC_FAIL, BC_READ, BC_WRITE, BC_MODIFY, BC_POLL, BC_BEQ, BC_BNE, BC_BLT, BC_JMP, BC_STEP,
+	BC_OPCODES
+};
+
+enum snvs_bc_fail {
+	BC_FAIL_NONE,
+	BC_FAIL_SSM,			//A.1 SSM not in a functional state
+	BC_FAIL_TAMPER,			//A.4 policy did not stick
+	BC_FAIL_HWP,			//B.1 ZMK in hardware programming mode
+	BC_FAIL_LOCKED,			//B.2 ZMK or MASTER_KEY_SEL locked
+	BC_FAIL_VERIFY,			//B.4 ZMK read back differs
+	BC_FAIL_LOCKS,			//B.7/B.8 lock bits did not stick
+	BC_FAIL_MALFORMED = 255,	//bad opcode, operand or branch target
+};
+
+//Length of each instruction, opcode included
+extern const uint8_t snvs_bc_length[BC_OPCODES];
+
+struct snvs_bc_host {
+	void *ctx;
+	void (*step)(void *ctx, unsigned int step);
+	uint64_t (*now_us)(void *ctx);	//needed by POLL; without it a poll reads once
+};
+
+enum snvs_bc_wait {
+	BC_WAIT_NONE,			//program stopped, see vm->fail
+	BC_WAIT_READ,			//needs the value of register vm->offset
+	BC_WAIT_POLL,			//POLL not satisfied yet, needs a fresh value of vm->offset
+};
+
+struct snvs_bc_vm {
+	const uint8_t *code;
+	size_t len;
+	size_t pc;
+	uint32_t a;
+	unsigned int executed;
+	unsigned int fail;		//enum snvs_bc_fail once stopped
+	unsigned int wait;		//enum snvs_bc_wait
+	unsigned int offset;		//register waited for
+	uint64_t deadline_us;		//end of the POLL in progress, 0 before its first value
+	int stopped;
+};
+
+//Register writes and steps of a resumable run
+struct snvs_bc_io {
+	void *ctx;
+	void (*write)(void *ctx, unsigned int offset, uint32_t value);
+	void (*step)(void *ctx, unsigned int step);
+	/* Optional: MODIFY as a read-modify-write of the register's current value, else write(A) */
+	void (*modify)(void *ctx, unsigned int offset, uint32_t clear, uint32_t set);
+};
+
+struct snvs_bc_result {
+	unsigned int fail;		//enum snvs_bc_fail
+	unsigned int pc;		//offset of the instruction that stopped the program
+	unsigned int executed;		//instructions executed
+};
+
+/* Compile the sequence for config into code; returns the length, or -1 if size is too small */
+int snvs_bc_compile_provision(const struct snvs_provision_config *config, uint8_t *code, size_t size);
+
+/* Run a program against mem; returns 0 on END, -1 otherwise (see result->fail) */
+int snvs_bc_run(const uint8_t *code, size_t len, void *mem, const struct snvs_bc_host *host, struct snvs_bc_result *result);
+
+void snvs_bc_start(struct snvs_bc_vm *vm, const uint8_t *code, size_t len);
+
+/* Run until the program stops (BC_WAIT_NONE) or waits for a register value */
+unsigned int snvs_bc_resume(struct snvs_bc_vm *vm, const struct snvs_bc_io *io);
+
+/*
+ * Value of vm->offset for the instruction waiting. now_us bounds a POLL; with 0 (no clock,
+ * or a poll the caller already ran to its end) the value completes the POLL.
+ */
+void snvs_bc_feed(struct snvs_bc_vm *vm, uint32_t value, uint64_t now_us);
+
+/* Operands of the POLL a VM waits in, for callers that run the poll elsewhere */
+void snvs_bc_poll_args(const struct snvs_bc_vm *vm, uint32_t *mask, uint32_t *value, uint32_t *timeout_us);
+
+/* Print one instruction at pc; returns its length, or 0 if it is malformed */
+size_t snvs_bc_disassemble(const uint8_t *code, size_t len, size_t pc, char *buf, size_t size);
+
+const char *snvs_bc_fail_name(unsigned int fail);
+
+#endif /* SNVS_BC_H */
@@ -0,0 +1,328 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+
+#include "snvs.h"
+#include "snvs_bc.h"
+#include "snvs_mkey.h"
+#include "snvs_tamper.h"
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+/* Program being built; overflow is sticky so the emitters need no error paths */
+struct bc_emit {
+	uint8_t *code;
+	size_t size;
+	size_t len;
+	int overflow;
+};
+
+static void put8(struct bc_emit *e, uint32_t v)
+{
+	if (e->len < e->size)
+		e->code[e->len++] = v;
+	else
+		e->overflow = 1;
+}
+
+static void put16(struct bc_emit *e, uint32_t v)
+{
+	put8(e, v & 0xff);
+	put8(e, v >> 8);
+}
+
+static void put32(struct bc_emit *e, uint32_t v)
+{
+	put16(e, v & 0xffff);
+	put16(e, v >> 16);
+}
+
+static void op_read(struct bc_emit *e, unsigned int offset)
+{
+	put8(e, BC_READ);
+	put16(e, offset);
+}
+
+static void op_write(struct bc_emit *e, unsigned int offset, uint32_t value)
+{
+	put8(e, BC_WRITE);
+	put16(e, offset);
+	put32(e, value);
+}
+
+static void op_modify(struct bc_emit *e, unsigned int offset, uint32_t clear, uint32_t set)
+{
+	put8(e, BC_MODIFY);
+	put16(e, offset);
+	put32(e, clear);
+	put32(e, set);
+}
+
+/* Same register accesses as snvs_set_bits() */
+static void op_set_bits(struct bc_emit *e, unsigned int offset, uint32_t bits)
+{
+	op_read(e, offset);
+	op_modify(e, offset, 0, bits);
+}
+
+static void op_poll(struct bc_emit *e, unsigned int offset, uint32_t mask, uint32_t value, uint32_t timeout_us)
+{
+	put8(e, BC_POLL);
+	put16(e, offset);
+	put32(e, mask);
+	put32(e, value);
+	put32(e, timeout_us);
+}
+
+static void op_byte(struct bc_emit *e, enum snvs_bc_opcode op, unsigned int arg)
+{
+	put8(e, op);
+	put8(e, arg);
+}
+
+/* Conditional branch to a label bound later; returns the position of its offset */
+static size_t op_branch(struct bc_emit *e, enum snvs_bc_opcode op, uint32_t mask, uint32_t imm)
+{
+	put8(e, op);
+	put32(e, mask);
+	put32(e, imm);
+	size_t at = e->len;
+	put16(e, 0);
+	return at;
+}
+
+/* Point the branch whose offset is at 'at' to the current position */
+static void bind(struct bc_emit *e, size_t at)
+{
+	size_t rel = e->len - (at + 2);
+
+	if (e->overflow || rel > INT16_MAX) {
+		e->overflow = 1;
+		return;
+	}
+	e->code[at] = rel & 0xff;
+	e->code[at + 1] = rel >> 8;
+}
+
+/* Fail with code unless (A & mask) == imm */
+static void op_expect(struct bc_emit *e, uint32_t mask, uint32_t imm, enum snvs_bc_fail code)
+{
+	size_t ok = op_branch(e, BC_BEQ, mask, imm);
+	op_byte(e, BC_FAIL, code);
+	bind(e, ok);
+}
+
+/*
+ * The register accesses and SNVS_LPGPR step records of snvs_provision() on a board that has not
+ * been provisioned yet; the resume logic and the log stay with the host.
+ */
+int snvs_bc_compile_provision(const struct snvs_provision_config *config, uint8_t *code, size_t size)
+{
+	struct bc_emit e = { code, size, 0, 0 };
+	unsigned int reg[SNVS_TAMPER_MAX_REGS], mask[SNVS_TAMPER_MAX_REGS], value[SNVS_TAMPER_MAX_REGS];
+	unsigned int i, lock_reg = config->hard_locks ? SNVS_LPLR : SNVS_HPLR;
+	size_t fail, ok[3];
+
+	if (!config->zmk_words || config->zmk_words > ARRAY_SIZE(config->zmk))
+		return -1;
+
+	//A.1 SSM in a functional state: non-secure, trusted or secure
+	op_read(&e, SNVS_HPSR);
+	fail = op_branch(&e, BC_BLT, SSM_ST_MASK, 0xb << SSM_ST_OFFSET);
+	ok[0] = op_branch(&e, BC_BEQ, SSM_ST_MASK, 0xb << SSM_ST_OFFSET);
+	ok[1] = op_branch(&e, BC_BEQ, SSM_ST_MASK, 0xd << SSM_ST_OFFSET);
+	ok[2] = op_branch(&e, BC_BEQ, SSM_ST_MASK, 0xf << SSM_ST_OFFSET);
+	bind(&e, fail);
+	op_byte(&e, BC_FAIL, BC_FAIL_SSM);
+	for (i = 0; i < 3; i++)
+		bind(&e, ok[i]);
+
+	//A.2, A.3
+	op_set_bits(&e, SNVS_LPPGDR, POWER_GLITCH_VALUE);
+	op_set_bits(&e, SNVS_LPSR, PGD_MASK);
+	op_byte(&e, BC_STEP, STEP_A3);
+
+	//A.4 as snvs_tamper_apply(): write only what differs, verify what was written
+	int n = snvs_tamper_merge(snvs_default_tamper_policy, snvs_default_tamper_policy_len, reg, mask, value);
+	if (n < 0)
+		return -1;
+	for (i = 0; i < (unsigned int)n; i++) {
+		op_read(&e, reg[i]);
+		size_t skip = op_branch(&e, BC_BEQ, mask[i], value[i]);
+		op_modify(&e, reg[i], mask[i], value[i]);
+		op_read(&e, reg[i]);
+		op_expect(&e, mask[i], value[i], BC_FAIL_TAMPER);
+		bind(&e, skip);
+	}
+	op_byte(&e, BC_STEP, STEP_A4);
+
+	//B.1, B.2
+	op_read(&e, SNVS_LPMKCR);
+	op_expect(&e, ZMK_HWP_MASK, 0, BC_FAIL_HWP);
+	op_read(&e, SNVS_HPLR);
+	op_expect(&e, ZMK_WSL_MASK | ZMK_RSL_MASK | MKS_SL_MASK, 0, BC_FAIL_LOCKED);
+	op_read(&e, SNVS_LPLR);
+	op_expect(&e, ZMK_WHL_MASK | ZMK_RHL_MASK | MKS_HL_MASK, 0, BC_FAIL_LOCKED);
+
+	//B.3, B.4
+	for (i = 0; i < config->zmk_words; i++)
+		op_write(&e, SNVS_LPZMKRn + 4 * i, config->zmk[i]);
+	for (i = 0; i < config->zmk_words; i++) {
+		op_read(&e, SNVS_LPZMKRn + 4 * i);
+		op_expect(&e, ~0U, config->zmk[i], BC_FAIL_VERIFY);
+	}
+
+	//B.5, B.6
+	op_set_bits(&e, SNVS_LPMKCR, ZMK_VAL_MASK);
+	op_byte(&e, BC_STEP, STEP_B5);
+	op_set_bits(&e, SNVS_LPMKCR, ZMK_ECC_EN);
+
+	//B.7, B.8: both locks in one read-modify-write, then wait for the ZMK to read as zero
+	uint32_t locks = config->hard_locks ? ZMK_RHL_MASK | ZMK_WHL_MASK : ZMK_RSL_MASK | ZMK_WSL_MASK;
+	op_set_bits(&e, lock_reg, locks);
+	op_read(&e, lock_reg);
+	op_expect(&e, locks, locks, BC_FAIL_LOCKS);
+	op_poll(&e, SNVS_LPZMKRn, ~0U, 0, config->zeroize_timeout_us ? config->zeroize_timeout_us : SNVS_ZEROIZE_TIMEOUT_US);
+	op_byte(&e, BC_STEP, STEP_B8);
+
+	//B.9, B.10
+	op_set_bits(&e, SNVS_LPMKCR, config->master_key_sel & MASTER_KEY_SEL_MASK);
+	op_set_bits(&e, SNVS_HPCOMR, MKS_EN_MASK);
+	op_byte(&e, BC_STEP, STEP_B9);
+	op_set_bits(&e, lock_reg, config->hard_locks ? MKS_HL_MASK : MKS_SL_MASK);
+	op_byte(&e, BC_STEP, STEP_DONE);
+	put8(&e, BC_END);
+
+	return e.overflow ? -1 : (int)e.len;
+}
+
+static const char * const bc_names[BC_OPCODES] = {
+	"END", "FAIL", "READ", "WRITE", "MODIFY", "POLL", "BEQ", "BNE", "BLT", "JMP", "STEP",
+};
+
+static uint32_t get16(const uint8_t *p)
+{
+	return p[0] | p[1] << 8;
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+	return get16(p) | get16(p + 2) << 16;
+}
+
+static const char *reg_name(unsigned int offset, char *buf, size_t size)
+{
+	const struct snvs_reg *reg = snvs_reg_lookup(offset);
+
+	if (!reg)
+		snprintf(buf, size, "0x%03x", offset);
+	else if (reg->count > 1)
+		snprintf(buf, size, "%s[%u]", reg->name, (offset - reg->offset) / 4);
+	else
+		snprintf(buf, size, "%s", reg->name);
+	return buf;
+}
+
+size_t snvs_bc_disassemble(const uint8_t *code, size_t len, size_t pc, char *buf, size_t size)
+{
+	char name[48];
+
+	if (pc >= len || code[pc] >= BC_OPCODES || snvs_bc_length[code[pc]] > len - pc)
+		return 0;
+
+	const uint8_t *p = code + pc + 1;
+	size_t next = pc + snvs_bc_length[code[pc]];
+	int n = snprintf(buf, size, "%04zx  %-7s", pc, bc_names[code[pc]]);
+	if (n < 0 || (size_t)n >= size)
+		return next - pc;
+	buf += n;
+	size -= n;
+
+	switch (code[pc]) {
+	case BC_FAIL:
+		snprintf(buf, size, "%s", snvs_bc_fail_name(p[0]));
+		break;
+	case BC_STEP:
+		snprintf(buf, size, "%s", snvs_step_name(p[0]));
+		break;
+	case BC_READ:
+		snprintf(buf, size, "%s", reg_name(get16(p), name, sizeof(name)));
+		break;
+	case BC_WRITE:
+		snprintf(buf, size, "%s, 0x%x", reg_name(get16(p), name, sizeof(name)), get32(p + 2));
+		break;
+	case BC_MODIFY:
+		snprintf(buf, size, "%s, clear 0x%x, set 0x%x", reg_name(get16(p), name, sizeof(name)), get32(p + 2), get32(p + 6));
+		break;
+	case BC_POLL:
+		snprintf(buf, size, "%s, mask 0x%x, 0x%x, %u us", reg_name(get16(p), name, sizeof(name)),
+			get32(p + 2), get32(p + 6), get32(p + 10));
+		break;
+	case BC_BEQ:
+	case BC_BNE:
+	case BC_BLT:
+		snprintf(buf, size, "mask 0x%x, 0x%x -> %04zx", get32(p), get32(p + 4), next + (int16_t)get16(p + 8));
+		break;
+	case BC_JMP:
+		snprintf(buf, size, "-> %04zx", next + (int16_t)get16(p));
+		break;
+	default:
+		*buf = 0;
+		break;
+	}
+
+	return next - pc;
+}
+
+const char *snvs_bc_fail_name(unsigned int fail)
+{
+	switch (fail) {
+	case BC_FAIL_NONE:
+		return "none";
+	case BC_FAIL_SSM:
+		return "SSM not in a functional state (A.1)";
+	case BC_FAIL_TAMPER:
+		return "tamper policy did not stick (A.4)";
+	case BC_FAIL_HWP:
+		return "ZMK in hardware programming mode (B.1)";
+	case BC_FAIL_LOCKED:
+		return "ZMK or MASTER_KEY_SEL locked (B.2)";
+	case BC_FAIL_VERIFY:
+		return "ZMK read back differs (B.4)";
+	case BC_FAIL_LOCKS:
+		return "ZMK lock bits did not stick (B.7/B.8)";
+	default:
+		return "malformed program";
+	}
+}
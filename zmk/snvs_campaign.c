@@ -0,0 +1,345 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "snvs.h"
+#include "snvs_sim.h"
+#include "snvs_mkey.h"
+#include "snvs_backend.h"
+#include "snvs_script.h"
+#include "snvs_campaign.h"
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+static const char * const outcome_names[] = { "masked", "detected", "silent" };
+static const char * const recovery_names[] = { "none", "retry", "system reset", "POR", "failed" };
+
+const char *snvs_outcome_name(unsigned int outcome)
+{
+	return outcome < OUTCOMES ? outcome_names[outcome] : "unknown";
+}
+
+const char *snvs_recovery_name(unsigned int recovery)
+{
+	return recovery < RECOVERIES ? recovery_names[recovery] : "unknown";
+}
+
+static int parse_when(const char *when, struct snvs_fault *fault)
+{
+	unsigned int step;
+	char *end;
+
+	for (step = STEP_A1; step < STEP_DONE; step++) {
+		if (!strcmp(when, snvs_step_name(step))) {
+			fault->trigger = FAULT_AT_STEP;
+			fault->at = step;
+			return 0;
+		}
+	}
+	fault->trigger = FAULT_AT_ACCESS;
+	fault->at = strtoul(when, &end, 0);
+	return *when && !*end ? 0 : -1;
+}
+
+int snvs_fault_parse(const char *spec, struct snvs_fault *fault)
+{
+	char buf[SNVS_FAULT_SPEC_MAX];
+	struct snvs_op op;
+	char *arg, *when, *end, *count;
+	unsigned int kind;
+
+	if (strlen(spec) >= sizeof(buf))
+		goto bad;
+	strcpy(buf, spec);
+	memset(fault, 0, sizeof(*fault));
+
+	when = strchr(buf, '@');
+	if (when) {
+		*when++ = '\0';
+		if (parse_when(when, fault))
+			goto bad;
+	}
+	arg = strchr(buf, '=');
+	if (arg)
+		*arg++ = '\0';
+
+	for (kind = 0; kind < FAULT_KINDS && strcmp(buf, snvs_fault_kind_name(kind)); kind++)
+		;
+	fault->kind = kind;
+	switch (kind) {
+	case FAULT_ZEROIZE:
+		if (arg)
+			goto bad;
+		return 0;
+	case FAULT_SSM:
+		if (!arg)
+			goto bad;
+		fault->value = strtoul(arg, &end, 0);
+		if (*end || fault->value > (SSM_ST_MASK >> SSM_ST_OFFSET))
+			goto bad;
+		return 0;
+	case FAULT_STUCK:
+		count = arg ? strrchr(arg, ':') : NULL;
+		if (!count || (strcmp(count, ":0") && strcmp(count, ":1")))
+			goto bad;
+		*count = '\0';
+		if (snvs_script_resolve(arg, &op))
+			goto bad;
+		fault->offset = op.offset;
+		fault->mask = op.mask;
+		fault->value = count[1] == '1' ? op.mask : 0;
+		return 0;
+	case FAULT_DROP:
+		if (!arg)
+			goto bad;
+		fault->value = 1;
+		count = strchr(arg, ':');
+		if (count) {
+			*count++ = '\0';
+			fault->value = strtoul(count, &end, 0);
+			if (*end || !fault->value)
+				goto bad;
+		}
+		if (!strcmp(arg, "any"))
+			fault->offset = SNVS_FAULT_ANY;
+		else if (!snvs_script_resolve(arg, &op))
+			fault->offset = op.offset;
+		else
+			goto bad;
+		return 0;
+	case FAULT_DELAY:
+		if (!arg)
+			goto bad;
+		if (!strcmp(arg, "never")) {
+			fault->value = SNVS_FAULT_NEVER;
+			return 0;
+		}
+		fault->value = strtoul(arg, &end, 0);
+		if (*end || fault->value == SNVS_FAULT_NEVER)
+			goto bad;
+		return 0;
+	}
+
+bad:
+	fprintf(stderr, "fault: cannot parse '%s'\n", spec);
+	return -1;
+}
+
+static const char *reg_name(unsigned int offset, uint32_t mask, const char **field)
+{
+	const struct snvs_reg *reg = snvs_reg_lookup(offset);
+	unsigned int i;
+
+	*field = NULL;
+	if (!reg)
+		return "?";
+	for (i = 0; i < reg->nfields; i++)
+		if (reg->fields[i].mask == mask)
+			*field = reg->fields[i].name;
+	return reg->name;
+}
+
+void snvs_fault_format(const struct snvs_fault *fault, char *buf, size_t size)
+{
+	const char *kind = snvs_fault_kind_name(fault->kind), *name, *field;
+	char when[16];
+	int n = 0;
+
+	if (fault->trigger == FAULT_AT_STEP)
+		snprintf(when, sizeof(when), "@%s", snvs_step_name(fault->at));
+	else
+		snprintf(when, sizeof(when), fault->at ? "@%u" : "", fault->at);
+
+	switch (fault->kind) {
+	case FAULT_SSM:
+		n = snprintf(buf, size, "%s=0x%x", kind, fault->value);
+		break;
+	case FAULT_STUCK:
+		name = reg_name(fault->offset, fault->mask, &field);
+		n = snprintf(buf, size, "%s=%s%s%s:%d", kind, name, field ? "." : "", field ? field : "", fault->value != 0);
+		break;
+	case FAULT_DROP:
+		name = fault->offset == SNVS_FAULT_ANY ? "any" : reg_name(fault->offset, 0, &field);
+		n = snprintf(buf, size, fault->value == 1 ? "%s=%s" : "%s=%s:%u", kind, name, fault->value);
+		break;
+	case FAULT_DELAY:
+		if (fault->value == SNVS_FAULT_NEVER)
+			n = snprintf(buf, size, "%s=never", kind);
+		else
+			n = snprintf(buf, size, "%s=%u", kind, fault->value);
+		break;
+	default:
+		n = snprintf(buf, size, "%s", kind);
+		break;
+	}
+	if (n >= 0 && (size_t)n < size)
+		snprintf(buf + n, size - n, "%s", when);
+}
+
+static uint64_t xorshift64(uint64_t *state)
+{
+	uint64_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return *state = x;
+}
+
+//Bits the sequence checks or sets, and registers it writes
+static const struct { unsigned int offset; uint32_t mask; } stuck_bits[] = {
+	{ SNVS_HPLR, ZMK_WSL_MASK }, { SNVS_HPLR, ZMK_RSL_MASK }, { SNVS_HPLR, MKS_SL_MASK },
+	{ SNVS_LPLR, ZMK_WHL_MASK }, { SNVS_LPLR, ZMK_RHL_MASK }, { SNVS_LPLR, MKS_HL_MASK },
+	{ SNVS_LPMKCR, ZMK_HWP_MASK }, { SNVS_LPMKCR, ZMK_VAL_MASK }, { SNVS_LPMKCR, MASTER_KEY_SEL_MASK },
+	{ SNVS_HPCOMR, MKS_EN_MASK },
+};
+static const unsigned int drop_regs[] = {
+	SNVS_LPPGDR, SNVS_LPSR, SNVS_LPZMKRn, SNVS_LPMKCR, SNVS_LPLR, SNVS_HPLR, SNVS_HPCOMR, SNVS_LPGPR, SNVS_FAULT_ANY,
+};
+static const uint32_t ssm_states[] = { 0x1, 0x3, 0x8, 0xb, 0xd, 0xf };
+
+void snvs_fault_random(struct snvs_fault *fault, uint64_t *seed, unsigned int accesses)
+{
+	uint64_t r = xorshift64(seed);
+	unsigned int i;
+
+	memset(fault, 0, sizeof(*fault));
+	fault->kind = r % FAULT_KINDS;
+	r /= FAULT_KINDS;
+	if (r & 1) {
+		fault->trigger = FAULT_AT_STEP;
+		fault->at = STEP_A1 + (r >> 1) % (STEP_DONE - STEP_A1);
+	} else {
+		fault->trigger = FAULT_AT_ACCESS;
+		fault->at = accesses ? (r >> 1) % accesses : 0;
+	}
+
+	r = xorshift64(seed);
+	switch (fault->kind) {
+	case FAULT_SSM:
+		fault->value = ssm_states[r % ARRAY_SIZE(ssm_states)];
+		break;
+	case FAULT_STUCK:
+		i = r % ARRAY_SIZE(stuck_bits);
+		fault->offset = stuck_bits[i].offset;
+		fault->mask = stuck_bits[i].mask;
+		fault->value = (r >> 8) & 1 ? fault->mask : 0;
+		break;
+	case FAULT_DROP:
+		fault->offset = drop_regs[r % ARRAY_SIZE(drop_regs)];
+		fault->value = 1 + (r >> 8) % 3;
+		break;
+	case FAULT_DELAY:
+		//Up to twice the zeroization timeout, one in eight never completes
+		fault->value = (r & 7) ? (r >> 3) % (2 * SNVS_ZEROIZE_TIMEOUT_US * 1000) : SNVS_FAULT_NEVER;
+		break;
+	}
+}
+
+const char *snvs_board_check(snvs_t *snvs, const struct snvs_provision_config *config)
+{
+	uint8_t otpmk[MASTER_KEY_BYTES], zmk[MASTER_KEY_BYTES];
+	uint32_t key[SNVS_LPZMKR_COUNT];
+	void *mem = snvs_base(snvs);
+	unsigned int lock_reg = config->hard_locks ? SNVS_LPLR : SNVS_HPLR;
+	uint32_t locks = config->hard_locks ? ZMK_RHL_MASK | ZMK_WHL_MASK | MKS_HL_MASK : ZMK_RSL_MASK | ZMK_WSL_MASK | MKS_SL_MASK;
+
+	memset(key, 0, sizeof(key));
+	memcpy(key, config->zmk, config->zmk_words * sizeof(key[0]));
+	snvs_sim_keys(mem, otpmk, zmk);
+	if (memcmp(zmk, key, sizeof(zmk)))
+		return "ZMK lost or wrong";
+	if (read_SNVS_reg(mem, SNVS_LPZMKRn))
+		return "ZMK readable";
+	if ((read_SNVS_reg(mem, lock_reg) & locks) != locks)
+		return "ZMK or MASTER_KEY_SEL not locked";
+
+	uint32_t lpmkcr = read_SNVS_reg(mem, SNVS_LPMKCR);
+	if (!(lpmkcr & ZMK_VAL_MASK))
+		return "ZMK not valid";
+	if ((lpmkcr & MASTER_KEY_SEL_MASK) != (config->master_key_sel & MASTER_KEY_SEL_MASK) ||
+		!(read_SNVS_reg(mem, SNVS_HPCOMR) & MKS_EN_MASK))
+		return "wrong master key selection";
+	if (get_value_of_SNVS_reg_field(mem, SNVS_HPSR, SSM_ST_MASK, SSM_ST_OFFSET) < 0xb)
+		return "SSM not in a functional state";
+
+	return NULL;
+}
+
+static int provision(snvs_t *snvs, const struct snvs_provision_config *config, struct snvs_faults *faults)
+{
+	snvs_faults = faults;
+	int ret = snvs_provision(snvs, config);
+	snvs_faults = NULL;
+	return ret;
+}
+
+int snvs_scenario_run(snvs_t *snvs, const struct snvs_provision_config *config, struct snvs_faults *faults,
+	struct snvs_scenario_result *result)
+{
+	struct snvs_provision_config quiet = *config;
+	void *mem = snvs_base(snvs);
+
+	if (!snvs_sim || snvs_backend)
+		return -1;
+	memset(result, 0, sizeof(*result));
+	quiet.log = NULL;
+
+	snvs_sim_power_on_reset(mem);
+	snvs_faults_arm(faults);
+	uint64_t start = snvs_sim_clock(mem);
+	int ret = provision(snvs, config, faults);
+
+	result->accesses = faults->accesses;
+	result->problem = snvs_board_check(snvs, config);
+	result->outcome = ret ? OUTCOME_DETECTED : result->problem ? OUTCOME_SILENT : OUTCOME_MASKED;
+	if (result->outcome == OUTCOME_MASKED)
+		return 0;
+
+	if (faults->fired)
+		start = faults->fired_ns;
+	for (result->recovery = RECOVERY_RETRY; result->recovery < RECOVERY_FAILED; result->recovery++) {
+		if (result->recovery == RECOVERY_SYSTEM_RESET)
+			snvs_sim_system_reset(mem);
+		else if (result->recovery == RECOVERY_POR)
+			snvs_sim_power_on_reset(mem);
+		if (!provision(snvs, &quiet, faults) && !snvs_board_check(snvs, config))
+			break;
+	}
+	result->recovery_ns = snvs_sim_clock(mem) - start;
+
+	return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	Fault campaigns
+
+	Runs the provisioning sequence against the simulator with a fault scenario (snvs_fault.h),
+	checks the board it leaves behind and measures how it recovers. Faults are written as
+
+		KIND[=ARG][@WHEN]
+
+		zeroize			security violation, the ZMK is zeroized
+		ssm=STATE		SNVS_HPSR[SSM_ST] moves to STATE (0x1 hard fail, 0x3 soft fail ...)
+		stuck=REG[.FIELD]:0|1	the bits are stuck at 0 or 1
+		drop=REG[:N]		the next N writes (default 1) of REG are lost; drop=any[:N] any register
+		delay=NS|never		a ZMK read lock zeroizes the ZMK NS later, or never
+
+	WHEN is a step name (A.1 ... B.10) or a register access count; without it the fault fires
+	on the first access.
+
+	A scenario starts from a power-on reset. Its outcome is masked (the sequence succeeded and
+	the board is correct), detected (snvs_provision() failed) or silent (it succeeded, the board
+	is wrong). A board that is not correct is recovered the way a station would: run the
+	sequence again, then after a system reset, then after a power-on reset. The faults stay
+	in place: one that fired does not fire again, stuck bits stay stuck. The recovery latency
+	is the simulated board time from the first fault until the board checks correct; it counts
+	register accesses and polls, not the reset or reboot itself.
+*/
+
+#ifndef SNVS_CAMPAIGN_H
+#define SNVS_CAMPAIGN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libsnvs.h"
+#include "snvs_fault.h"
+
+#define SNVS_FAULT_SPEC_MAX		64
+
+enum snvs_outcome {
+	OUTCOME_MASKED,
+	OUTCOME_DETECTED,
+	OUTCOME_SILENT,
+	OUTCOMES
+};
+
+enum snvs_recovery {
+	RECOVERY_NONE,			/* not needed */
+	RECOVERY_RETRY,
+	RECOVERY_SYSTEM_RESET,
+	RECOVERY_POR,
+	RECOVERY_FAILED,
+	RECOVERIES
+};
+
+struct snvs_scenario_result {
+	unsigned int outcome;		/* enum snvs_outcome */
+	const char *problem;		/* what is wrong with the board after the first run, NULL if nothing */
+	unsigned int recovery;		/* enum snvs_recovery */
+	uint64_t recovery_ns;
+	uint64_t accesses;		/* register accesses of the first run */
+};
+
+const char *snvs_outcome_name(unsigned int outcome);
+const char *snvs_recovery_name(unsigned int recovery);
+
+/* Parse or write one fault; parse returns 0, or -1 with a message on stderr */
+int snvs_fault_parse(const char *spec, struct snvs_fault *fault);
+void snvs_fault_format(const struct snvs_fault *fault, char *buf, size_t size);
+
+/* A random fault of the kinds snvs_provision() can meet, at a step or before one of accesses register accesses */
+void snvs_fault_random(struct snvs_fault *fault, uint64_t *seed, unsigned int accesses);
+
+/* What is wrong with a board config was provisioned on, from the simulator's view; NULL if nothing */
+const char *snvs_board_check(snvs_t *snvs, const struct snvs_provision_config *config);
+
+/*
+ * Run one scenario on the simulated SNVS of snvs. config->log only sees the first run, the
+ * recovery runs are quiet. Returns 0, or -1 if the simulator is not in use.
+ */
+int snvs_scenario_run(snvs_t *snvs, const struct snvs_provision_config *config, struct snvs_faults *faults,
+	struct snvs_scenario_result *result);
+
+#endif /* SNVS_CAMPAIGN_H */
@@ -0,0 +1,610 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "snvs_daemon.h"
+
+#define HANDOFF_VERSION			1
+#define HANDOFF_ACK			'A'
+
+struct daemon_client {
+	int fd;				/* -1 for a free slot */
+	unsigned int len;
+	char buf[SNVS_DAEMON_LINE];	/* start of a request line not received completely */
+};
+
+struct daemon_request {
+	unsigned int client;
+	char board[SNVS_DAEMON_BOARD];
+};
+
+/* Everything a newer daemon needs; the descriptors travel beside it in SCM_RIGHTS */
+struct daemon_handoff {
+	uint32_t version;
+	uint32_t size;
+	uint64_t seq;			/* journal records */
+	uint64_t offset;		/* journal size */
+	uint64_t stop_ns;		/* CLOCK_MONOTONIC when the last board was done */
+	unsigned int count;		/* queued requests, oldest first */
+	struct daemon_client clients[SNVS_DAEMON_CLIENTS];
+	struct daemon_request queue[SNVS_DAEMON_QUEUE];
+};
+
+struct daemon {
+	const struct snvs_daemon_config *config;
+	struct snvs_daemon_stats *stats;
+	int listen_fd;
+	int handoff_fd;
+	int journal_fd;
+	uint64_t seq;
+	uint64_t offset;
+	uint64_t idle_ns;		/* end of the last board */
+	struct daemon_client clients[SNVS_DAEMON_CLIENTS];
+	struct daemon_request queue[SNVS_DAEMON_QUEUE];
+	unsigned int head, count;
+};
+
+static volatile sig_atomic_t daemon_stop;
+
+static void daemon_signal(int sig)
+{
+	daemon_stop = 1;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+__attribute__((format(printf, 2, 3)))
+static void say(const struct daemon *d, const char *fmt, ...)
+{
+	va_list ap;
+
+	if (!d->config->log)
+		return;
+	va_start(ap, fmt);
+	vfprintf(d->config->log, fmt, ap);
+	va_end(ap);
+	fflush(d->config->log);
+}
+
+static int unix_address(struct sockaddr_un *addr, const char *path, const char *suffix)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	if (snprintf(addr->sun_path, sizeof(addr->sun_path), "%s%s", path, suffix) >= (int)sizeof(addr->sun_path)) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	return 0;
+}
+
+static int unix_listen(const char *path, const char *suffix, int type)
+{
+	struct sockaddr_un addr;
+	int fd;
+
+	if (unix_address(&addr, path, suffix))
+		return -1;
+	fd = socket(AF_UNIX, type | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		return -1;
+	unlink(addr.sun_path);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) || listen(fd, SNVS_DAEMON_CLIENTS)) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/* Count the records of an existing journal */
+static int journal_scan(struct daemon *d)
+{
+	char buf[4096];
+	ssize_t n, i;
+
+	d->seq = 0;
+	d->offset = 0;
+	if (lseek(d->journal_fd, 0, SEEK_SET) < 0)
+		return -1;
+	while ((n = read(d->journal_fd, buf, sizeof(buf))) > 0) {
+		for (i = 0; i < n; i++)
+			d->seq += buf[i] == '\n';
+		d->offset += n;
+	}
+	return n < 0 ? -1 : 0;
+}
+
+static int journal_append(struct daemon *d, const char *board, int ok)
+{
+	char line[SNVS_DAEMON_BOARD + 32];
+	int n = snprintf(line, sizeof(line), "%llu %s %s\n", (unsigned long long)d->seq, board, ok ? "OK" : "FAIL");
+
+	if (write(d->journal_fd, line, n) != n || fdatasync(d->journal_fd))
+		return -1;
+	d->seq++;
+	d->offset += n;
+	return 0;
+}
+
+__attribute__((format(printf, 3, 4)))
+static void reply(struct daemon *d, unsigned int i, const char *fmt, ...);
+
+static void client_close(struct daemon *d, unsigned int i)
+{
+	unsigned int j, n = 0;
+
+	close(d->clients[i].fd);
+	d->clients[i].fd = -1;
+	d->clients[i].len = 0;
+
+	//Requests of a station that went away are dropped; its boards never started
+	for (j = 0; j < d->count; j++) {
+		struct daemon_request *r = &d->queue[(d->head + j) % SNVS_DAEMON_QUEUE];
+
+		if (r->client != i)
+			d->queue[(d->head + n++) % SNVS_DAEMON_QUEUE] = *r;
+	}
+	d->count = n;
+}
+
+static void reply(struct daemon *d, unsigned int i, const char *fmt, ...)
+{
+	char line[SNVS_DAEMON_LINE];
+	va_list ap;
+	int n;
+
+	va_start(ap, fmt);
+	n = vsnprintf(line, sizeof(line), fmt, ap);
+	va_end(ap);
+	if (n >= (int)sizeof(line))
+		n = sizeof(line) - 1;
+
+	//A station that does not read its replies is dropped rather than stalling the others
+	if (send(d->clients[i].fd, line, n, MSG_NOSIGNAL | MSG_DONTWAIT) != n)
+		client_close(d, i);
+}
+
+static void client_accept(struct daemon *d)
+{
+	unsigned int i;
+	int fd = accept4(d->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+	if (fd < 0)
+		return;
+	for (i = 0; i < SNVS_DAEMON_CLIENTS; i++)
+		if (d->clients[i].fd < 0)
+			break;
+	if (i == SNVS_DAEMON_CLIENTS) {
+		close(fd);
+		return;
+	}
+	d->clients[i].fd = fd;
+	d->clients[i].len = 0;
+}
+
+static void client_line(struct daemon *d, unsigned int i, char *line)
+{
+	char *board = line + strlen("provision ");
+
+	if (strncmp(line, "provision ", strlen("provision ")) || !*board || strlen(board) >= SNVS_DAEMON_BOARD ||
+	    strpbrk(board, " \t\r")) {
+		reply(d, i, "ERR malformed request\n");
+		return;
+	}
+
+	struct daemon_request *r = &d->queue[(d->head + d->count++) % SNVS_DAEMON_QUEUE];
+
+	r->client = i;
+	strcpy(r->board, board);
+}
+
+/* Take whole lines while there is room in the queue; the rest waits in the buffer */
+static void client_parse(struct daemon *d, unsigned int i)
+{
+	struct daemon_client *c = &d->clients[i];
+	char *start = c->buf, *nl;
+
+	while (d->count < SNVS_DAEMON_QUEUE && (nl = memchr(start, '\n', c->buf + c->len - start))) {
+		*nl = '\0';
+		client_line(d, i, start);
+		if (c->fd < 0)
+			return;
+		start = nl + 1;
+	}
+	c->len -= start - c->buf;
+	memmove(c->buf, start, c->len);
+	if (c->len == sizeof(c->buf) && !memchr(c->buf, '\n', c->len)) {
+		reply(d, i, "ERR request too long\n");
+		if (c->fd >= 0)
+			client_close(d, i);
+	}
+}
+
+static void client_read(struct daemon *d, unsigned int i)
+{
+	struct daemon_client *c = &d->clients[i];
+
+	if (c->len == sizeof(c->buf))
+		return;
+
+	ssize_t n = read(c->fd, c->buf + c->len, sizeof(c->buf) - c->len);
+
+	if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+		client_close(d, i);
+		return;
+	}
+	if (n < 0)
+		return;
+	c->len += n;
+	client_parse(d, i);
+}
+
+static void serve_one(struct daemon *d)
+{
+	struct daemon_request r = d->queue[d->head];
+	char reason[SNVS_DAEMON_LINE] = "";
+
+	d->head = (d->head + 1) % SNVS_DAEMON_QUEUE;
+	d->count--;
+
+	int ret = d->config->provision(d->config->ctx, r.board, reason, sizeof(reason));
+
+	d->stats->boards++;
+	if (ret)
+		d->stats->failed++;
+	if (journal_append(d, r.board, !ret)) {
+		say(d, "[ERROR] \t Journal write failed for %s: %s\n", r.board, strerror(errno));
+		reply(d, r.client, "FAIL %s journal\n", r.board);
+	} else if (ret) {
+		reply(d, r.client, "FAIL %s %s\n", r.board, reason[0] ? reason : "provisioning");
+	} else {
+		reply(d, r.client, "OK %s %llu\n", r.board, (unsigned long long)d->seq - 1);
+	}
+	d->idle_ns = now_ns();
+}
+
+/* Hand everything to the daemon connected on conn; returns 1 once it acknowledged */
+static int handoff_give(struct daemon *d, int conn)
+{
+	int fds[2 + SNVS_DAEMON_CLIENTS];
+	unsigned int i, nfds = 0;
+	char ack = 0;
+
+	struct daemon_handoff *h = calloc(1, sizeof(*h));
+	union {
+		char buf[CMSG_SPACE(sizeof(fds))];
+		struct cmsghdr align;
+	} control;
+
+	if (!h)
+		return 0;
+	h->version = HANDOFF_VERSION;
+	h->size = sizeof(*h);
+	h->seq = d->seq;
+	h->offset = d->offset;
+	h->stop_ns = d->idle_ns;
+	h->count = d->count;
+	for (i = 0; i < d->count; i++)
+		h->queue[i] = d->queue[(d->head + i) % SNVS_DAEMON_QUEUE];
+	fds[nfds++] = d->listen_fd;
+	fds[nfds++] = d->journal_fd;
+	for (i = 0; i < SNVS_DAEMON_CLIENTS; i++) {
+		h->clients[i] = d->clients[i];
+		if (d->clients[i].fd >= 0)
+			fds[nfds++] = d->clients[i].fd;
+	}
+
+	struct iovec iov = { .iov_base = h, .iov_len = sizeof(*h) };
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = control.buf,
+		.msg_controllen = CMSG_SPACE(nfds * sizeof(int)),
+	};
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(nfds * sizeof(int));
+	memcpy(CMSG_DATA(cmsg), fds, nfds * sizeof(int));
+
+	ssize_t n = sendmsg(conn, &msg, MSG_NOSIGNAL);
+
+	free(h);
+	if (n != (ssize_t)sizeof(*h))
+		return 0;
+
+	struct pollfd pfd = { .fd = conn, .events = POLLIN };
+
+	if (poll(&pfd, 1, SNVS_DAEMON_HANDOFF_TIMEOUT_MS) != 1 || read(conn, &ack, 1) != 1 || ack != HANDOFF_ACK)
+		return 0;
+
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+
+	d->stats->handed_to = getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) ? -1 : cred.pid;
+	return 1;
+}
+
+/* Take over from a running daemon; returns 1 when taken over, 0 when there is none, -1 on error */
+static int handoff_take(struct daemon *d)
+{
+	int fds[2 + SNVS_DAEMON_CLIENTS];
+	struct sockaddr_un addr;
+	unsigned int i, nfds = 0, used = 0;
+	int ret = -1;
+
+	if (unix_address(&addr, d->config->socket_path, ".handoff"))
+		return -1;
+
+	int conn = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+
+	if (conn < 0)
+		return -1;
+	if (connect(conn, (struct sockaddr *)&addr, sizeof(addr))) {
+		close(conn);
+		return 0;
+	}
+
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+	pid_t from = getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) ? -1 : cred.pid;
+
+	struct daemon_handoff *h = malloc(sizeof(*h));
+	union {
+		char buf[CMSG_SPACE(sizeof(fds))];
+		struct cmsghdr align;
+	} control;
+	struct iovec iov = { .iov_base = h, .iov_len = sizeof(*h) };
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = control.buf,
+		.msg_controllen = sizeof(control.buf),
+	};
+
+	if (!h) {
+		close(conn);
+		return -1;
+	}
+
+	//The running daemon answers once the board it is on is done
+	ssize_t n = recvmsg(conn, &msg, MSG_CMSG_CLOEXEC);
+	struct cmsghdr *cmsg = n > 0 ? CMSG_FIRSTHDR(&msg) : NULL;
+
+	if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+		nfds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		memcpy(fds, CMSG_DATA(cmsg), nfds * sizeof(int));
+	}
+	for (i = 0; n == (ssize_t)sizeof(*h) && i < SNVS_DAEMON_CLIENTS; i++)
+		used += h->clients[i].fd >= 0;
+
+	if (n != (ssize_t)sizeof(*h) || (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) || h->version != HANDOFF_VERSION ||
+	    h->size != sizeof(*h) || h->count > SNVS_DAEMON_QUEUE || nfds != 2 + used) {
+		say(d, "[ERROR] \t Unusable hand-off from pid %d, it keeps serving\n", (int)from);
+		for (i = 0; i < nfds; i++)
+			close(fds[i]);
+		goto out;
+	}
+
+	//Nothing is touched before the acknowledgement: until then the old daemon still owns it all
+	char ack = HANDOFF_ACK;
+
+	if (write(conn, &ack, 1) != 1) {
+		for (i = 0; i < nfds; i++)
+			close(fds[i]);
+		goto out;
+	}
+
+	d->listen_fd = fds[0];
+	d->journal_fd = fds[1];
+	d->seq = h->seq;
+	d->offset = h->offset;
+	nfds = 2;
+	for (i = 0; i < SNVS_DAEMON_CLIENTS; i++) {
+		d->clients[i] = h->clients[i];
+		if (d->clients[i].fd >= 0) {
+			d->clients[i].fd = fds[nfds++];
+			d->stats->inherited_clients++;
+		}
+	}
+	memcpy(d->queue, h->queue, h->count * sizeof(h->queue[0]));
+	d->head = 0;
+	d->count = h->count;
+	d->stats->inherited_requests = h->count;
+
+	struct stat st;
+
+	if (fstat(d->journal_fd, &st) || (uint64_t)st.st_size != d->offset) {
+		say(d, "[INFO] \t Journal changed during the hand-off, counting its records again\n");
+		journal_scan(d);
+	}
+
+	d->idle_ns = now_ns();
+	d->stats->pause_ms = (d->idle_ns - h->stop_ns) / 1e6;
+	say(d, "[INFO] \t Took over from pid %d: %u stations, %u queued requests, journal at record %llu\n", (int)from,
+		d->stats->inherited_clients, d->count, (unsigned long long)d->seq);
+	say(d, "[INFO] \t Service paused for %.3f ms\n", d->stats->pause_ms);
+	ret = 1;
+out:
+	free(h);
+	close(conn);
+	return ret;
+}
+
+static int daemon_start(struct daemon *d)
+{
+	int ret = handoff_take(d);
+
+	if (ret < 0)
+		return -1;
+	if (!ret) {
+		d->listen_fd = unix_listen(d->config->socket_path, "", SOCK_STREAM);
+		if (d->listen_fd < 0)
+			return -1;
+		d->journal_fd = open(d->config->journal, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+		if (d->journal_fd < 0 || journal_scan(d))
+			return -1;
+		d->idle_ns = now_ns();
+		say(d, "[INFO] \t Serving %s, journal %s at record %llu\n", d->config->socket_path, d->config->journal,
+			(unsigned long long)d->seq);
+	}
+
+	//Rebinding the path leaves the old daemon's hand-off socket unreachable, which it no longer needs
+	d->handoff_fd = unix_listen(d->config->socket_path, ".handoff", SOCK_SEQPACKET);
+	return d->handoff_fd < 0 ? -1 : 0;
+}
+
+static void daemon_close(struct daemon *d)
+{
+	unsigned int i;
+
+	for (i = 0; i < SNVS_DAEMON_CLIENTS; i++)
+		if (d->clients[i].fd >= 0)
+			close(d->clients[i].fd);
+	if (d->listen_fd >= 0)
+		close(d->listen_fd);
+	if (d->handoff_fd >= 0)
+		close(d->handoff_fd);
+	if (d->journal_fd >= 0)
+		close(d->journal_fd);
+}
+
+int snvs_daemon_run(const struct snvs_daemon_config *config, struct snvs_daemon_stats *stats)
+{
+	struct pollfd pfd[2 + SNVS_DAEMON_CLIENTS];
+	unsigned int slot[SNVS_DAEMON_CLIENTS];
+	unsigned int i, n;
+	struct sigaction sa;
+	struct daemon d;
+	int ret = 0;
+
+	memset(stats, 0, sizeof(*stats));
+	memset(&d, 0, sizeof(d));
+	d.config = config;
+	d.stats = stats;
+	d.listen_fd = d.handoff_fd = d.journal_fd = -1;
+	for (i = 0; i < SNVS_DAEMON_CLIENTS; i++)
+		d.clients[i].fd = -1;
+
+	//No SA_RESTART: a signal has to interrupt poll()
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = daemon_signal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	daemon_stop = 0;
+
+	if (daemon_start(&d)) {
+		say(&d, "[ERROR] \t Cannot serve %s: %s\n", config->socket_path, strerror(errno));
+		daemon_close(&d);
+		return -1;
+	}
+
+	while (!daemon_stop) {
+		pfd[0].fd = d.listen_fd;
+		pfd[0].events = POLLIN;
+		pfd[1].fd = d.handoff_fd;
+		pfd[1].events = POLLIN;
+		for (i = 0, n = 2; i < SNVS_DAEMON_CLIENTS; i++) {
+			if (d.clients[i].fd >= 0 && d.clients[i].len)
+				client_parse(&d, i);
+			if (d.clients[i].fd < 0)
+				continue;
+			slot[n - 2] = i;
+			pfd[n].fd = d.clients[i].fd;
+			pfd[n++].events = d.count < SNVS_DAEMON_QUEUE ? POLLIN : 0;
+		}
+
+		//Queued boards keep the loop busy; the sockets are still checked between two boards
+		if (poll(pfd, n, d.count ? 0 : -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			ret = -1;
+			break;
+		}
+
+		if (pfd[1].revents & POLLIN) {
+			int conn = accept4(d.handoff_fd, NULL, NULL, SOCK_CLOEXEC);
+
+			if (conn >= 0) {
+				int given = handoff_give(&d, conn);
+
+				close(conn);
+				if (given) {
+					say(&d, "[INFO] \t Handed over to pid %d after %llu boards\n", (int)stats->handed_to,
+						stats->boards);
+					break;
+				}
+				say(&d, "[ERROR] \t Hand-off not acknowledged, still serving\n");
+			}
+		}
+		for (i = 2; i < n; i++)
+			if (pfd[i].revents & (POLLIN | POLLHUP | POLLERR) && d.clients[slot[i - 2]].fd == pfd[i].fd)
+				client_read(&d, slot[i - 2]);
+		if (pfd[0].revents & POLLIN)
+			client_accept(&d);
+		if (d.count)
+			serve_one(&d);
+	}
+
+	if (!stats->handed_to) {
+		char path[sizeof(((struct sockaddr_un *)0)->sun_path) + 16];
+
+		unlink(config->socket_path);
+		snprintf(path, sizeof(path), "%s.handoff", config->socket_path);
+		unlink(path);
+		say(&d, "[INFO] \t Stopped after %llu boards, %u requests not started\n", stats->boards, d.count);
+	}
+	daemon_close(&d);
+
+	return ret;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	Provisioning daemon with hot restart
+
+	snvs_daemon_run() takes provisioning requests from the production stations on a unix stream
+	socket. A request is one line "provision BOARD" and is answered with "OK BOARD SEQ" or
+	"FAIL BOARD REASON" once the board ran. Boards run one at a time from a FIFO of parsed
+	requests, and every result is appended to the journal ("SEQ BOARD OK|FAIL", synced) before
+	the reply goes out, so every reply has a journal record.
+
+	Between two boards the daemon also listens on SOCKET.handoff. A newer binary started on the
+	same socket path connects there first, and the running daemon hands it the listening socket,
+	every station connection, the queued requests, partially received lines and the journal
+	(descriptor, record count and size) in one SCM_RIGHTS message. Requests still sitting in the
+	socket buffers move with the descriptors. The old daemon closes its copies and exits only
+	when the new one acknowledges; without an acknowledgement it keeps serving. Stations see no
+	error, only a pause, which the new daemon measures from the end of the last board of the
+	old one to its own first poll and reports.
+*/
+
+#ifndef SNVS_DAEMON_H
+#define SNVS_DAEMON_H
+
+#include <stdio.h>
+#include <sys/types.h>
+
+#define SNVS_DAEMON_CLIENTS		64
+#define SNVS_DAEMON_QUEUE		256
+#define SNVS_DAEMON_LINE		128
+#define SNVS_DAEMON_BOARD		64
+#define SNVS_DAEMON_HANDOFF_TIMEOUT_MS	5000
+
+struct snvs_daemon_config {
+	const char *socket_path;	/* SOCKET.handoff is used for hot restarts */
+	const char *journal;
+	/* provision one board; returns 0, or -1 with a short reason */
+	int (*provision)(void *ctx, const char *board, char *reason, size_t size);
+	void *ctx;
+	FILE *log;			/* NULL for none */
+};
+
+struct snvs_daemon_stats {
+	unsigned long long boards;
+	unsigned long long failed;
+	unsigned int inherited_clients;	/* taken over from the previous daemon */
+	unsigned int inherited_requests;
+	double pause_ms;		/* no board served during the takeover, 0 when started fresh */
+	pid_t handed_to;		/* the daemon that took over, 0 when stopped by a signal */
+};
+
+/* Serve until SIGINT/SIGTERM or until a newer daemon takes over; returns 0 or -1 */
+int snvs_daemon_run(const struct snvs_daemon_config *config, struct snvs_daemon_stats *stats);
+
+#endif /* SNVS_DAEMON_H */
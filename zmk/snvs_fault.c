@@ -0,0 +1,142 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "snvs.h"
+#include "snvs_sim.h"
+#include "snvs_fault.h"
+
+struct snvs_faults *snvs_faults;
+
+static const char * const kind_names[] = { "zeroize", "ssm", "stuck", "drop", "delay" };
+
+const char *snvs_fault_kind_name(unsigned int kind)
+{
+	return kind < FAULT_KINDS ? kind_names[kind] : "unknown";
+}
+
+void snvs_faults_arm(struct snvs_faults *faults)
+{
+	unsigned int i;
+
+	faults->accesses = 0;
+	faults->step = 0;
+	faults->fired = 0;
+	faults->fired_ns = 0;
+	for (i = 0; i < faults->count; i++)
+		faults->drops_left[i] = faults->fault[i].kind == FAULT_DROP ? faults->fault[i].value : 0;
+}
+
+static void fire(struct snvs_faults *faults, void *mem, unsigned int i)
+{
+	const struct snvs_fault *f = &faults->fault[i];
+
+	if (!faults->fired)
+		faults->fired_ns = snvs_sim_clock(mem);
+	faults->fired |= 1U << i;
+
+	switch (f->kind) {
+	case FAULT_ZEROIZE:
+		snvs_sim_violation(mem);
+		break;
+	case FAULT_SSM:
+		snvs_sim_poke(mem, SNVS_HPSR, SSM_ST_MASK, f->value << SSM_ST_OFFSET);
+		break;
+	case FAULT_STUCK:
+		snvs_sim_poke(mem, f->offset, f->mask, f->value);
+		break;
+	}
+}
+
+void snvs_fault_step(void *mem, unsigned int step)
+{
+	struct snvs_faults *faults = snvs_faults;
+	unsigned int i;
+
+	faults->step = step;
+	for (i = 0; i < faults->count; i++)
+		if (!(faults->fired & (1U << i)) && faults->fault[i].trigger == FAULT_AT_STEP && faults->fault[i].at <= step)
+			fire(faults, mem, i);
+}
+
+int snvs_fault_access(void *mem, unsigned int offset, int write)
+{
+	struct snvs_faults *faults = snvs_faults;
+	uint64_t n = faults->accesses++;
+	unsigned int i;
+	int lost = 0;
+
+	for (i = 0; i < faults->count; i++) {
+		const struct snvs_fault *f = &faults->fault[i];
+
+		if (!(faults->fired & (1U << i))) {
+			if (f->trigger != FAULT_AT_ACCESS || f->at > n)
+				continue;
+			fire(faults, mem, i);
+		}
+		//A stuck bit shows on every access, also after a reset put the register back
+		if (f->kind == FAULT_STUCK && f->offset == offset)
+			snvs_sim_poke(mem, offset, f->mask, f->value);
+		if (f->kind == FAULT_DROP && write && !lost && faults->drops_left[i] &&
+			(f->offset == offset || f->offset == SNVS_FAULT_ANY)) {
+			faults->drops_left[i]--;
+			lost = 1;
+		}
+	}
+
+	return lost;
+}
+
+uint32_t snvs_fault_stuck(unsigned int offset, uint32_t value)
+{
+	const struct snvs_faults *faults = snvs_faults;
+	unsigned int i;
+
+	for (i = 0; i < faults->count; i++) {
+		const struct snvs_fault *f = &faults->fault[i];
+
+		if ((faults->fired & (1U << i)) && f->kind == FAULT_STUCK && f->offset == offset)
+			value = (value & ~f->mask) | (f->value & f->mask);
+	}
+	return value;
+}
+
+uint32_t snvs_fault_zeroize_delay(uint32_t ns)
+{
+	const struct snvs_faults *faults = snvs_faults;
+	unsigned int i;
+
+	for (i = 0; i < faults->count; i++)
+		if ((faults->fired & (1U << i)) && faults->fault[i].kind == FAULT_DELAY)
+			ns = faults->fault[i].value;
+	return ns;
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	Fault injection into the SNVS simulator
+
+	Makes the simulated SNVS misbehave the way a board under attack or with marginal hardware
+	does, so that the provisioning sequence can be hardened against it. A scenario holds up to
+	SNVS_FAULT_MAX faults. Each one fires once its trigger is reached: when snvs_provision()
+	enters a step, or before a given simulated register access (counted from snvs_faults_arm()).
+
+		FAULT_ZEROIZE	a security violation: the ZMK is zeroized, SNVS_HPSVSR[LP_SEC_VIO]
+				and SNVS_LPSR[ESVD] are set
+		FAULT_SSM	SNVS_HPSR[SSM_ST] moves to another state (soft fail, hard fail ...)
+		FAULT_STUCK	bits of a register hold a value from then on, whatever is written
+		FAULT_DROP	the next writes of a register (or of any register) are lost
+		FAULT_DELAY	a ZMK read lock zeroizes the ZMK only after a delay on the simulated
+				clock, or never
+
+	The scenario set in snvs_faults is checked by the simulator on every access; NULL (the
+	default) costs one test per access. Faults act on the simulator of this process only, not
+	behind a backend, and a scenario is run by one thread at a time.
+*/
+
+#ifndef SNVS_FAULT_H
+#define SNVS_FAULT_H
+
+#include <stdint.h>
+
+#define SNVS_FAULT_MAX			4
+#define SNVS_FAULT_ANY			0xFFFFFFFF	//FAULT_DROP: writes of any register
+#define SNVS_FAULT_NEVER		0xFFFFFFFF	//FAULT_DELAY: the zeroization never completes
+
+enum snvs_fault_kind {
+	FAULT_ZEROIZE,
+	FAULT_SSM,
+	FAULT_STUCK,
+	FAULT_DROP,
+	FAULT_DELAY,
+	FAULT_KINDS
+};
+
+enum snvs_fault_trigger {
+	FAULT_AT_ACCESS,
+	FAULT_AT_STEP,
+};
+
+struct snvs_fault {
+	unsigned int kind;		/* enum snvs_fault_kind */
+	unsigned int trigger;		/* enum snvs_fault_trigger */
+	unsigned int at;		/* register access count, or step (enum snvs_step) */
+	unsigned int offset;		/* FAULT_STUCK, FAULT_DROP: register, or SNVS_FAULT_ANY */
+	uint32_t mask;			/* FAULT_STUCK: bits */
+	uint32_t value;			/* STUCK: bit values, SSM: state, DROP: writes lost, DELAY: ns */
+};
+
+struct snvs_faults {
+	struct snvs_fault fault[SNVS_FAULT_MAX];
+	unsigned int count;
+
+	/* Progress of the scenario, cleared by snvs_faults_arm() */
+	uint64_t accesses;		/* simulated register accesses */
+	unsigned int step;		/* step the sequence is in */
+	unsigned int fired;		/* bit n: fault[n] fired */
+	uint32_t drops_left[SNVS_FAULT_MAX];
+	uint64_t fired_ns;		/* simulated clock when the first fault fired */
+};
+
+extern struct snvs_faults *snvs_faults;
+
+const char *snvs_fault_kind_name(unsigned int kind);
+
+/* Clear the progress of a scenario before it runs (again from the start) */
+void snvs_faults_arm(struct snvs_faults *faults);
+
+/* The provisioning sequence enters step */
+void snvs_fault_step(void *mem, unsigned int step);
+
+/* Simulator hooks: before each access, returns 1 if the write is lost */
+int snvs_fault_access(void *mem, unsigned int offset, int write);
+/* Value a write leaves in a register with stuck bits */
+uint32_t snvs_fault_stuck(unsigned int offset, uint32_t value);
+/* Zeroization delay after a ZMK read lock, ns is the delay of the timing model */
+uint32_t snvs_fault_zeroize_delay(uint32_t ns);
+
+#endif /* SNVS_FAULT_H */
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "snvs.h"
+#include "snvs_gpr.h"
+
+static uint8_t crc8(const uint8_t *data, unsigned int len)
+{
+	uint8_t crc = 0xFF;
+	unsigned int i, bit;
+
+	for (i = 0; i < len; i++) {
+		crc ^= data[i];
+		for (bit = 0; bit < 8; bit++)
+			crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+	}
+
+	return crc;
+}
+
+static void gpr_snapshot(const void *mem, uint8_t *bytes)
+{
+	uint32_t words[SNVS_LPGPR_WORDS];
+	unsigned int i;
+
+	for (i = 0; i < SNVS_LPGPR_WORDS; i++)
+		words[i] = read_SNVS_reg(mem, SNVS_LPGPR + 4 * i);
+	for (i = 0; i < SNVS_GPR_BYTES; i++)
+		bytes[i] = words[i / 4] >> (8 * (i % 4));
+}
+
+/* Returns 0 and fills rec if the GPR holds a valid record, -1 otherwise */
+int snvs_gpr_load(const void *mem, struct snvs_gpr_record *rec)
+{
+	uint8_t bytes[SNVS_GPR_BYTES];
+
+	gpr_snapshot(mem, bytes);
+	if (crc8(bytes + 1, SNVS_GPR_BYTES - 1) != bytes[0])
+		return -1;
+
+	rec->step = bytes[1] >> 4;
+	rec->policy = bytes[1] & 0xF;
+	memcpy(rec->fingerprint, bytes + 2, SNVS_GPR_FP_BYTES);
+
+	return 0;
+}
+
+static void gpr_bytes(const struct snvs_gpr_record *rec, uint8_t *bytes)
+{
+	bytes[1] = (rec->step & 0xF) << 4 | (rec->policy & 0xF);
+	memcpy(bytes + 2, rec->fingerprint, SNVS_GPR_FP_BYTES);
+	bytes[0] = crc8(bytes + 1, SNVS_GPR_BYTES - 1);
+}
+
+/* Register words of a record, for callers that write SNVS_LPGPR themselves */
+void snvs_gpr_encode(const struct snvs_gpr_record *rec, uint32_t *words)
+{
+	uint8_t bytes[SNVS_GPR_BYTES];
+	unsigned int i, j;
+
+	gpr_bytes(rec, bytes);
+	for (i = 0; i < SNVS_LPGPR_WORDS; i++) {
+		words[i] = 0;
+		for (j = 0; j < 4; j++)
+			words[i] |= (uint32_t)bytes[4 * i + j] << (8 * j);
+	}
+}
+
+/* Writes the record in one pass; returns 0 if the read back matches, -1 otherwise */
+int snvs_gpr_store(void *mem, const struct snvs_gpr_record *rec)
+{
+	uint8_t bytes[SNVS_GPR_BYTES], check[SNVS_GPR_BYTES];
+	uint32_t words[SNVS_LPGPR_WORDS];
+	unsigned int i;
+
+	gpr_bytes(rec, bytes);
+	snvs_gpr_encode(rec, words);
+	for (i = 0; i < SNVS_LPGPR_WORDS; i++)
+		write_SNVS_reg(mem, SNVS_LPGPR + 4 * i, words[i]);
+
+	gpr_snapshot(mem, check);
+	return memcmp(bytes, check, SNVS_GPR_BYTES) ? -1 : 0;
+}
+
+/* FNV-1a over the key words, stretched to the fingerprint size; identifies a key, does not protect it */
+void snvs_gpr_fingerprint(const uint32_t *key, unsigned int words, uint8_t *fingerprint)
+{
+	uint32_t hash = 0x811C9DC5;
+	unsigned int i, j;
+
+	for (i = 0; i < words; i++)
+		for (j = 0; j < 4; j++) {
+			hash ^= (key[i] >> (8 * j)) & 0xFF;
+			hash *= 0x01000193;
+		}
+
+	for (i = 0; i < SNVS_GPR_FP_BYTES; i++) {
+		fingerprint[i] = hash >> 24;
+		hash = (hash ^ i) * 0x01000193;
+	}
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	Provisioning state record kept in the SNVS_LP general purpose register(s)
+
+	SNVS_LPGPR survives reboots as long as the LP domain stays powered. The record is packed
+	into the GPR words as a byte stream (little endian inside each word):
+
+		byte 0		CRC-8 (poly 0x07, init 0xFF) over bytes 1..n-1
+		byte 1		step reached (bits 7..4) | policy (bits 3..0)
+		byte 2..n-1	key fingerprint
+
+	The whole record is read in one pass over the GPR words and decoded from the local copy, and
+	written in one pass followed by a read back. An all-zero GPR (LP POR value) never validates.
+	i.MX6 SNVS has a single 32-bit SNVS_LPGPR, leaving 2 fingerprint bytes; SoCs with the
+	SNVS_LPGPR0..3 bank can set SNVS_LPGPR/SNVS_LPGPR_WORDS accordingly.
+*/
+
+#ifndef SNVS_GPR_H
+#define SNVS_GPR_H
+
+#include <stdint.h>
+
+#include "snvs.h"
+
+#ifndef SNVS_LPGPR_WORDS
+#define SNVS_LPGPR_WORDS		1
+#endif
+
+#define SNVS_GPR_BYTES			(4 * SNVS_LPGPR_WORDS)
+#define SNVS_GPR_FP_BYTES		(SNVS_GPR_BYTES - 2)
+
+#define GPR_POLICY_HARD_LOCKS		0x1		//locks are set in SNVS_LPLR (POR to clear)
+#define GPR_POLICY_MKS_MASK		0x6		//MASTER_KEY_SEL programmed at B.9
+#define GPR_POLICY_MKS_OFFSET		1
+
+struct snvs_gpr_record {
+	unsigned int step;
+	unsigned int policy;
+	uint8_t fingerprint[SNVS_GPR_FP_BYTES];
+};
+
+int snvs_gpr_load(const void *mem, struct snvs_gpr_record *rec);
+int snvs_gpr_store(void *mem, const struct snvs_gpr_record *rec);
+void snvs_gpr_encode(const struct snvs_gpr_record *rec, uint32_t *words);
+void snvs_gpr_fingerprint(const uint32_t *key, unsigned int words, uint8_t *fingerprint);
+
+#endif /* SNVS_GPR_H */
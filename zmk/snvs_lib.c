@@ -0,0 +1,394 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "snvs.h"
+#include "snvs_sim.h"
+#include "snvs_gpr.h"
+#include "libsnvs.h"
+#include "ocotp.h"
+#include "snvs_trace.h"
+#include "snvs_backend.h"
+#include "snvs_mu.h"
+#include "snvs_tee.h"
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+struct snvs_wc_entry {
+	unsigned int offset;
+	uint32_t bits;
+};
+
+struct snvs {
+	void *mem;
+	size_t length;
+	const volatile uint32_t *ocotp;
+	unsigned int flags;
+	int identity_valid;
+	struct snvs_identity identity;
+	unsigned int wc_count;
+	struct snvs_wc_entry wc[SNVS_WC_MAX];
+};
+
+SNVS_API unsigned int snvs_abi_version(void)
+{
+	return LIBSNVS_ABI_VERSION;
+}
+
+/*
+ * The register macros route every access by process wide switches (snvs_sim, snvs_atomic,
+ * snvs_backend), so all open handles share one mode. The first handle sets the switches, the
+ * last one closed puts them back.
+ */
+#define SNVS_OPEN_MODE			(SNVS_OPEN_SIM | SNVS_OPEN_MU | SNVS_OPEN_TEE | SNVS_OPEN_ATOMIC)
+
+static pthread_mutex_t open_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t open_once = PTHREAD_ONCE_INIT;
+static unsigned int open_handles, open_mode;
+static int saved_sim, saved_atomic;
+
+//A forked stand-in opens its own simulator: it starts with no handles, and the lock held by the fork free
+static void open_forked(void)
+{
+	pthread_mutex_init(&open_lock, NULL);
+	open_handles = open_mode = 0;
+}
+
+static void open_init(void)
+{
+	pthread_atfork(NULL, NULL, open_forked);
+}
+
+static int mode_enter(unsigned int flags)
+{
+	unsigned int mode = flags & SNVS_OPEN_MODE;
+
+	if (open_handles) {
+		if (mode != open_mode) {
+			errno = EBUSY;
+			return -1;
+		}
+		open_handles++;
+		return 0;
+	}
+	//A backend attached outside snvs_open() would take this handle's accesses
+	if (snvs_backend) {
+		errno = EBUSY;
+		return -1;
+	}
+	if (flags & (SNVS_OPEN_MU | SNVS_OPEN_TEE)) {
+		if ((flags & SNVS_OPEN_TEE) ? snvs_tee_start() : snvs_mu_start())
+			return -1;
+	}
+	saved_sim = snvs_sim;
+	saved_atomic = snvs_atomic;
+	if (!(flags & (SNVS_OPEN_MU | SNVS_OPEN_TEE)))
+		snvs_sim = !!(flags & SNVS_OPEN_SIM);
+	snvs_atomic = !!(flags & SNVS_OPEN_ATOMIC);
+	open_mode = mode;
+	open_handles = 1;
+	return 0;
+}
+
+static void mode_leave(void)
+{
+	if (--open_handles)
+		return;
+	if (open_mode & (SNVS_OPEN_MU | SNVS_OPEN_TEE))
+		snvs_mu_detach();
+	snvs_sim = saved_sim;
+	snvs_atomic = saved_atomic;
+	open_mode = 0;
+}
+
+static int map_page(snvs_t *snvs, unsigned int flags)
+{
+	//Behind a controller there is no page to map; the placeholder only keeps snvs_base() valid
+	if (flags & (SNVS_OPEN_MU | SNVS_OPEN_TEE)) {
+		snvs->mem = calloc(1, SNVS_PAGE_SIZE);
+		snvs->ocotp = snvs_sim_ocotp();
+		return snvs->mem ? 0 : -1;
+	}
+
+	if (flags & SNVS_OPEN_SIM) {
+		snvs->mem = snvs_sim_map();
+		snvs->length = 2 * SNVS_PAGE_SIZE;
+		snvs->ocotp = snvs_sim_ocotp();
+		return snvs->mem ? 0 : -1;
+	}
+
+	int readonly = flags & SNVS_OPEN_READONLY;
+	int fd = open("/dev/mem", O_SYNC | (readonly ? O_RDONLY : O_RDWR));
+	if (fd < 0)
+		return -1;
+
+	snvs->length = SNVS_PAGE_SIZE;
+	snvs->mem = mmap(NULL, snvs->length, readonly ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, fd, SNVS_BASE_REG);
+	int err = errno;
+	if (snvs->mem == MAP_FAILED) {
+		close(fd);
+		errno = err;
+		return -1;
+	}
+
+	//The fuse shadows are only read; a SoC without OCOTP at this address reports no UID
+	void *ocotp = mmap(NULL, OCOTP_PAGE_SIZE, PROT_READ, MAP_SHARED, fd, OCOTP_BASE_REG);
+	snvs->ocotp = ocotp == MAP_FAILED ? NULL : ocotp;
+	close(fd);
+
+	return 0;
+}
+
+SNVS_API snvs_t *snvs_open(unsigned int flags)
+{
+	snvs_t *snvs = calloc(1, sizeof(*snvs));
+	if (!snvs)
+		return NULL;
+	snvs->flags = flags;
+
+	pthread_once(&open_once, open_init);
+	pthread_mutex_lock(&open_lock);
+	if (mode_enter(flags)) {
+		pthread_mutex_unlock(&open_lock);
+		free(snvs);
+		return NULL;
+	}
+	if (map_page(snvs, flags)) {
+		int err = errno;
+
+		mode_leave();
+		pthread_mutex_unlock(&open_lock);
+		free(snvs);
+		errno = err;
+		return NULL;
+	}
+	pthread_mutex_unlock(&open_lock);
+
+	return snvs;
+}
+
+SNVS_API void snvs_close(snvs_t *snvs)
+{
+	if (!snvs)
+		return;
+	snvs_flush(snvs);
+	if (snvs->flags & (SNVS_OPEN_MU | SNVS_OPEN_TEE))
+		free(snvs->mem);
+	else
+		munmap(snvs->mem, snvs->length);
+	if (snvs->ocotp && !(snvs->flags & (SNVS_OPEN_SIM | SNVS_OPEN_MU | SNVS_OPEN_TEE)))
+		munmap((void *)snvs->ocotp, OCOTP_PAGE_SIZE);
+
+	pthread_mutex_lock(&open_lock);
+	mode_leave();
+	pthread_mutex_unlock(&open_lock);
+	free(snvs);
+}
+
+SNVS_API int snvs_flush(snvs_t *snvs)
+{
+	if ((snvs->flags & (SNVS_OPEN_MU | SNVS_OPEN_TEE)) && snvs_backend && snvs_backend->flush)
+		return snvs_backend->flush();
+	return 0;
+}
+
+SNVS_API void *snvs_base(snvs_t *snvs)
+{
+	return snvs->mem;
+}
+
+SNVS_API uint32_t snvs_read(const snvs_t *snvs, unsigned int offset)
+{
+	return read_SNVS_reg(snvs->mem, offset);
+}
+
+SNVS_API int snvs_write(snvs_t *snvs, unsigned int offset, uint32_t value)
+{
+	if (snvs->flags & SNVS_OPEN_READONLY) {
+		errno = EPERM;
+		return -1;
+	}
+
+	write_SNVS_reg(snvs->mem, offset, value);
+	if (offset == SNVS_HPLR || offset == SNVS_LPLR || offset == SNVS_LPMKCR)
+		snvs->identity_valid = 0;
+	return 0;
+}
+
+SNVS_API int snvs_modify(snvs_t *snvs, unsigned int offset, uint32_t clear, uint32_t set)
+{
+	if (snvs->flags & SNVS_OPEN_READONLY) {
+		errno = EPERM;
+		return -1;
+	}
+
+	modify_SNVS_reg(snvs->mem, offset, clear, set);
+	if (offset == SNVS_HPLR || offset == SNVS_LPLR || offset == SNVS_LPMKCR)
+		snvs->identity_valid = 0;
+	return 0;
+}
+
+SNVS_API int snvs_set_bits(snvs_t *snvs, unsigned int offset, uint32_t bits)
+{
+	return snvs_modify(snvs, offset, 0, bits);
+}
+
+SNVS_API void snvs_read_many(const snvs_t *snvs, const unsigned int *offsets, uint32_t *values, unsigned int count)
+{
+	unsigned int i;
+
+	if (snvs_backend && snvs_backend->read_many) {
+		uint64_t start = snvs_trace_on ? snvs_trace_now() : 0;
+
+		snvs_backend->read_many(offsets, values, count);
+		if (start)
+			snvs_trace_span(TRACE_READ, NULL, offsets[0], values[0], start);
+		return;
+	}
+	for (i = 0; i < count; i++)
+		values[i] = read_SNVS_reg(snvs->mem, offsets[i]);
+}
+
+SNVS_API void snvs_snapshot(const snvs_t *snvs, struct snvs_snapshot *snap)
+{
+	snvs_regs_snapshot(snvs, snap);
+}
+
+SNVS_API const struct snvs_identity *snvs_identity(snvs_t *snvs)
+{
+	struct snvs_identity *id = &snvs->identity;
+
+	if (snvs->identity_valid)
+		return id;
+
+	id->uid = 0;
+	if (snvs->ocotp)
+		id->uid = ((uint64_t)read_SNVS_reg32(snvs->ocotp, OCOTP_CFG1) << 32) | read_SNVS_reg32(snvs->ocotp, OCOTP_CFG0);
+	struct snvs_snapshot snap;
+	snvs_snapshot(snvs, &snap);
+	id->hplr = snap.hplr;
+	id->hpsr = snap.hpsr;
+	id->lplr = snap.lplr;
+	id->lpmkcr = snap.lpmkcr;
+	id->hpvidr1 = snap.hpvidr1;
+	id->hpvidr2 = snap.hpvidr2;
+	snvs->identity_valid = 1;
+
+	return id;
+}
+
+SNVS_API int snvs_wc_set(snvs_t *snvs, unsigned int offset, uint32_t bits)
+{
+	unsigned int i;
+
+	for (i = 0; i < snvs->wc_count; i++) {
+		if (snvs->wc[i].offset == offset) {
+			snvs->wc[i].bits |= bits;
+			return 0;
+		}
+	}
+	if (snvs->wc_count == SNVS_WC_MAX) {
+		errno = ENOSPC;
+		return -1;
+	}
+
+	snvs->wc[snvs->wc_count].offset = offset;
+	snvs->wc[snvs->wc_count].bits = bits;
+	snvs->wc_count++;
+	return 0;
+}
+
+SNVS_API int snvs_wc_flush(snvs_t *snvs)
+{
+	unsigned int i, count = snvs->wc_count;
+	int ret = 0;
+
+	snvs->wc_count = 0;
+	for (i = 0; i < count; i++) {
+		const struct snvs_wc_entry *e = &snvs->wc[i];
+		if (snvs_set_bits(snvs, e->offset, e->bits) || (snvs_read(snvs, e->offset) & e->bits) != e->bits)
+			ret = -1;
+	}
+
+	return ret ? ret : (int)count;
+}
+
+static uint64_t now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+/* Under the simulator's timing model a poll waits on the simulated clock, like the board would */
+static uint64_t poll_now_us(const snvs_t *snvs)
+{
+	if (snvs_sim && !snvs_backend && snvs_sim_timed())
+		return snvs_sim_clock(snvs->mem) / 1000;
+	return now_us();
+}
+
+SNVS_API int snvs_poll(const snvs_t *snvs, unsigned int offset, uint32_t mask, uint32_t value, unsigned int timeout_us)
+{
+	uint64_t start = snvs_trace_on ? snvs_trace_now() : 0;
+	uint64_t deadline = poll_now_us(snvs) + timeout_us;
+	int ret;
+
+	if (snvs_backend && snvs_backend->poll) {
+		ret = snvs_backend->poll(offset, mask, value, timeout_us);
+		goto out;
+	}
+	for (;;) {
+		if ((snvs_read(snvs, offset) & mask) == value) {
+			ret = 0;
+			break;
+		}
+		if (poll_now_us(snvs) >= deadline) {
+			ret = -1;
+			break;
+		}
+	}
+
+out:
+	if (start)
+		snvs_trace_span(TRACE_POLL, NULL, offset, ret != 0, start);
+	return ret;
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+
+#include "snvs.h"
+#include "snvs_mc.h"
+
+/* Consistent read of the 48-bit counter; returns 0 on success, -1 if the value never settled */
+int read_SNVS_mc(const void *mem, uint64_t *value, unsigned int *era)
+{
+	uint32_t msb, lsb, msb2, lsb2;
+	int retries = MC_READ_RETRIES;
+
+	msb = read_SNVS_reg(mem, SNVS_LPSMCMR);
+	lsb = read_SNVS_reg(mem, SNVS_LPSMCLR);
+	do {
+		msb2 = read_SNVS_reg(mem, SNVS_LPSMCMR);
+		lsb2 = read_SNVS_reg(mem, SNVS_LPSMCLR);
+		if (msb == msb2 && lsb == lsb2) {
+			*value = ((uint64_t)(msb & MC_MSB_MASK) << 32) | lsb;
+			if (era)
+				*era = (msb & MC_ERA_BITS_MASK) >> MC_ERA_BITS_OFFSET;
+			return 0;
+		}
+		msb = msb2;
+		lsb = lsb2;
+	} while (--retries);
+
+	return -1;
+}
+
+int snvs_mc_init(struct snvs_mc *mc, void *mem, unsigned int flags)
+{
+	if (get_value_of_SNVS_reg_field(mem, SNVS_LPLR, MC_HL_MASK, MC_HL_OFFSET) ||
+	    get_value_of_SNVS_reg_field(mem, SNVS_HPLR, MC_SL_MASK, MC_SL_OFFSET)) {
+		errno = EPERM;
+		return -1;
+	}
+
+	//Enabling the counter changes SNVS_LPCR, so only on request
+	if ((flags & SNVS_MC_ENABLE) && !get_value_of_SNVS_reg_field(mem, SNVS_LPCR, MC_ENV_MASK, MC_ENV_OFFSET))
+		set_value_of_SNVS_reg(mem, SNVS_LPCR, MC_ENV_MASK);
+	if (!get_value_of_SNVS_reg_field(mem, SNVS_LPCR, MC_ENV_MASK, MC_ENV_OFFSET)) {
+		errno = ENODEV;
+		return -1;
+	}
+
+	mc->mem = mem;
+	mc->issued = mc->served = mc->hw_increments = 0;
+	mc->waiting = NULL;
+	mc->busy = 0;
+	if (read_SNVS_mc(mem, &mc->value, NULL)) {
+		errno = EIO;
+		return -1;
+	}
+	pthread_mutex_init(&mc->lock, NULL);
+	pthread_cond_init(&mc->done, NULL);
+
+	return 0;
+}
+
+/*
+ * Request one increment. On return the counter has been incremented at least once after the
+ * call was made and *value holds the counter value observed after that increment.
+ * Returns 0 on success, -1 if the hardware counter did not advance (locked, disabled or rolled over).
+ */
+int snvs_mc_increment(struct snvs_mc *mc, uint64_t *value)
+{
+	struct snvs_mc_waiter self = { NULL, 0, 0, 0 }, *w, *next;
+
+	pthread_mutex_lock(&mc->lock);
+	mc->issued++;
+	self.next = mc->waiting;
+	mc->waiting = &self;
+
+	while (!self.served) {
+		if (mc->busy) {
+			pthread_cond_wait(&mc->done, &mc->lock);
+			continue;
+		}
+
+		/* Every request waiting so far is covered by the increment we are about to do */
+		struct snvs_mc_waiter *batch = mc->waiting;
+		uint64_t before = mc->value, after;
+		mc->waiting = NULL;
+		mc->busy = 1;
+		pthread_mutex_unlock(&mc->lock);
+
+		write_SNVS_reg(mc->mem, SNVS_LPSMCLR, 0);
+		int err = read_SNVS_mc(mc->mem, &after, NULL) || after <= before;
+
+		pthread_mutex_lock(&mc->lock);
+		mc->busy = 0;
+		mc->hw_increments++;
+		if (!err)
+			mc->value = after;
+		/* The outcome goes to the requests of this batch only, later batches report their own */
+		for (w = batch; w; w = next) {
+			next = w->next;
+			w->error = err;
+			w->value = mc->value;
+			w->served = 1;
+			mc->served++;
+		}
+		pthread_cond_broadcast(&mc->done);
+	}
+	pthread_mutex_unlock(&mc->lock);
+
+	*value = self.value;
+	return self.error ? -1 : 0;
+}
+
+void snvs_mc_destroy(struct snvs_mc *mc)
+{
+	pthread_cond_destroy(&mc->done);
+	pthread_mutex_destroy(&mc->lock);
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	SNVS_LP secure monotonic counter service (firmware anti-rollback)
+
+	The counter is 48 bits wide (SNVS_LPSMCMR[15:0] and SNVS_LPSMCLR) and every write to either
+	register increments it by one. A hardware increment is a slow LP-domain write, so concurrent
+	increment requests are coalesced: a request is satisfied by any hardware increment started
+	after the request was made. While one thread performs an increment, all requests arriving in
+	the meantime wait and are then served together by the next single increment.
+*/
+
+#ifndef SNVS_MC_H
+#define SNVS_MC_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#define MC_READ_RETRIES			16
+
+//snvs_mc_init() flags
+#define SNVS_MC_ENABLE			0x1		//set SNVS_LPCR[MC_ENV] if it is clear
+
+/* One increment request, on the stack of the requesting thread */
+struct snvs_mc_waiter {
+	struct snvs_mc_waiter *next;
+	int served;			/* a hardware increment started after the request has completed */
+	int error;			/* that increment did not advance the counter */
+	uint64_t value;			/* counter value after that increment */
+};
+
+struct snvs_mc {
+	void *mem;
+	pthread_mutex_t lock;
+	pthread_cond_t done;
+	uint64_t issued;		/* increment requests received */
+	uint64_t served;		/* requests covered by a completed hardware increment */
+	struct snvs_mc_waiter *waiting;	/* requests the next hardware increment will serve */
+	int busy;			/* a hardware increment is in flight */
+	uint64_t value;			/* counter value after the last hardware increment */
+	uint64_t hw_increments;
+};
+
+int read_SNVS_mc(const void *mem, uint64_t *value, unsigned int *era);
+/*
+ * Returns 0, or -1 with errno set: EPERM if SNVS_LPLR[MC_HL] or SNVS_HPLR[MC_SL] blocks
+ * increments, ENODEV if SNVS_LPCR[MC_ENV] is clear (and SNVS_MC_ENABLE was not given or did
+ * not stick), EIO if the counter never settled.
+ */
+int snvs_mc_init(struct snvs_mc *mc, void *mem, unsigned int flags);
+int snvs_mc_increment(struct snvs_mc *mc, uint64_t *value);
+void snvs_mc_destroy(struct snvs_mc *mc);
+
+#endif /* SNVS_MC_H */
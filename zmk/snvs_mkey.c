@@ -0,0 +1,117 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "snvs.h"
+#include "snvs_mkey.h"
+
+typedef uint32_t v4u32 __attribute__((vector_size(16)));
+
+enum snvs_mkey_source snvs_mkey_select(uint32_t lpmkcr, uint32_t hpcomr)
+{
+	if (!(hpcomr & MKS_EN_MASK))
+		return MKEY_OTPMK;
+
+	switch (lpmkcr & MASTER_KEY_SEL_MASK) {
+	case 0x2:
+		return (lpmkcr & ZMK_VAL_MASK) ? MKEY_ZMK : MKEY_INVALID;
+	case 0x3:
+		return (lpmkcr & ZMK_VAL_MASK) ? MKEY_OTPMK_XOR_ZMK : MKEY_INVALID;
+	default:
+		return MKEY_OTPMK;
+	}
+}
+
+const char *snvs_mkey_source_name(enum snvs_mkey_source source)
+{
+	switch (source) {
+	case MKEY_OTPMK:
+		return "OTPMK";
+	case MKEY_ZMK:
+		return "ZMK";
+	case MKEY_OTPMK_XOR_ZMK:
+		return "OTPMK XOR ZMK";
+	default:
+		return "invalid (ZMK selected without ZMK_VAL)";
+	}
+}
+
+/* Returns 0 and writes the 32-byte effective key, -1 if the selection is invalid */
+int snvs_mkey_effective(uint32_t lpmkcr, uint32_t hpcomr, const uint8_t *otpmk, const uint8_t *zmk, uint8_t *key)
+{
+	unsigned int i;
+
+	switch (snvs_mkey_select(lpmkcr, hpcomr)) {
+	case MKEY_OTPMK:
+		memcpy(key, otpmk, MASTER_KEY_BYTES);
+		return 0;
+	case MKEY_ZMK:
+		memcpy(key, zmk, MASTER_KEY_BYTES);
+		return 0;
+	case MKEY_OTPMK_XOR_ZMK:
+		for (i = 0; i < MASTER_KEY_BYTES; i++)
+			key[i] = otpmk[i] ^ zmk[i];
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+/*
+ * Computes the effective key of every board into keys (count * 32 bytes). Boards with an invalid
+ * selection get an all-zero key. Returns the number of boards with an invalid selection.
+ */
+size_t snvs_mkey_effective_bulk(const struct snvs_mkey_board *boards, size_t count, uint8_t *keys)
+{
+	size_t i, invalid = 0;
+	unsigned int j;
+
+	for (i = 0; i < count; i++) {
+		enum snvs_mkey_source source = snvs_mkey_select(boards[i].lpmkcr, boards[i].hpcomr);
+		v4u32 a = (v4u32){ 0, 0, 0, 0 } - (source == MKEY_OTPMK || source == MKEY_OTPMK_XOR_ZMK);
+		v4u32 b = (v4u32){ 0, 0, 0, 0 } - (source == MKEY_ZMK || source == MKEY_OTPMK_XOR_ZMK);
+
+		invalid += source == MKEY_INVALID;
+		for (j = 0; j < MASTER_KEY_BYTES; j += sizeof(v4u32)) {
+			v4u32 otpmk, zmk, key;
+
+			memcpy(&otpmk, boards[i].otpmk + j, sizeof(otpmk));
+			memcpy(&zmk, boards[i].zmk + j, sizeof(zmk));
+			key = (otpmk & a) ^ (zmk & b);
+			memcpy(keys + i * MASTER_KEY_BYTES + j, &key, sizeof(key));
+		}
+	}
+
+	return invalid;
+}
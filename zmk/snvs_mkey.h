@@ -0,0 +1,79 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	Software model of the SNVS master key selection (B.9)
+
+	CAAM derives blob keys from a 256-bit master key chosen by SNVS:
+
+		SNVS_HPCOMR[MKS_EN]	SNVS_LPMKCR[MASTER_KEY_SEL]	master key
+		0			-				OTPMK
+		1			0b00, 0b01			OTPMK
+		1			0b10				ZMK
+		1			0b11				OTPMK XOR ZMK
+
+	The ZMK can only be selected while SNVS_LPMKCR[ZMK_VAL] is set. The model computes the
+	effective key for one board from the register state and the two key inputs, and for a whole
+	fleet in bulk. The bulk path expresses every selection as (OTPMK & a) ^ (ZMK & b), with a and b
+	all-ones or all-zeros masks, so it runs branch free on 128-bit vectors (SSE2 / NEON).
+*/
+
+#ifndef SNVS_MKEY_H
+#define SNVS_MKEY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MASTER_KEY_BYTES		32
+#define MASTER_KEY_SEL_MASK		0x3
+
+enum snvs_mkey_source {
+	MKEY_OTPMK,
+	MKEY_ZMK,
+	MKEY_OTPMK_XOR_ZMK,
+	MKEY_INVALID,			/* ZMK selected while SNVS_LPMKCR[ZMK_VAL] is clear */
+};
+
+struct snvs_mkey_board {
+	uint32_t lpmkcr;
+	uint32_t hpcomr;
+	uint8_t otpmk[MASTER_KEY_BYTES];
+	uint8_t zmk[MASTER_KEY_BYTES];
+};
+
+enum snvs_mkey_source snvs_mkey_select(uint32_t lpmkcr, uint32_t hpcomr);
+const char *snvs_mkey_source_name(enum snvs_mkey_source source);
+int snvs_mkey_effective(uint32_t lpmkcr, uint32_t hpcomr, const uint8_t *otpmk, const uint8_t *zmk, uint8_t *key);
+size_t snvs_mkey_effective_bulk(const struct snvs_mkey_board *boards, size_t count, uint8_t *keys);
+
+#endif /* SNVS_MKEY_H */
@@ -0,0 +1,412 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "snvs.h"
+#include "snvs_sim.h"
+#include "snvs_backend.h"
+#include "snvs_mu.h"
+#include "snvs_trace.h"
+
+static int mu_fd = -1;
+static pid_t mu_pid;
+static pthread_mutex_t mu_lock = PTHREAD_MUTEX_INITIALIZER;
+static const struct snvs_mu_transport *transport;
+static struct snvs_mu_request pending;
+static struct snvs_mu_reply reply;
+static struct snvs_backend_stats mu_stats;
+static int mu_failed;
+
+unsigned int snvs_mu_latency_us;
+
+size_t snvs_mu_request_size(unsigned int count)
+{
+	return offsetof(struct snvs_mu_request, ops) + count * sizeof(struct snvs_mu_op);
+}
+
+size_t snvs_mu_reply_size(unsigned int count)
+{
+	return offsetof(struct snvs_mu_reply, results) + count * sizeof(struct snvs_mu_result);
+}
+
+int snvs_mu_needs_reply(const struct snvs_mu_request *request)
+{
+	unsigned int i;
+
+	for (i = 0; i < request->count; i++)
+		if (request->ops[i].code != MU_WRITE)
+			return 1;
+	return 0;
+}
+
+/* The controller polls its simulator, so under the timing model a poll runs on the simulated clock */
+static uint64_t now_us(const void *mem)
+{
+	struct timespec ts;
+
+	if (snvs_sim_timed())
+		return snvs_sim_clock(mem) / 1000;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+void snvs_mu_execute(void *mem, const struct snvs_mu_request *request, struct snvs_mu_reply *reply)
+{
+	unsigned int i;
+
+	reply->count = request->count;
+	for (i = 0; i < request->count; i++) {
+		const struct snvs_mu_op *op = &request->ops[i];
+		struct snvs_mu_result *result = &reply->results[i];
+		uint64_t deadline;
+
+		result->value = 0;
+		result->failed = 0;
+		switch (op->code) {
+		case MU_READ:
+			result->value = read_SNVS_reg(mem, op->offset);
+			break;
+		case MU_WRITE:
+			write_SNVS_reg(mem, op->offset, op->value);
+			break;
+		case MU_POLL:
+			deadline = now_us(mem) + op->timeout_us;
+			while (((result->value = read_SNVS_reg(mem, op->offset)) & op->mask) != op->value) {
+				if (now_us(mem) >= deadline) {
+					result->failed = 1;
+					break;
+				}
+			}
+			break;
+		default:
+			result->failed = 1;
+			break;
+		}
+	}
+}
+
+/* Controller stand-in: serve requests against the simulator until the tool closes its end */
+static void mu_controller(int fd)
+{
+	static struct snvs_mu_request request;
+	static struct snvs_mu_reply answer;
+	ssize_t n;
+
+	void *mem = snvs_sim_map();
+	if (!mem) {
+		perror("snvs_mu controller: can't map the simulator");
+		_exit(EXIT_FAILURE);
+	}
+
+	while ((n = recv(fd, &request, sizeof(request), 0)) > 0) {
+		if ((size_t)n < snvs_mu_request_size(0) || request.count > SNVS_MU_MAX_OPS ||
+		    (size_t)n != snvs_mu_request_size(request.count)) {
+			fprintf(stderr, "snvs_mu controller: malformed request of %zd bytes\n", n);
+			_exit(EXIT_FAILURE);
+		}
+		snvs_mu_execute(mem, &request, &answer);
+		if (snvs_mu_needs_reply(&request) && snvs_mu_latency_us)
+			usleep(snvs_mu_latency_us);
+		if (snvs_mu_needs_reply(&request) && send(fd, &answer, snvs_mu_reply_size(answer.count), 0) < 0)
+			_exit(EXIT_FAILURE);
+	}
+
+	_exit(n < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+static int mu_exchange(int fd, const struct snvs_mu_request *request, struct snvs_mu_reply *reply, int wait,
+		       struct snvs_backend_stats *stats)
+{
+	if (send(fd, request, snvs_mu_request_size(request->count), MSG_NOSIGNAL) < 0)
+		return -1;
+	if (wait) {
+		ssize_t n = recv(fd, reply, sizeof(*reply), 0);
+		if (n <= 0 || (size_t)n != snvs_mu_reply_size(request->count))
+			return -1;
+	}
+	return 0;
+}
+
+const struct snvs_mu_transport snvs_mu_socket = {
+	.name = "messaging unit",
+	.exchange = mu_exchange,
+	.serve = mu_controller,
+};
+
+/* Latch the loss; the caller sees it through poll, flush and provision, the process keeps running */
+static void mu_lost(const char *what)
+{
+	perror(what);
+	fprintf(stderr, "[ERROR] \t Lost the SNVS %s, reads return 0x%x from now on.\n", transport->name, SNVS_BACKEND_POISON);
+	mu_failed = 1;
+}
+
+/* Answer every queued operation as failed, with a poisoned value */
+static const struct snvs_mu_reply *mu_poison(void)
+{
+	unsigned int i;
+
+	reply.count = pending.count;
+	for (i = 0; i < pending.count; i++) {
+		reply.results[i].value = SNVS_BACKEND_POISON;
+		reply.results[i].failed = 1;
+	}
+	pending.count = 0;
+	return &reply;
+}
+
+/* Send the queued operations; wait for the answer if any of them reads. Called with mu_lock held. */
+static const struct snvs_mu_reply *mu_transact(void)
+{
+	int wait = transport->synchronous || snvs_mu_needs_reply(&pending);
+
+	if (!pending.count)
+		return &reply;
+	if (!mu_failed && transport->exchange(mu_fd, &pending, &reply, wait, &mu_stats))
+		mu_lost("snvs_mu exchange");
+	if (mu_failed)
+		return mu_poison();
+	mu_stats.messages++;
+	mu_stats.ops += pending.count;
+	mu_stats.round_trips += wait;
+	pending.count = 0;
+	return &reply;
+}
+
+static struct snvs_mu_op *mu_queue(uint32_t code, unsigned int offset, uint32_t value)
+{
+	if (pending.count == SNVS_MU_MAX_OPS)
+		mu_transact();
+
+	struct snvs_mu_op *op = &pending.ops[pending.count++];
+	op->code = code;
+	op->offset = offset;
+	op->value = value;
+	op->mask = 0;
+	op->timeout_us = 0;
+	return op;
+}
+
+static unsigned int mu_read(unsigned int offset)
+{
+	pthread_mutex_lock(&mu_lock);
+	mu_queue(MU_READ, offset, 0);
+	unsigned int index = pending.count - 1;
+	uint32_t value = mu_transact()->results[index].value;
+	pthread_mutex_unlock(&mu_lock);
+
+	return value;
+}
+
+static void mu_write(unsigned int offset, unsigned int value)
+{
+	pthread_mutex_lock(&mu_lock);
+	mu_queue(MU_WRITE, offset, value);
+	pthread_mutex_unlock(&mu_lock);
+}
+
+static void mu_read_many(const unsigned int *offsets, uint32_t *values, unsigned int count)
+{
+	unsigned int i, first, done = 0;
+
+	pthread_mutex_lock(&mu_lock);
+	while (done < count) {
+		if (pending.count == SNVS_MU_MAX_OPS)
+			mu_transact();
+		first = pending.count;
+		for (i = done; i < count && pending.count < SNVS_MU_MAX_OPS; i++)
+			mu_queue(MU_READ, offsets[i], 0);
+
+		const struct snvs_mu_reply *r = mu_transact();
+		for (; done < i; done++)
+			values[done] = r->results[first++].value;
+	}
+	pthread_mutex_unlock(&mu_lock);
+}
+
+static int mu_poll(unsigned int offset, uint32_t mask, uint32_t value, unsigned int timeout_us)
+{
+	pthread_mutex_lock(&mu_lock);
+	struct snvs_mu_op *op = mu_queue(MU_POLL, offset, value);
+	unsigned int index = pending.count - 1;
+	op->mask = mask;
+	op->timeout_us = timeout_us;
+	int failed = mu_transact()->results[index].failed;
+	pthread_mutex_unlock(&mu_lock);
+
+	return failed ? -1 : 0;
+}
+
+static int mu_flush(void)
+{
+	pthread_mutex_lock(&mu_lock);
+	if (mu_fd >= 0)
+		mu_transact();
+	int ret = mu_failed ? -1 : 0;
+	pthread_mutex_unlock(&mu_lock);
+
+	return ret;
+}
+
+static void mu_get_stats(struct snvs_backend_stats *stats)
+{
+	pthread_mutex_lock(&mu_lock);
+	*stats = mu_stats;
+	pthread_mutex_unlock(&mu_lock);
+}
+
+static int mu_provision(const struct snvs_provision_config *config)
+{
+	int ret = -1;
+
+	pthread_mutex_lock(&mu_lock);
+	mu_transact();
+	if (!mu_failed) {
+		ret = transport->provision(mu_fd, config, &mu_stats);
+		if (ret < -1) {
+			mu_lost("snvs_mu provision");
+			ret = -1;
+		}
+		mu_stats.messages++;
+		mu_stats.round_trips++;
+	}
+	pthread_mutex_unlock(&mu_lock);
+
+	return ret;
+}
+
+static struct snvs_backend mu_backend = {
+	.read = mu_read,
+	.write = mu_write,
+	.read_many = mu_read_many,
+	.poll = mu_poll,
+	.flush = mu_flush,
+	.stats = mu_get_stats,
+};
+
+/* Posted writes must reach the other side, and the stand-in must be done, before the process ends */
+void snvs_mu_detach(void)
+{
+	if (mu_fd < 0)
+		return;
+	mu_flush();
+	close(mu_fd);
+	mu_fd = -1;
+	waitpid(mu_pid, NULL, 0);
+	mu_failed = 0;
+	transport = NULL;
+	snvs_backend = NULL;
+}
+
+static void close_other_fds(int keep)
+{
+	DIR *dir = opendir("/proc/self/fd");
+	struct dirent *de;
+
+	if (!dir)
+		return;
+	while ((de = readdir(dir))) {
+		int fd = atoi(de->d_name);
+
+		if (fd > 2 && fd != keep && fd != dirfd(dir))
+			close(fd);
+	}
+	closedir(dir);
+}
+
+int snvs_mu_spawn(const struct snvs_mu_transport *t, pid_t *pid, int private_sim)
+{
+	int fds[2];
+
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds))
+		return -1;
+
+	fflush(NULL);
+	*pid = fork();
+	if (*pid < 0) {
+		int err = errno;
+		close(fds[0]);
+		close(fds[1]);
+		errno = err;
+		return -1;
+	}
+	if (!*pid) {
+		//Other stand-ins' sockets must not stay open here, or they never see end of file
+		close_other_fds(fds[1]);
+		//The stand-in drives the simulator itself, it must not route back through a backend
+		snvs_trace_on = 0;
+		snvs_backend = NULL;
+		snvs_sim = 1;
+		if (private_sim)
+			unsetenv("ZMK_SIM_STATE");
+		t->serve(fds[1]);
+		_exit(EXIT_SUCCESS);
+	}
+
+	close(fds[1]);
+	return fds[0];
+}
+
+int snvs_mu_attach(const struct snvs_mu_transport *t)
+{
+	static int stop_at_exit;
+
+	if (mu_fd >= 0)
+		return transport == t ? 0 : (errno = EBUSY, -1);
+	mu_fd = snvs_mu_spawn(t, &mu_pid, 0);
+	if (mu_fd < 0)
+		return -1;
+
+	transport = t;
+	mu_backend.name = t->name;
+	mu_backend.provision = t->provision ? mu_provision : NULL;
+	snvs_backend = &mu_backend;
+	if (!stop_at_exit)
+		stop_at_exit = !atexit(snvs_mu_detach);
+	return 0;
+}
+
+int snvs_mu_start(void)
+{
+	return snvs_mu_attach(&snvs_mu_socket);
+}
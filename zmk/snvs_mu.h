@@ -0,0 +1,133 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	Messaging unit backend
+
+	Register access through a security controller, as on i.MX8 where SNVS is owned by the SCU
+	and reached through a messaging unit. Every exchange with the controller is a round trip, so
+	the backend batches: writes are queued and go out together with the next read, poll or
+	flush, and snapshots and polls are carried as one message each. A poll runs on the
+	controller side and costs one round trip however long it waits.
+
+	snvs_mu_start() forks a local stand-in for the controller that runs the SNVS simulator and
+	talks to the tool over a SOCK_SEQPACKET socket pair with the message layout below. The
+	layout is this tool's own; on a board only the transport changes.
+
+	The batching client is shared with other message based backends (snvs_tee.h): a transport
+	says how a request reaches the other side and what serves it there.
+*/
+
+#ifndef SNVS_MU_H
+#define SNVS_MU_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "libsnvs.h"
+#include "snvs_backend.h"
+
+#define SNVS_MU_MAX_OPS			32
+
+enum snvs_mu_opcode {
+	MU_READ,
+	MU_WRITE,
+	MU_POLL,
+};
+
+struct snvs_mu_op {
+	uint32_t code;
+	uint32_t offset;
+	uint32_t value;			//value to write, or to wait for with MU_POLL
+	uint32_t mask;			//MU_POLL
+	uint32_t timeout_us;		//MU_POLL
+};
+
+struct snvs_mu_request {
+	uint32_t count;
+	struct snvs_mu_op ops[SNVS_MU_MAX_OPS];
+};
+
+struct snvs_mu_result {
+	uint32_t value;			//value read, last value seen by MU_POLL
+	uint32_t failed;		//MU_POLL timed out
+};
+
+struct snvs_mu_reply {
+	uint32_t count;
+	struct snvs_mu_result results[SNVS_MU_MAX_OPS];
+};
+
+struct snvs_mu_transport {
+	const char *name;
+	int synchronous;		//every request is answered (a call that returns); no write can be posted
+	/* Carry a request over fd, and read the answer into reply when wait is set; returns 0 or -1 */
+	int (*exchange)(int fd, const struct snvs_mu_request *request, struct snvs_mu_reply *reply, int wait,
+			struct snvs_backend_stats *stats);
+	/* Optional: run the provisioning sequence on the other side; its result, or -2 if the exchange failed */
+	int (*provision)(int fd, const struct snvs_provision_config *config, struct snvs_backend_stats *stats);
+	/* The other side, run in the forked stand-in until fd reaches end of file */
+	void (*serve)(int fd);
+};
+
+/* Stand-in for the messaging unit controller, and the reply delay it adds to emulate a slower one */
+extern const struct snvs_mu_transport snvs_mu_socket;
+extern unsigned int snvs_mu_latency_us;
+
+/*
+ * Fork a stand-in of transport; returns the socket to it, or -1 with errno set. A private stand-in
+ * ignores ZMK_SIM_STATE and serves a simulator of its own, for one stand-in per board.
+ */
+int snvs_mu_spawn(const struct snvs_mu_transport *t, pid_t *pid, int private_sim);
+
+/* Fork the stand-in of transport and route register accesses through it; returns 0 or -1 with errno set */
+int snvs_mu_attach(const struct snvs_mu_transport *transport);
+
+/* Fork the controller stand-in and route register accesses to it (snvs_mu_attach with the messaging unit) */
+int snvs_mu_start(void);
+
+/* Send the posted writes, stop the stand-in and route register accesses locally again; also run at exit */
+void snvs_mu_detach(void);
+
+/* Size of a request or reply carrying count operations */
+size_t snvs_mu_request_size(unsigned int count);
+size_t snvs_mu_reply_size(unsigned int count);
+
+/* A request is answered when one of its operations returns a value */
+int snvs_mu_needs_reply(const struct snvs_mu_request *request);
+
+/* Execute a request against the mapped (simulated) SNVS page; the controller side of an exchange */
+void snvs_mu_execute(void *mem, const struct snvs_mu_request *request, struct snvs_mu_reply *reply);
+
+#endif /* SNVS_MU_H */
@@ -0,0 +1,551 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "snvs.h"
+#include "snvs_mc.h"
+#include "snvs_gpr.h"
+#include "snvs_tamper.h"
+#include "snvs_mkey.h"
+#include "snvs_sim.h"
+#include "snvs_trace.h"
+#include "snvs_backend.h"
+#include "snvs_fault.h"
+#include "libsnvs.h"
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+static const char * const step_names[] = {
+	"none", "A.1", "A.2", "A.3", "A.4",
+	"B.1", "B.2", "B.3", "B.4", "B.5", "B.6", "B.7", "B.8", "B.9", "B.10",
+	"done"
+};
+
+SNVS_API const char *snvs_step_name(unsigned int step)
+{
+	return step < ARRAY_SIZE(step_names) ? step_names[step] : "unknown";
+}
+
+/* Simulated board time when the simulator has a timing model, wall clock otherwise */
+static uint64_t now_ns(const void *mem)
+{
+	struct timespec ts;
+
+	if (snvs_sim && snvs_sim_timed())
+		return snvs_sim_clock(mem);
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+__attribute__((format(printf, 2, 3)))
+static void say(FILE *log, const char *fmt, ...)
+{
+	uint64_t start = snvs_trace_on ? snvs_trace_now() : 0;
+	va_list ap;
+	int n;
+
+	if (!log)
+		return;
+	va_start(ap, fmt);
+	n = vfprintf(log, fmt, ap);
+	va_end(ap);
+
+	//Console output can stall the sequence, so every log line is a span of its own
+	if (start)
+		snvs_trace_span(TRACE_LOG, NULL, 0, n > 0 ? n : 0, start);
+}
+
+static unsigned int say_tamper_events(const struct snvs_provision_config *config, const void *mem)
+{
+	const struct snvs_event *events[SNVS_TAMPER_MAX_EVENTS];
+	struct snvs_tamper_snapshot snap;
+	unsigned int i, n;
+
+	snvs_tamper_snapshot(mem, &snap);
+	n = snvs_tamper_decode(&snap, events, SNVS_TAMPER_MAX_EVENTS);
+	for (i = 0; i < n; i++)
+		say(config->log, "[INFO] \t\t %s[%s] %s\n", events[i]->reg == SNVS_HPSVSR ? "SNVS_HPSVSR" : "SNVS_LPSR",
+			events[i]->name, events[i]->description);
+
+	return n;
+}
+
+static void enter_step(void *mem, unsigned int step)
+{
+	snvs_trace_step(snvs_step_name(step));
+	if (snvs_faults)
+		snvs_fault_step(mem, step);
+}
+
+static void record_step(const struct snvs_provision_config *config, void *mem, struct snvs_gpr_record *rec, unsigned int step)
+{
+	rec->step = step;
+	if (snvs_gpr_store(mem, rec))
+		say(config->log, "[ERROR] \t\t Step %s could not be recorded in SNVS_LPGPR.\n", snvs_step_name(step));
+}
+
+/*
+ * A record only holds a CRC and a short key fingerprint. Before it lets steps be skipped, the board
+ * has to show what those steps left behind; returns what is missing, NULL if nothing is.
+ */
+static const char *record_contradicted(snvs_t *snvs, const struct snvs_provision_config *config, unsigned int step)
+{
+	uint32_t zmk_locks = config->hard_locks ? ZMK_RHL_MASK | ZMK_WHL_MASK : ZMK_RSL_MASK | ZMK_WSL_MASK;
+	uint32_t mks_lock = config->hard_locks ? MKS_HL_MASK : MKS_SL_MASK;
+	struct snvs_snapshot snap;
+
+	snvs_snapshot(snvs, &snap);
+	uint32_t locks = config->hard_locks ? snap.lplr : snap.hplr;
+
+	if (snvs_read(snvs, SNVS_HPSVSR) & LP_SEC_VIO_MASK)
+		return "an LP security violation may have zeroized the ZMK";
+	if (!(snap.lpmkcr & ZMK_VAL_MASK))
+		return "SNVS_LPMKCR[ZMK_VAL] is clear";
+	if ((locks & zmk_locks) != zmk_locks)
+		return "the ZMK read/write locks are not set";
+	if (step < STEP_DONE)
+		return NULL;
+	if ((snap.lpmkcr & MASTER_KEY_SEL_MASK) != (config->master_key_sel & MASTER_KEY_SEL_MASK) || !(snap.hpcomr & MKS_EN_MASK))
+		return "the master key selection is not the requested one";
+	if (!(locks & mks_lock))
+		return "MASTER_KEY_SEL is not locked";
+
+	return NULL;
+}
+
+static int provision(snvs_t *snvs, const struct snvs_provision_config *config)
+{
+	unsigned int *mem = snvs_base(snvs);
+	unsigned int i;
+
+	snvs_trace_step("identity");
+	const struct snvs_identity *id = snvs_identity(snvs);
+
+	say(config->log, "[INFO] \t SoC UID = 0x%016llx\n", (unsigned long long)id->uid);
+	say(config->log, "[INFO] \t SNVS_HPVIDR1=0x%x, SNVS_HPVIDR2=0x%x\n", id->hpvidr1, id->hpvidr2);
+	say(config->log, "[INFO] \t\t  SNVS_HPVIDR1[IP_ID,MAJOR_REV,MINOR_REV]=[0x%x, 0x%x, 0x%x]\n",
+		snvs_field(id->hpvidr1, IP_ID_MASK), snvs_field(id->hpvidr1, MAJOR_REV_MASK), snvs_field(id->hpvidr1, MINOR_REV_MASK));
+
+	say(config->log, "[INFO] \t The current ZMK key value before starting the ZMK algorithm is 0x%x \n", read_SNVS_reg(mem, SNVS_LPZMKRn));
+	say(config->log, "[INFO] \t SNVS_HPLR  = 0x%x\n", id->hplr);
+	say(config->log, "[INFO] \t SNVS_LPLR  = 0x%x\n", id->lplr);
+
+	uint64_t mc_value;
+	unsigned int mc_era;
+	if (!read_SNVS_mc(mem, &mc_value, &mc_era))
+		say(config->log, "[INFO] \t SNVS_LPSMC = 0x%llx (era 0x%x, SNVS_LPCR[MC_ENV] = %d)\n", (unsigned long long)mc_value, mc_era,
+			get_value_of_SNVS_reg_field(mem, SNVS_LPCR, MC_ENV_MASK, MC_ENV_OFFSET));
+
+	//Decide from the SNVS_LPGPR record whether a previous run already provisioned this key
+	struct snvs_gpr_record rec, prev;
+	bool resume = false, foreign = false;
+
+	rec.policy = (config->hard_locks ? GPR_POLICY_HARD_LOCKS : 0) | ((config->master_key_sel & MASTER_KEY_SEL_MASK) << GPR_POLICY_MKS_OFFSET);
+	snvs_gpr_fingerprint(config->zmk, config->zmk_words, rec.fingerprint);
+
+	if (snvs_gpr_load(mem, &prev)) {
+		say(config->log, "[INFO] \t SNVS_LPGPR holds no provisioning record\n");
+	} else {
+		say(config->log, "[INFO] \t SNVS_LPGPR provisioning record: step %s, policy 0x%x\n", snvs_step_name(prev.step), prev.policy);
+		if (prev.policy == rec.policy && !memcmp(prev.fingerprint, rec.fingerprint, SNVS_GPR_FP_BYTES)) {
+			const char *missing = prev.step >= STEP_B8 ? record_contradicted(snvs, config, STEP_B8) : NULL;
+
+			if (missing) {
+				say(config->log, "[INFO] \t The record does not match the board (%s), running the whole sequence.\n", missing);
+			} else if (prev.step == STEP_DONE) {
+				//A system reset takes back SNVS_HPCOMR[MKS_EN] and the soft locks, B.9 and B.10 put them back
+				const char *left = record_contradicted(snvs, config, STEP_DONE);
+
+				if (!left) {
+					say(config->log, "[SUCCESS] \t ZMK already provisioned with this key and policy, nothing to do.\n");
+					return 0;
+				}
+				say(config->log, "[INFO] \t ZMK provisioned before, but %s.\n", left);
+			}
+			//Once the ZMK locks are set only B.9 and B.10 are left to do
+			resume = !missing && prev.step >= STEP_B8;
+		} else {
+			//Another key or policy; its record stays until this run has replaced the ZMK (B.5)
+			foreign = true;
+		}
+	}
+
+	enter_step(mem, STEP_A1);
+	//A.1. Check transition SSM (System Security Monitor - see SNVS_HPSR[SSM_ST]) from check state to functional state (trusted/secure/non-secure)
+	say(config->log, "[INFO] \t A.1. Checking transition SSM (System Security Monitor - see SNVS_HPSR[SSM_ST]) from check state to functional state (trusted/secure/non-secure)\n");
+	unsigned char SSM_state = get_value_of_SNVS_reg_field(mem, SNVS_HPSR, SSM_ST_MASK, SSM_ST_OFFSET);
+	if (SSM_state < 0xB) {
+		say(config->log, "[ERROR] \t\t Transition of SSM[System Security Monitor] is not trusted, secure or non-secure. Please check the Security Reference Manual for more details.\n");
+		return -1;
+	}
+	switch (SSM_state) {
+		case 0xb:
+			say(config->log, "[INFO] \t\t System Security Monitor is in Non-Secure mode\n");
+			break;
+		case 0xd:
+			say(config->log, "[INFO] \t\t System Security Monitor is in Trusted mode\n");
+			break;
+		case 0xf:
+			say(config->log, "[INFO] \t\t System Security Monitor is in Secure mode\n");
+			break;
+		default:
+			say(config->log, "[ERROR] \t\t System Security Monitor is in an undefined mode. Possible to have a hw problem or a Secure-boot issue (check HAB events.\n");
+			return -1;
+	}
+
+	enter_step(mem, STEP_A2);
+	//A.2. Set the correct value in the Power Glitch Detector Register
+	say(config->log, "[INFO] \t A.2. Set the correct value in the Power Glitch Detector Register.\n");
+	say(config->log, "[INFO] \t\t SNVS_LPPGDR power glitch before init 0x%x\n", read_SNVS_reg(mem, SNVS_LPPGDR));
+	set_value_of_SNVS_reg(mem, SNVS_LPPGDR, POWER_GLITCH_VALUE);
+	say(config->log, "[INFO] \t\t SNVS_LPPGDR power glitch after init 0x%x\n", read_SNVS_reg(mem, SNVS_LPPGDR));
+
+	enter_step(mem, STEP_A3);
+	//A.3. Clear the power glitch record in the LP Status Register
+	say(config->log, "[INFO] \t A.3. Clear the power glitch record in the LP Status Register.\n");
+	say(config->log, "[INFO] \t\t SNVS_LPSR  before init 0x%x\n", read_SNVS_reg(mem, SNVS_LPSR));
+	set_value_of_SNVS_reg(mem, SNVS_LPSR, PGD_MASK);
+	say(config->log, "[INFO] \t\t SNVS_LPSR  after init 0x%x\n", read_SNVS_reg(mem, SNVS_LPSR));
+	if (!foreign)
+		record_step(config, mem, &rec, STEP_A3);
+
+	enter_step(mem, STEP_A4);
+	//A.4. Enable security violations and tamper detection in the SNVS control and configuration registers
+	say(config->log, "[INFO] \t A.4. Enable security violations and tamper detection - using SNVS_HPSVCR, SNVS_LPSVCR, SNVS_LPTDCR\n");
+	if (say_tamper_events(config, mem))
+		say(config->log, "[INFO] \t\t Security violation / tamper events above were recorded before provisioning.\n");
+	struct snvs_tamper_result tamper;
+	if (snvs_tamper_apply(mem, snvs_default_tamper_policy, snvs_default_tamper_policy_len, &tamper)) {
+		say(config->log, "[ERROR] \t\t Register 0x%x did not accept the security violation / tamper policy.\n", tamper.failed_reg);
+		return -1;
+	}
+	say(config->log, "[INFO] \t\t Policy applied with %u register reads and %u writes\n", tamper.reads, tamper.writes);
+	if (!foreign)
+		record_step(config, mem, &rec, STEP_A4);
+
+	if (resume) {
+		say(config->log, "[INFO] \t Previous run stopped after ZMK was programmed and locked, resuming at B.9.\n");
+		goto step_B9;
+	}
+
+	enter_step(mem, STEP_B1);
+	//B.1. Verify that  ZMK_HWP bit is not set - using SNVS_LPMKCR[ZMK_HWP]
+	say(config->log, "[INFO] \t B.1. Verify that ZMK_HWP bit is not set - using SNVS_LPMKCR[ZMK_HWP]\n");
+	say(config->log, "[INFO] \t\t SNVS_LPMKCR before check ZMK_HWP 0x%x\n", read_SNVS_reg(mem, SNVS_LPMKCR));
+	unsigned char ZMK_HWP_state = get_value_of_SNVS_reg_field(mem, SNVS_LPMKCR, ZMK_HWP_MASK, ZMK_HWP_OFFSET);
+	if (ZMK_HWP_state) {
+		say(config->log, "[ERROR] \t\t  SNVS_LPMKCR[ZMK_HWP] Zeroizable Master Key hardware Programming mode is set.  \
+		ZMK is in the hardware programming mode, cannot be programmed by software. See the ZMK hardware programming mechanism in Security RM.\n");
+		return -1;
+	}
+	say(config->log, "[INFO] \t\t SNVS_LPMKCR[ZMK_HWP] Zeroizable Master Key hardware Programming mode is not set.\n");
+
+	enter_step(mem, STEP_B2);
+	//B.2. Verify that ZMK is not locked for write - using SNVS_HPLR, SNVS_LPLR registers
+	say(config->log, "[INFO] \t B.2. Verify that ZMK is not locked for write - using SNVS_HPLR, SNVS_LPLR registers\n");
+
+	say(config->log, "[INFO] \t\t SNVS_HPLR  before checking is 0x%x\n", read_SNVS_reg(mem, SNVS_HPLR));
+	say(config->log, "[INFO] \t\t SNVS_LPLR  before checking is 0x%x\n", read_SNVS_reg(mem, SNVS_LPLR));
+
+	unsigned char ZMK_WSL_state = get_value_of_SNVS_reg_field(mem, SNVS_HPLR, ZMK_WSL_MASK, ZMK_WSL_OFFSET);
+	unsigned char ZMK_RSL_state = get_value_of_SNVS_reg_field(mem, SNVS_HPLR, ZMK_RSL_MASK, ZMK_RSL_OFFSET);
+	unsigned char MKS_SL_state = get_value_of_SNVS_reg_field(mem, SNVS_HPLR, MKS_SL_MASK, MKS_SL_OFFSET);
+
+	unsigned char MKS_HL_state = get_value_of_SNVS_reg_field(mem, SNVS_LPLR, MKS_HL_MASK, MKS_HL_OFFSET);
+	unsigned char ZMK_RHL_state = get_value_of_SNVS_reg_field(mem, SNVS_LPLR, ZMK_RHL_MASK, ZMK_RHL_OFFSET);
+	unsigned char ZMK_WHL_state = get_value_of_SNVS_reg_field(mem, SNVS_LPLR, ZMK_WHL_MASK, ZMK_WHL_OFFSET);
+
+	if (ZMK_WSL_state || ZMK_RSL_state || MKS_SL_state) {
+		say(config->log, "[ERROR] \t\t SNVS_HPLR[ZMK_WSL,ZMK_RSL,MKS_SL] Zeroizable Master Write, Read, Select Soft Locks one of these bits are set - Write access is not allowed.\
+		Once set, these bits can only be cleared by system reset. \n");
+		return -1;
+	}
+
+	say(config->log, "[INFO] \t\t SNVS_HPLR[ZMK_WSL,ZMK_RSL,MKS_SL] Zeroizable Master Write, Read, Select Soft Locks fields are not set.\n");
+
+	if (ZMK_WHL_state || ZMK_RHL_state || MKS_HL_state) {
+		say(config->log, "[ERROR] \t\t SNVS_LPLR[ZMK_WHL,ZMK_RHL,MKS_HL] Zeroizable Master Write, Read, Select Hard Locks one of these bits are set - Write access is not allowed.\
+		Once set, these bits can only be cleared by the LP LOR. \n");
+		return -1;
+	}
+
+	say(config->log, "[INFO] \t\t SNVS_LPLR[ZMK_WHL,ZMK_RHL,MKS_HL] Zeroizable Master Write, Read, Select Hard Locks fields are not set.\n");
+	say(config->log, "[INFO] \t\t SNVS_LPLR[MKS_HL] Master Key Select Hard Lock is not set.\n");
+	say(config->log, "[INFO] \t\t SNVS_LPLR[ZMK_RHL] Zeroizable Master Key Read Hard Lock is not set.\n");
+	enter_step(mem, STEP_B3);
+	say(config->log, "[INFO] \t B.3. Write key value to the ZMK registers.\n");
+	say(config->log, "[INFO] \t\t The ZMK key value before writing with 0x%x is 0x%x \n", config->zmk[0], read_SNVS_reg(mem, SNVS_LPZMKRn));
+
+	for (i = 0; i < config->zmk_words; i++)
+		snvs_write(snvs, SNVS_LPZMKRn + i * ADDR_SIZE, config->zmk[i]);
+
+	enter_step(mem, STEP_B4);
+	say(config->log, "[INFO] \t B.4. Verify that the correct key value is written.\n");
+	for (i = 0; i < config->zmk_words; i++) {
+		if (snvs_read(snvs, SNVS_LPZMKRn + i * ADDR_SIZE) != config->zmk[i]) {
+			say(config->log, "[ERROR] \t\t The new ZMK key value 0x%x is not matching with the user desire value!!! \n",
+				snvs_read(snvs, SNVS_LPZMKRn + i * ADDR_SIZE));
+			return -1;
+		}
+	}
+	say(config->log, "[SUCCESS] \t\t The new ZMK key value is = 0x%x and matches with the user desired value.\n", read_SNVS_reg(mem, SNVS_LPZMKRn));
+
+	enter_step(mem, STEP_B5);
+	say(config->log, "[INFO] \t B.5. Set SNVS_LPMKCR[ZMK_VAL] bit if the ZMK (or the ZMK XORed with the OTPMK) will be used by CAAM as the master key.\n");
+
+	say(config->log, "[INFO] \t\t SNVS_LPMKCR  before init 0x%x\n", read_SNVS_reg(mem, SNVS_LPMKCR));
+	snvs_set_bits(snvs, SNVS_LPMKCR, ZMK_VAL_MASK);
+	say(config->log, "[INFO] \t\t SNVS_LPMKCR  after init 0x%x\n", read_SNVS_reg(mem, SNVS_LPMKCR));
+	record_step(config, mem, &rec, STEP_B5);
+
+	enter_step(mem, STEP_B6);
+	say(config->log, "[INFO] \t B.6 (optional) Set SNVS_LPMKCR[ZMK_ECC_EN] bit to enable ZMK error correction code verification. \
+								\n\t Software can verify that the correct nine bit codeword is generated by reading ZMK_ECC_VALUE field.\n");
+	snvs_set_bits(snvs, SNVS_LPMKCR, ZMK_ECC_EN);
+
+	enter_step(mem, STEP_B7);
+	say(config->log, "[INFO] \t B.7 (optional) Block software read accesses to the ZMK registers and ZMK_ECC_VALUE field by setting ZMK Read lock bit.\n");
+	say(config->log, "[INFO] \t B.8 (optional) Block software write accesses to the ZMK registers by setting ZMK Write Lock bit.\n");
+
+	//Both locks go out with a single read-modify-write of the lock register
+	if (config->hard_locks) {
+		//POR to clear next bits
+		snvs_wc_set(snvs, SNVS_LPLR, ZMK_RHL_MASK);
+		snvs_wc_set(snvs, SNVS_LPLR, ZMK_WHL_MASK);
+	} else {
+		//system reset to clear next bits
+		snvs_wc_set(snvs, SNVS_HPLR, ZMK_RSL_MASK);
+		snvs_wc_set(snvs, SNVS_HPLR, ZMK_WSL_MASK);
+	}
+	if (snvs_wc_flush(snvs) < 0) {
+		say(config->log, "[ERROR] \t\t The ZMK read/write lock bits did not stick.\n");
+		return -1;
+	}
+
+	enter_step(mem, STEP_B8);
+	//Let some time for SNVS_LPZMKRn to be cleared after ZMK_RHL was set
+	unsigned int timeout_us = config->zeroize_timeout_us ? config->zeroize_timeout_us : SNVS_ZEROIZE_TIMEOUT_US;
+	uint64_t t0 = now_ns(mem);
+	int zeroized = !snvs_poll(snvs, SNVS_LPZMKRn, ~0U, 0, timeout_us);
+	uint64_t t1 = now_ns(mem);
+
+	say(config->log, "[INFO] \t\t [SECURITY_CHECK] if SNVS_LPZMKRn is zero'd after ZMK_RHL was set\n");
+	if (read_SNVS_reg(mem, SNVS_LPZMKRn) == 0x0) {
+		say(config->log, "[INFO] \t\t [PASSED] - SNVS_LPZMKRn is 0x0 and cannot be read by a hacker\n");
+		if (zeroized)
+			say(config->log, "[INFO] \t\t SNVS_LPZMKRn read as zero %llu ns after the read lock was set\n",
+				(unsigned long long)(t1 - t0));
+	} else {
+		say(config->log, "[INFO] \t\t [FAILED] - SNVS_LPZMKRn is 0x%x and can be read by a hacker. Try to increase zeroize_timeout_us\n", read_SNVS_reg(mem, SNVS_LPZMKRn));
+	}
+	record_step(config, mem, &rec, STEP_B8);
+
+step_B9:
+	enter_step(mem, STEP_B9);
+	say(config->log, "[INFO] \t B.9. Set SNVS_LPMKCR[MASTER_KEY_SEL] and SNVS_HPCOMR[MKS_EN] bits to select combination of OTPMK and ZMK to be provided to the hardware cryptographic module.\n");
+	say(config->log, "[INFO] \t\t MASTER_KEY_SEL is set as 0x%x - 0b10 selects the zeroizable master key when MKS_EN bit is set.\n",
+		config->master_key_sel & MASTER_KEY_SEL_MASK);
+	snvs_set_bits(snvs, SNVS_LPMKCR, config->master_key_sel & MASTER_KEY_SEL_MASK);
+	say(config->log, "[INFO] \t\t SNVS_LPMKCR  after init 0x%x\n", read_SNVS_reg(mem, SNVS_LPMKCR));
+
+	say(config->log, "[INFO] \t\t SNVS_HPCOMR  before init 0x%x\n", read_SNVS_reg(mem, SNVS_HPCOMR));
+	set_value_of_SNVS_reg(mem, SNVS_HPCOMR, MKS_EN_MASK);
+	say(config->log, "[INFO] \t\t SNVS_HPCOMR  after init 0x%x\n", read_SNVS_reg(mem, SNVS_HPCOMR));
+	record_step(config, mem, &rec, STEP_B9);
+
+	enter_step(mem, STEP_B10);
+	say(config->log, "[INFO] \t B.10 (optional) Block software write accesses to the MASTER_KEY_SEL field by setting MKS lock bit.\n");
+
+	if (config->hard_locks) {
+		//POR to clear next bit
+		snvs_set_bits(snvs, SNVS_LPLR, MKS_HL_MASK);
+	} else {
+		//system reset to clear next bit
+		snvs_set_bits(snvs, SNVS_HPLR, MKS_SL_MASK);
+	}
+	record_step(config, mem, &rec, STEP_DONE);
+	snvs_trace_step(NULL);
+
+	return 0;
+}
+
+SNVS_API int snvs_provision(snvs_t *snvs, const struct snvs_provision_config *config)
+{
+	if (!config->zmk_words || config->zmk_words > ARRAY_SIZE(config->zmk))
+		return -1;
+
+	//A backend that owns SNVS on the other side runs the whole sequence there in one exchange
+	if (snvs_backend && snvs_backend->provision)
+		return snvs_backend->provision(config);
+
+	int ret = provision(snvs, config);
+
+	//Once a backend lost the other side its reads were poison, whatever the sequence concluded
+	if (snvs_backend && snvs_backend->flush && snvs_backend->flush())
+		return -1;
+	return ret;
+}
+
+/*
+ * ZMK rotation. Everything that can be checked or computed is done before the first write; the
+ * window only holds the register accesses that must happen while the master key is switched:
+ *
+ *	SNVS_LPMKCR	MASTER_KEY_SEL = OTPMK		window opens (read-modify-write)
+ *	SNVS_LPZMKRn	changed words only
+ *	SNVS_LPZMKRn	read back of the written words
+ *	SNVS_LPMKCR	original selection		window closes (read-modify-write)
+ *
+ * Nothing is logged inside the window. When the ZMK is not part of the master key (MKS_EN
+ * clear or an OTPMK selection) the words are written without opening a window at all.
+ */
+SNVS_API int snvs_rotate(snvs_t *snvs, const struct snvs_rotate_config *config, struct snvs_rotate_result *result)
+{
+	unsigned int *mem = snvs_base(snvs);
+	uint32_t old[SNVS_LPZMKR_COUNT], key[SNVS_LPZMKR_COUNT];
+	unsigned int plan[SNVS_LPZMKR_COUNT], i, n = 0, bad = 0;
+	uint64_t start = now_ns(mem), t0, t1;
+
+	memset(result, 0, sizeof(*result));
+	if (!config->zmk_words || config->zmk_words > SNVS_LPZMKR_COUNT)
+		return -1;
+	snvs_trace_step("rotate staging");
+
+	//Staging: lock state, current key and selection, the writes to issue
+	struct snvs_snapshot snap;
+	snvs_snapshot(snvs, &snap);
+
+	if (snap.lplr & (ZMK_WHL_MASK | MKS_HL_MASK)) {
+		say(config->log, "[ERROR] \t ZMK or MASTER_KEY_SEL is hard locked (SNVS_LPLR = 0x%x), only a POR clears the lock.\n", snap.lplr);
+		return -1;
+	}
+	if (snap.hplr & (ZMK_WSL_MASK | MKS_SL_MASK)) {
+		say(config->log, "[ERROR] \t ZMK or MASTER_KEY_SEL is soft locked (SNVS_HPLR = 0x%x), rotate after a system reset before the locks are set again.\n", snap.hplr);
+		return -1;
+	}
+	if (snap.lpmkcr & ZMK_HWP_MASK) {
+		say(config->log, "[ERROR] \t The ZMK is in hardware programming mode (SNVS_LPMKCR[ZMK_HWP]), software cannot write it.\n");
+		return -1;
+	}
+	if ((snap.hplr & ZMK_RSL_MASK) || (snap.lplr & ZMK_RHL_MASK)) {
+		say(config->log, "[ERROR] \t The ZMK is read locked, a new key could not be verified.\n");
+		return -1;
+	}
+
+	memset(key, 0, sizeof(key));
+	memcpy(key, config->zmk, config->zmk_words * sizeof(key[0]));
+	for (i = 0; i < SNVS_LPZMKR_COUNT; i++) {
+		old[i] = read_SNVS_reg(mem, SNVS_LPZMKRn + 4 * i);
+		if (old[i] != key[i])
+			plan[n++] = i;
+	}
+
+	enum snvs_mkey_source source = snvs_mkey_select(snap.lpmkcr, snap.hpcomr);
+	int window = source == MKEY_ZMK || source == MKEY_OTPMK_XOR_ZMK;
+	uint32_t lpmkcr_back = snap.lpmkcr | ZMK_VAL_MASK;
+
+	say(config->log, "[INFO] \t Master key in use: %s; %u of %u ZMK words change\n", snvs_mkey_source_name(source), n, SNVS_LPZMKR_COUNT);
+	if (!n) {
+		say(config->log, "[SUCCESS] \t The new ZMK is already installed, nothing to do.\n");
+		result->total_ns = now_ns(mem) - start;
+		return 0;
+	}
+	if (config->dry_run) {
+		say(config->log, "[INFO] \t Dry run: %u register accesses would run %s\n", 2 * n + (window ? 4 : 0),
+			window ? "with the master key switched to the OTPMK" : "without a window, the ZMK is not in use");
+		result->window_accesses = window ? 2 * n + 4 : 0;
+		result->total_ns = now_ns(mem) - start;
+		return 0;
+	}
+
+	snvs_trace_step("rotate window");
+	t0 = now_ns(mem);
+	result->staging_ns = t0 - start;
+	//Only MASTER_KEY_SEL moves; a modify keeps the rest of SNVS_LPMKCR as other updaters left it
+	if (window)
+		snvs_modify(snvs, SNVS_LPMKCR, MASTER_KEY_SEL_MASK, 0);
+	for (i = 0; i < n; i++)
+		snvs_write(snvs, SNVS_LPZMKRn + 4 * plan[i], key[plan[i]]);
+	for (i = 0; i < n; i++)
+		bad += read_SNVS_reg(mem, SNVS_LPZMKRn + 4 * plan[i]) != key[plan[i]];
+	if (!bad && window)
+		snvs_modify(snvs, SNVS_LPMKCR, MASTER_KEY_SEL_MASK, snap.lpmkcr & MASTER_KEY_SEL_MASK);
+	t1 = now_ns(mem);
+	snvs_trace_step("rotate report");
+
+	result->words_written = n;
+	if (window) {
+		result->window_ns = t1 - t0;
+		result->window_accesses = 2 * n + 2 + 2 * !bad;
+	}
+
+	if (bad) {
+		say(config->log, "[ERROR] \t %u ZMK words did not verify; MASTER_KEY_SEL stays on the OTPMK (SNVS_LPMKCR = 0x%x).\n",
+			bad, read_SNVS_reg(mem, SNVS_LPMKCR));
+		result->total_ns = now_ns(mem) - start;
+		return -1;
+	}
+	if (!window)
+		snvs_set_bits(snvs, SNVS_LPMKCR, ZMK_VAL_MASK);
+	if ((read_SNVS_reg(mem, SNVS_LPMKCR) & lpmkcr_back) != lpmkcr_back) {
+		say(config->log, "[ERROR] \t SNVS_LPMKCR = 0x%x did not take the original selection back.\n", read_SNVS_reg(mem, SNVS_LPMKCR));
+		result->total_ns = now_ns(mem) - start;
+		return -1;
+	}
+
+	for (i = 0; i < n; i++)
+		say(config->log, "[INFO] \t\t SNVS_LPZMKR%u 0x%08x -> 0x%08x\n", plan[i], old[plan[i]], key[plan[i]]);
+	if (window)
+		say(config->log, "[INFO] \t Master key was switched away from the ZMK for %llu ns (%u register accesses)\n",
+			(unsigned long long)result->window_ns, result->window_accesses);
+	else
+		say(config->log, "[INFO] \t The ZMK is not part of the master key, no window was needed\n");
+
+	if (config->soft_lock) {
+		snvs_wc_set(snvs, SNVS_HPLR, ZMK_WSL_MASK | ZMK_RSL_MASK | MKS_SL_MASK);
+		if (snvs_wc_flush(snvs) < 0) {
+			say(config->log, "[ERROR] \t The soft lock bits did not stick.\n");
+			result->total_ns = now_ns(mem) - start;
+			return -1;
+		}
+		say(config->log, "[INFO] \t ZMK_WSL, ZMK_RSL and MKS_SL set until the next system reset\n");
+	}
+
+	result->total_ns = now_ns(mem) - start;
+	snvs_trace_step(NULL);
+	say(config->log, "[SUCCESS] \t ZMK rotated. Blobs made under the old master key need blob-migrate.\n");
+	return 0;
+}
@@ -0,0 +1,378 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	SNVS register tables, reset values, simulator write handler and decoder
+
+	Generated by regmap.py from snvs_regs.yaml, do not edit; run "make regs" instead.
+*/
+
+#include <stdio.h>
+
+#include "snvs_regs.h"
+#include "libsnvs.h"
+
+#define snvs_reg32(mem, offset)	(*(const volatile uint32_t *)((const volatile char *)(mem) + (offset)))
+
+static const struct snvs_reg_field hplr_fields[] = {
+	{ "ZMK_WSL", 0x00000001, 0 },
+	{ "ZMK_RSL", 0x00000002, 1 },
+	{ "MC_SL", 0x00000010, 4 },
+	{ "MKS_SL", 0x00000200, 9 },
+};
+
+static const struct snvs_reg_field hpcomr_fields[] = {
+	{ "MKS_EN", 0x00002000, 13 },
+};
+
+static const struct snvs_reg_field hpsvcr_fields[] = {
+	{ "SV_CFG", 0x0000003f, 0 },
+	{ "LPSV_CFG", 0xc0000000, 30 },
+};
+
+static const struct snvs_reg_field hpsr_fields[] = {
+	{ "SSM_ST", 0x00000f00, 8 },
+};
+
+static const struct snvs_reg_field hpsvsr_fields[] = {
+	{ "SV", 0x0000003f, 0 },
+	{ "SW_SV", 0x00002000, 13 },
+	{ "SW_FSV", 0x00004000, 14 },
+	{ "SW_LPSV", 0x00008000, 15 },
+	{ "ZMK_ECC_FAIL", 0x08000000, 27 },
+	{ "LP_SEC_VIO", 0x80000000, 31 },
+};
+
+static const struct snvs_reg_field lplr_fields[] = {
+	{ "ZMK_WHL", 0x00000001, 0 },
+	{ "ZMK_RHL", 0x00000002, 1 },
+	{ "MC_HL", 0x00000010, 4 },
+	{ "MKS_HL", 0x00000200, 9 },
+};
+
+static const struct snvs_reg_field lpcr_fields[] = {
+	{ "SRTC_ENV", 0x00000001, 0 },
+	{ "MC_ENV", 0x00000004, 2 },
+};
+
+static const struct snvs_reg_field lpmkcr_fields[] = {
+	{ "MASTER_KEY_SEL", 0x00000003, 0 },
+	{ "ZMK_HWP", 0x00000004, 2 },
+	{ "ZMK_VAL", 0x00000008, 3 },
+	{ "ZMK_ECC_EN", 0x00000010, 4 },
+};
+
+static const struct snvs_reg_field lpsvcr_fields[] = {
+	{ "SV_EN", 0x0000003f, 0 },
+};
+
+static const struct snvs_reg_field lptdcr_fields[] = {
+	{ "SRTCR_EN", 0x00000002, 1 },
+	{ "MCR_EN", 0x00000004, 2 },
+	{ "ET1_EN", 0x00000200, 9 },
+	{ "ET1P", 0x00000800, 11 },
+	{ "PFD_OBSERV", 0x00004000, 14 },
+	{ "POR_OBSERV", 0x00008000, 15 },
+};
+
+static const struct snvs_reg_field lpsr_fields[] = {
+	{ "LPTA", 0x00000001, 0 },
+	{ "SRTCR", 0x00000002, 1 },
+	{ "MCR", 0x00000004, 2 },
+	{ "PGD", 0x00000008, 3 },
+	{ "ET1D", 0x00000200, 9 },
+	{ "ESVD", 0x00010000, 16 },
+	{ "EO", 0x00020000, 17 },
+	{ "SPO", 0x00040000, 18 },
+};
+
+static const struct snvs_reg_field lpsrtcmr_fields[] = {
+	{ "SRTC_MSB", 0x00007fff, 0 },
+};
+
+static const struct snvs_reg_field lpsmcmr_fields[] = {
+	{ "MC_MSB", 0x0000ffff, 0 },
+	{ "MC_ERA_BITS", 0xffff0000, 16 },
+};
+
+static const struct snvs_reg_field hpvidr1_fields[] = {
+	{ "IP_ID", 0xffff0000, 16 },
+	{ "MAJOR_REV", 0x0000ff00, 8 },
+	{ "MINOR_REV", 0x000000ff, 0 },
+};
+
+const struct snvs_reg snvs_regs_table[] = {
+	{ "SNVS_HPLR", SNVS_HPLR, 1, 0x00000000, hplr_fields, 4 },
+	{ "SNVS_HPCOMR", SNVS_HPCOMR, 1, 0x80000100, hpcomr_fields, 1 },
+	{ "SNVS_HPCR", SNVS_HPCR, 1, 0x00000000, NULL, 0 },
+	{ "SNVS_HPSVCR", SNVS_HPSVCR, 1, 0x00000000, hpsvcr_fields, 2 },
+	{ "SNVS_HPSR", SNVS_HPSR, 1, 0x00000b00, hpsr_fields, 1 },
+	{ "SNVS_HPSVSR", SNVS_HPSVSR, 1, 0x00000000, hpsvsr_fields, 6 },
+	{ "SNVS_LPLR", SNVS_LPLR, 1, 0x00000000, lplr_fields, 4 },
+	{ "SNVS_LPCR", SNVS_LPCR, 1, 0x00000001, lpcr_fields, 2 },
+	{ "SNVS_LPMKCR", SNVS_LPMKCR, 1, 0x00000000, lpmkcr_fields, 4 },
+	{ "SNVS_LPSVCR", SNVS_LPSVCR, 1, 0x00000000, lpsvcr_fields, 1 },
+	{ "SNVS_LPTDCR", SNVS_LPTDCR, 1, 0x00000000, lptdcr_fields, 6 },
+	{ "SNVS_LPSR", SNVS_LPSR, 1, 0x40000000, lpsr_fields, 8 },
+	{ "SNVS_LPSRTCMR", SNVS_LPSRTCMR, 1, 0x00000000, lpsrtcmr_fields, 1 },
+	{ "SNVS_LPSRTCLR", SNVS_LPSRTCLR, 1, 0x00000000, NULL, 0 },
+	{ "SNVS_LPSMCMR", SNVS_LPSMCMR, 1, 0x00000000, lpsmcmr_fields, 2 },
+	{ "SNVS_LPSMCLR", SNVS_LPSMCLR, 1, 0x00000000, NULL, 0 },
+	{ "SNVS_LPPGDR", SNVS_LPPGDR, 1, 0x00000000, NULL, 0 },
+	{ "SNVS_LPGPR", SNVS_LPGPR, 1, 0x00000000, NULL, 0 },
+	{ "SNVS_LPZMKRn", SNVS_LPZMKRn, 8, 0x00000000, NULL, 0 },
+	{ "SNVS_HPVIDR1", SNVS_HPVIDR1, 1, 0x003e0100, hpvidr1_fields, 3 },
+	{ "SNVS_HPVIDR2", SNVS_HPVIDR2, 1, 0x00000000, NULL, 0 },
+};
+
+const unsigned int snvs_regs_count = sizeof(snvs_regs_table) / sizeof(snvs_regs_table[0]);
+
+const struct snvs_reg *snvs_reg_lookup(unsigned int offset)
+{
+	unsigned int i;
+
+	for (i = 0; i < snvs_regs_count; i++)
+		if (offset >= snvs_regs_table[i].offset && offset < snvs_regs_table[i].offset + 4 * snvs_regs_table[i].count)
+			return &snvs_regs_table[i];
+
+	return NULL;
+}
+
+static const unsigned int snvs_regs_read_offsets[] = {
+	SNVS_HPLR,
+	SNVS_HPCOMR,
+	SNVS_HPCR,
+	SNVS_HPSVCR,
+	SNVS_HPSR,
+	SNVS_HPSVSR,
+	SNVS_LPLR,
+	SNVS_LPCR,
+	SNVS_LPMKCR,
+	SNVS_LPSVCR,
+	SNVS_LPTDCR,
+	SNVS_LPSR,
+	SNVS_LPSRTCMR,
+	SNVS_LPSRTCLR,
+	SNVS_LPSMCMR,
+	SNVS_LPSMCLR,
+	SNVS_LPPGDR,
+	SNVS_LPGPR,
+	SNVS_LPZMKRn + 0,
+	SNVS_LPZMKRn + 4,
+	SNVS_LPZMKRn + 8,
+	SNVS_LPZMKRn + 12,
+	SNVS_LPZMKRn + 16,
+	SNVS_LPZMKRn + 20,
+	SNVS_LPZMKRn + 24,
+	SNVS_LPZMKRn + 28,
+	SNVS_HPVIDR1,
+	SNVS_HPVIDR2,
+};
+
+void snvs_regs_read(const struct snvs *snvs, struct snvs_regs *regs)
+{
+	uint32_t v[28];
+	unsigned int i;
+
+	//One batch, so a backend behind a controller fetches every register in one exchange
+	snvs_read_many(snvs, snvs_regs_read_offsets, v, 28);
+	regs->hplr = v[0];
+	regs->hpcomr = v[1];
+	regs->hpcr = v[2];
+	regs->hpsvcr = v[3];
+	regs->hpsr = v[4];
+	regs->hpsvsr = v[5];
+	regs->lplr = v[6];
+	regs->lpcr = v[7];
+	regs->lpmkcr = v[8];
+	regs->lpsvcr = v[9];
+	regs->lptdcr = v[10];
+	regs->lpsr = v[11];
+	regs->lpsrtcmr = v[12];
+	regs->lpsrtclr = v[13];
+	regs->lpsmcmr = v[14];
+	regs->lpsmclr = v[15];
+	regs->lppgdr = v[16];
+	regs->lpgpr = v[17];
+	for (i = 0; i < 8; i++)
+		regs->lpzmkr[i] = v[18 + i];
+	regs->hpvidr1 = v[26];
+	regs->hpvidr2 = v[27];
+}
+
+static const unsigned int snvs_regs_snapshot_offsets[] = {
+	SNVS_HPLR,
+	SNVS_HPCOMR,
+	SNVS_HPSR,
+	SNVS_LPLR,
+	SNVS_LPCR,
+	SNVS_LPMKCR,
+	SNVS_LPSR,
+	SNVS_LPGPR,
+	SNVS_HPVIDR1,
+	SNVS_HPVIDR2,
+};
+
+void snvs_regs_snapshot(const struct snvs *snvs, struct snvs_snapshot *snap)
+{
+	uint32_t v[10];
+
+	//One batch, so a backend behind a controller fetches every register in one exchange
+	snvs_read_many(snvs, snvs_regs_snapshot_offsets, v, 10);
+	snap->hplr = v[0];
+	snap->hpcomr = v[1];
+	snap->hpsr = v[2];
+	snap->lplr = v[3];
+	snap->lpcr = v[4];
+	snap->lpmkcr = v[5];
+	snap->lpsr = v[6];
+	snap->lpgpr = v[7];
+	snap->hpvidr1 = v[8];
+	snap->hpvidr2 = v[9];
+}
+
+void snvs_regs_reset(volatile void *mem)
+{
+	*(volatile uint32_t *)((volatile char *)mem + SNVS_HPCOMR) = 0x80000100;
+	*(volatile uint32_t *)((volatile char *)mem + SNVS_HPSR) = 0x00000b00;
+	*(volatile uint32_t *)((volatile char *)mem + SNVS_LPCR) = 0x00000001;
+	*(volatile uint32_t *)((volatile char *)mem + SNVS_LPSR) = 0x40000000;
+	*(volatile uint32_t *)((volatile char *)mem + SNVS_HPVIDR1) = 0x003e0100;
+}
+
+/*
+ * Value a register holds after software writes value over old: read-only and locked bits
+ * keep old, sticky bits only set, write-1-to-clear bits only clear.
+ */
+uint32_t snvs_regs_sim_update(const volatile void *mem, unsigned int offset, uint32_t old, uint32_t value)
+{
+	uint32_t ro, sticky, w1c;
+
+	switch (offset) {
+	case SNVS_HPLR:
+		ro = 0x00000000;
+		sticky = 0xffffffff;
+		w1c = 0x00000000;
+		break;
+	case SNVS_HPSR:
+		ro = 0xffffffff;
+		sticky = 0x00000000;
+		w1c = 0x00000000;
+		break;
+	case SNVS_HPSVSR:
+		ro = 0x00000000;
+		sticky = 0x00000000;
+		w1c = 0xffffffff;
+		break;
+	case SNVS_LPLR:
+		ro = 0x00000000;
+		sticky = 0xffffffff;
+		w1c = 0x00000000;
+		break;
+	case SNVS_LPMKCR:
+		ro = 0x00000004;
+		if ((snvs_reg32(mem, SNVS_LPLR) & 0x200) || (snvs_reg32(mem, SNVS_HPLR) & 0x200))
+			ro |= 0x00000003;	//MASTER_KEY_SEL
+		sticky = 0x00000000;
+		w1c = 0x00000000;
+		break;
+	case SNVS_LPSR:
+		ro = 0xfff8fdf0;
+		sticky = 0x00000000;
+		w1c = 0x0007020f;
+		break;
+	case SNVS_LPSRTCMR:
+		ro = 0xffffffff;
+		sticky = 0x00000000;
+		w1c = 0x00000000;
+		break;
+	case SNVS_LPSRTCLR:
+		ro = 0xffffffff;
+		sticky = 0x00000000;
+		w1c = 0x00000000;
+		break;
+	case SNVS_LPSMCMR:
+		ro = 0xffffffff;
+		sticky = 0x00000000;
+		w1c = 0x00000000;
+		break;
+	case SNVS_LPSMCLR:
+		ro = 0xffffffff;
+		sticky = 0x00000000;
+		w1c = 0x00000000;
+		break;
+	case SNVS_LPZMKRn ... SNVS_LPZMKRn + 28:
+		if ((snvs_reg32(mem, SNVS_HPLR) & 0x1) || (snvs_reg32(mem, SNVS_LPLR) & 0x1) || (snvs_reg32(mem, SNVS_LPMKCR) & 0x4))
+			return old;
+		ro = 0x00000000;
+		sticky = 0x00000000;
+		w1c = 0x00000000;
+		break;
+	case SNVS_HPVIDR1:
+		ro = 0xffffffff;
+		sticky = 0x00000000;
+		w1c = 0x00000000;
+		break;
+	case SNVS_HPVIDR2:
+		ro = 0xffffffff;
+		sticky = 0x00000000;
+		w1c = 0x00000000;
+		break;
+	default:
+		return value;
+	}
+
+	return (old & ro) | ((old | value) & sticky & ~ro) | (old & ~value & w1c & ~ro) |
+		(value & ~(ro | sticky | w1c));
+}
+
+/* Formats "NAME = 0xVALUE FIELD=x ..."; returns the length snprintf() would need */
+size_t snvs_regs_decode(unsigned int offset, uint32_t value, char *buf, size_t len)
+{
+	const struct snvs_reg *reg = snvs_reg_lookup(offset);
+	size_t n;
+	unsigned int i;
+
+	if (!reg)
+		return snprintf(buf, len, "0x%03x = 0x%08x", offset, value);
+
+	if (reg->count > 1)
+		n = snprintf(buf, len, "%s[%u] = 0x%08x", reg->name, (offset - reg->offset) / 4, value);
+	else
+		n = snprintf(buf, len, "%s = 0x%08x", reg->name, value);
+	for (i = 0; i < reg->nfields; i++)
+		n += snprintf(n < len ? buf + n : NULL, n < len ? len - n : 0, " %s=0x%x", reg->fields[i].name,
+			(value & reg->fields[i].mask) >> reg->fields[i].shift);
+
+	return n;
+}
@@ -0,0 +1,228 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	SNVS register map
+
+	Generated by regmap.py from snvs_regs.yaml, do not edit; run "make regs" instead.
+*/
+
+#ifndef SNVS_REGS_H
+#define SNVS_REGS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//SNVS = Secure Non-Volatile Storage registers
+#define SNVS_BASE_REG			0x020cc000
+
+//SNVS registers offsets (all these need to be referred using SNVS_BASE_REG)
+#define SNVS_HPLR			0x0		//SNVS_HP Lock Register (contains lock bits for the SNVS registers; this is a privileged write register)
+	#define ZMK_WSL_MASK		0x1
+	#define ZMK_WSL_OFFSET		0
+	#define ZMK_RSL_MASK		0x2
+	#define ZMK_RSL_OFFSET		1
+	#define MC_SL_MASK		0x10
+	#define MC_SL_OFFSET		4
+	#define MKS_SL_MASK		0x0200
+	#define MKS_SL_OFFSET		9
+
+#define SNVS_HPCOMR			0x4		//SNVS_HP Command Register
+	#define MKS_EN_MASK		0x00002000
+	#define MKS_EN_OFFSET		13
+
+#define SNVS_HPCR			0x8		//SNVS_HP Control Register
+
+#define SNVS_HPSVCR			0x10		//SNVS_HP Security Violation Control Register
+	#define SV_CFG_MASK		0x0000003F	//SVn_CFG: 1 = security violation n is fatal
+	#define LPSV_CFG_MASK		0xC0000000
+	#define LPSV_CFG_OFFSET		30
+	#define LPSV_CFG_DISABLED	0x0
+	#define LPSV_CFG_NONFATAL	0x1
+	#define LPSV_CFG_FATAL		0x2
+
+#define SNVS_HPSR			0x14		//SNVS_HP Status Register	(reflects the internal state of the SNVS)
+	#define SSM_ST_MASK		0x00000F00
+	#define SSM_ST_OFFSET		8
+
+#define SNVS_HPSVSR			0x18		//SNVS_HP Security Violation Status Register
+	#define SV_MASK			0x0000003F
+	#define SW_SV_MASK		0x00002000
+	#define SW_FSV_MASK		0x00004000
+	#define SW_LPSV_MASK		0x00008000
+	#define ZMK_ECC_FAIL_MASK	0x08000000
+	#define LP_SEC_VIO_MASK		0x80000000
+
+#define SNVS_LPLR			0x34		//SNVS_LP Lock Register (contains lock bits for the SNVS_LP registers)
+	#define ZMK_WHL_MASK		0x1
+	#define ZMK_WHL_OFFSET		0
+	#define ZMK_RHL_MASK		0x2
+	#define ZMK_RHL_OFFSET		1
+	#define MC_HL_MASK		0x10
+	#define MC_HL_OFFSET		4
+	#define MKS_HL_MASK		0x200
+	#define MKS_HL_OFFSET		9
+
+#define SNVS_LPCR			0x38		//SNVS_LP Control Register
+	#define SRTC_ENV_MASK		0x1
+	#define SRTC_ENV_OFFSET		0
+	#define MC_ENV_MASK		0x4
+	#define MC_ENV_OFFSET		2
+
+#define SNVS_LPMKCR			0x3C		//SNVS_LP Master Key Control Register
+	#define ZMK_HWP_MASK		0x4
+	#define ZMK_HWP_OFFSET		2
+	#define ZMK_VAL_MASK		0x8
+	#define ZMK_VAL_OFFSET		3
+	#define ZMK_ECC_EN		0x10
+	#define MASTER_KEY_SEL_VALUE	0x2
+
+#define SNVS_LPSVCR			0x40		//SNVS_LP Security Violation Control Register
+	#define SV_EN_MASK		0x0000003F	//SVn_EN: security violation n is an LP security violation
+
+#define SNVS_LPTDCR			0x48		//SNVS_LP Tamper Detectors Configuration Register
+	#define SRTCR_EN_MASK		0x00000002
+	#define MCR_EN_MASK		0x00000004
+	#define ET1_EN_MASK		0x00000200
+	#define ET1P_MASK		0x00000800
+	#define PFD_OBSERV_MASK		0x00004000
+	#define POR_OBSERV_MASK		0x00008000
+
+#define SNVS_LPSR			0x4c		//SNVS_LP Status Register (reflects the internal state and behavior of the SNVS_LP) (need to write 1 to PGD)
+	#define LPTA_MASK		0x00000001
+	#define SRTCR_MASK		0x00000002
+	#define MCR_MASK		0x4
+	#define PGD_MASK		0x8
+	#define ET1D_MASK		0x00000200
+	#define ESVD_MASK		0x00010000
+	#define EO_MASK			0x00020000
+	#define SPO_MASK		0x00040000
+
+#define SNVS_LPSRTCMR			0x50		//SNVS_LP Secure Real Time Counter MSB Register (bits 14..0 are SRTC[46:32])
+	#define SRTC_MSB_MASK		0x7FFF
+
+#define SNVS_LPSRTCLR			0x54		//SNVS_LP Secure Real Time Counter LSB Register (SRTC[31:0])
+
+#define SNVS_LPSMCMR			0x5c		//SNVS_LP Secure Monotonic Counter MSB Register (any write increments the counter)
+	#define MC_MSB_MASK		0x0000FFFF
+	#define MC_ERA_BITS_MASK	0xFFFF0000
+	#define MC_ERA_BITS_OFFSET	16
+
+#define SNVS_LPSMCLR			0x60		//SNVS_LP Secure Monotonic Counter LSB Register (any write increments the counter)
+
+#define SNVS_LPPGDR			0x64		//SNVS_LP Power Glitch Detector Register (by default need to write 0x41736166 accordint with Security RM)
+	#define POWER_GLITCH_VALUE	0x41736166
+
+#define SNVS_LPGPR			0x68		//SNVS_LP General Purpose Register
+
+#define SNVS_LPZMKRn			0x6c		//8 registers SNVS_LPZMKR0 ... SNVS_LPZMKR7; this example will set up only SNVS_LPZMKR0
+	#define SNVS_LPZMKR_COUNT	8
+	#define ZMK_VALUE		0x11223344
+
+#define SNVS_HPVIDR1			0xBF8
+	#define IP_ID_MASK		0xFFFF0000
+	#define IP_ID_OFFSET		16
+	#define MAJOR_REV_MASK		0x0000FF00
+	#define MAJOR_REV_OFFSET	8
+	#define MINOR_REV_MASK		0x000000FF
+	#define MINOR_REV_OFFSET	0
+
+#define SNVS_HPVIDR2			0xBFC
+
+struct snvs_reg_field {
+	const char *name;
+	uint32_t mask;
+	unsigned int shift;
+};
+
+struct snvs_reg {
+	const char *name;
+	unsigned int offset;
+	unsigned int count;
+	uint32_t reset;
+	const struct snvs_reg_field *fields;
+	unsigned int nfields;
+};
+
+/* Snapshot of every register, in address order */
+struct snvs_regs {
+	uint32_t hplr;
+	uint32_t hpcomr;
+	uint32_t hpcr;
+	uint32_t hpsvcr;
+	uint32_t hpsr;
+	uint32_t hpsvsr;
+	uint32_t lplr;
+	uint32_t lpcr;
+	uint32_t lpmkcr;
+	uint32_t lpsvcr;
+	uint32_t lptdcr;
+	uint32_t lpsr;
+	uint32_t lpsrtcmr;
+	uint32_t lpsrtclr;
+	uint32_t lpsmcmr;
+	uint32_t lpsmclr;
+	uint32_t lppgdr;
+	uint32_t lpgpr;
+	uint32_t lpzmkr[8];
+	uint32_t hpvidr1;
+	uint32_t hpvidr2;
+};
+
+/* Registers captured together by snvs_snapshot() (snapshot: yes in snvs_regs.yaml) */
+struct snvs_snapshot {
+	uint32_t hplr;
+	uint32_t hpcomr;
+	uint32_t hpsr;
+	uint32_t lplr;
+	uint32_t lpcr;
+	uint32_t lpmkcr;
+	uint32_t lpsr;
+	uint32_t lpgpr;
+	uint32_t hpvidr1;
+	uint32_t hpvidr2;
+};
+
+struct snvs;
+
+extern const struct snvs_reg snvs_regs_table[];
+extern const unsigned int snvs_regs_count;
+
+const struct snvs_reg *snvs_reg_lookup(unsigned int offset);
+void snvs_regs_read(const struct snvs *snvs, struct snvs_regs *regs);
+void snvs_regs_snapshot(const struct snvs *snvs, struct snvs_snapshot *snap);
+void snvs_regs_reset(volatile void *mem);
+uint32_t snvs_regs_sim_update(const volatile void *mem, unsigned int offset, uint32_t old, uint32_t value);
+size_t snvs_regs_decode(unsigned int offset, uint32_t value, char *buf, size_t len);
+
+#endif /* SNVS_REGS_H */
@@ -0,0 +1,250 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "snvs.h"
+#include "snvs_script.h"
+
+#define SCRIPT_LINE_MAX			256
+
+static const char * const op_names[] = {
+	[SNVS_OP_READ] = "read",
+	[SNVS_OP_SET] = "set",
+	[SNVS_OP_POLL] = "poll",
+	[SNVS_OP_EXPECT] = "expect",
+};
+
+const char *snvs_op_name(enum snvs_op_code code)
+{
+	return op_names[code];
+}
+
+/* Resolve REG, REG[n], REG.FIELD or a unique FIELD into offset, mask and shift */
+int snvs_script_resolve(const char *name, struct snvs_op *op)
+{
+	char reg_name[SNVS_SCRIPT_NAME_MAX];
+	const char *field = strchr(name, '.');
+	unsigned int i, j, index = 0, matches = 0;
+
+	if (!field) {
+		//A field name on its own must be unique across all registers
+		for (i = 0; i < snvs_regs_count; i++) {
+			for (j = 0; j < snvs_regs_table[i].nfields; j++) {
+				if (!strcmp(name, snvs_regs_table[i].fields[j].name)) {
+					op->offset = snvs_regs_table[i].offset;
+					op->mask = snvs_regs_table[i].fields[j].mask;
+					op->shift = snvs_regs_table[i].fields[j].shift;
+					matches++;
+				}
+			}
+		}
+		if (matches == 1)
+			return 0;
+		if (matches > 1)
+			return -1;
+	}
+
+	size_t len = field ? (size_t)(field - name) : strlen(name);
+	if (len >= sizeof(reg_name))
+		return -1;
+	memcpy(reg_name, name, len);
+	reg_name[len] = '\0';
+
+	char *bracket = strchr(reg_name, '[');
+	if (bracket) {
+		char *end;
+		index = strtoul(bracket + 1, &end, 0);
+		if (*end != ']' || end[1])
+			return -1;
+		*bracket = '\0';
+	}
+
+	for (i = 0; i < snvs_regs_count; i++) {
+		const struct snvs_reg *reg = &snvs_regs_table[i];
+		if (strcmp(reg_name, reg->name) || index >= reg->count)
+			continue;
+
+		op->offset = reg->offset + 4 * index;
+		if (!field) {
+			op->mask = 0xFFFFFFFF;
+			op->shift = 0;
+			return 0;
+		}
+		for (j = 0; j < reg->nfields; j++) {
+			if (!strcmp(field + 1, reg->fields[j].name)) {
+				op->mask = reg->fields[j].mask;
+				op->shift = reg->fields[j].shift;
+				return 0;
+			}
+		}
+	}
+
+	return -1;
+}
+
+static int parse_number(const char *text, unsigned long *value)
+{
+	char *end;
+
+	if (!text)
+		return -1;
+	*value = strtoul(text, &end, 0);
+	return *end ? -1 : 0;
+}
+
+int snvs_script_parse(FILE *f, const char *path, struct snvs_script *script)
+{
+	char line[SCRIPT_LINE_MAX];
+	unsigned int number = 0, capacity = 0;
+	int errors = 0;
+
+	script->ops = NULL;
+	script->count = 0;
+
+	while (fgets(line, sizeof(line), f)) {
+		char *argv[5], *save, *comment = strchr(line, '#');
+		unsigned long value = 0, timeout = 0;
+		unsigned int argc = 0, i;
+		struct snvs_op op;
+
+		number++;
+		if (comment)
+			*comment = '\0';
+		for (argv[argc] = strtok_r(line, " \t\r\n", &save); argv[argc] && argc < 4; )
+			argv[++argc] = strtok_r(NULL, " \t\r\n", &save);
+		if (!argc)
+			continue;
+		if (argc == 4 && argv[4])
+			argc++;
+
+		memset(&op, 0, sizeof(op));
+		op.line = number;
+		op.code = sizeof(op_names) / sizeof(op_names[0]);
+		for (i = 0; i < sizeof(op_names) / sizeof(op_names[0]); i++)
+			if (!strcmp(argv[0], op_names[i]))
+				op.code = i;
+
+		if (op.code == sizeof(op_names) / sizeof(op_names[0]) || argc < 2) {
+			fprintf(stderr, "%s:%u: expected read, set, poll or expect and a register\n", path, number);
+			errors++;
+			continue;
+		}
+		if (strlen(argv[1]) >= sizeof(op.name) || snvs_script_resolve(argv[1], &op)) {
+			fprintf(stderr, "%s:%u: unknown or ambiguous register/field '%s'\n", path, number, argv[1]);
+			errors++;
+			continue;
+		}
+		strcpy(op.name, argv[1]);
+
+		unsigned int want = op.code == SNVS_OP_READ ? 2 : op.code == SNVS_OP_POLL ? 4 : 3;
+		if (argc != want || (want > 2 && parse_number(argv[2], &value)) ||
+		    (want > 3 && parse_number(argv[3], &timeout))) {
+			fprintf(stderr, "%s:%u: %s takes %u argument(s)\n", path, number, argv[0], want - 1);
+			errors++;
+			continue;
+		}
+		if (value > (op.mask >> op.shift)) {
+			fprintf(stderr, "%s:%u: 0x%lx does not fit in %s\n", path, number, value, op.name);
+			errors++;
+			continue;
+		}
+		op.value = value;
+		op.timeout_us = timeout;
+
+		if (script->count == capacity) {
+			capacity = capacity ? 2 * capacity : 64;
+			struct snvs_op *ops = realloc(script->ops, capacity * sizeof(*ops));
+			if (!ops) {
+				snvs_script_free(script);
+				return -1;
+			}
+			script->ops = ops;
+		}
+		script->ops[script->count++] = op;
+	}
+
+	if (errors)
+		snvs_script_free(script);
+	return errors ? -1 : 0;
+}
+
+void snvs_script_free(struct snvs_script *script)
+{
+	free(script->ops);
+	script->ops = NULL;
+	script->count = 0;
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+unsigned int snvs_script_run(snvs_t *snvs, const struct snvs_script *script, struct snvs_op_result *results)
+{
+	unsigned int i, failed = 0;
+
+	for (i = 0; i < script->count; i++) {
+		const struct snvs_op *op = &script->ops[i];
+		struct snvs_op_result *r = &results[i];
+		uint32_t field = op->value << op->shift, value;
+		double t0 = now_ns();
+
+		r->failed = 0;
+		switch (op->code) {
+		case SNVS_OP_SET:
+			r->failed = snvs_modify(snvs, op->offset, op->mask, field);
+			break;
+		case SNVS_OP_POLL:
+			r->failed = snvs_poll(snvs, op->offset, op->mask, field, op->timeout_us);
+			break;
+		default:
+			break;
+		}
+		value = snvs_read(snvs, op->offset);
+		if (op->code == SNVS_OP_EXPECT)
+			r->failed = (value & op->mask) != field;
+		r->value = (value & op->mask) >> op->shift;
+		r->ns = now_ns() - t0;
+		failed += !!r->failed;
+	}
+
+	return failed;
+}
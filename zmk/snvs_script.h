@@ -0,0 +1,103 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	Register scripts
+
+	A script is a text file of field-aware register operations, one per line:
+
+		read   REG[.FIELD]
+		set    REG[.FIELD] VALUE			read-modify-write of the field
+		poll   REG[.FIELD] VALUE TIMEOUT_US		wait until the field reads VALUE
+		expect REG[.FIELD] VALUE			fail the line unless the field reads VALUE
+
+	REG is a register name from snvs_regs.yaml (SNVS_LPZMKRn[3] for array members), FIELD one of
+	its fields; a field name alone is accepted when it is unique. '#' starts a comment.
+
+	snvs_script_parse() resolves every name once into a list of operations (offset, mask, shift,
+	value), so snvs_script_run() executes them against one SNVS mapping without any lookup and
+	times each operation.
+*/
+
+#ifndef SNVS_SCRIPT_H
+#define SNVS_SCRIPT_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "libsnvs.h"
+
+#define SNVS_SCRIPT_NAME_MAX		48
+
+enum snvs_op_code {
+	SNVS_OP_READ,
+	SNVS_OP_SET,
+	SNVS_OP_POLL,
+	SNVS_OP_EXPECT,
+};
+
+struct snvs_op {
+	enum snvs_op_code code;
+	unsigned int line;
+	unsigned int offset;
+	uint32_t mask;
+	unsigned int shift;
+	uint32_t value;				/* field value, not shifted */
+	unsigned int timeout_us;
+	char name[SNVS_SCRIPT_NAME_MAX];
+};
+
+struct snvs_script {
+	struct snvs_op *ops;
+	unsigned int count;
+};
+
+struct snvs_op_result {
+	uint32_t value;				/* field value read (read, poll, expect) or written (set) */
+	int failed;
+	double ns;
+};
+
+const char *snvs_op_name(enum snvs_op_code code);
+
+/* Resolve REG, REG[n], REG.FIELD or a unique FIELD into op->offset, op->mask and op->shift */
+int snvs_script_resolve(const char *name, struct snvs_op *op);
+
+/* Parse a script; errors are reported on stderr with the line number. Returns 0 on success. */
+int snvs_script_parse(FILE *f, const char *path, struct snvs_script *script);
+void snvs_script_free(struct snvs_script *script);
+
+/* Run every operation in order; returns the number of failed operations */
+unsigned int snvs_script_run(snvs_t *snvs, const struct snvs_script *script, struct snvs_op_result *results);
+
+#endif /* SNVS_SCRIPT_H */
@@ -0,0 +1,520 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "snvs.h"
+#include "snvs_sim.h"
+#include "snvs_tamper.h"
+#include "snvs_mkey.h"
+#include "ocotp.h"
+#include "snvs_timing.h"
+#include "snvs_trace.h"
+#include "snvs_backend.h"
+#include "snvs_fault.h"
+
+int snvs_sim;
+unsigned int snvs_sim_mc_latency_us;
+int snvs_atomic;
+const struct snvs_backend *snvs_backend;
+
+#define SIM_UID				0x1a2b3c4d5e6f7081ULL
+#define SIM_TRACKED_REGS		64	//registers below 0x100 are watched for lost updates
+
+//Fuse value the simulator uses as OTPMK
+static const uint8_t sim_otpmk[MASTER_KEY_BYTES] = {
+	0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff,
+	0x0f, 0x1e, 0x2d, 0x3c, 0x4b, 0x5a, 0x69, 0x78, 0x87, 0x96, 0xa5, 0xb4, 0xc3, 0xd2, 0xe1, 0xf0,
+};
+
+/* Simulator state kept next to the register page, invisible to the tool */
+struct snvs_sim_state {
+	pthread_mutex_t lock;
+	uint32_t zmk[SNVS_LPZMKR_COUNT];
+	uint64_t clock_ns;		/* predicted time spent in register accesses (timing model) */
+	uint64_t zeroize_at;		/* clock_ns at which a pending ZMK zeroization completes */
+	int zeroize_pending;
+	pthread_mutex_t update_lock;	/* atomic read-modify-writes (snvs_atomic) */
+	uint32_t generation[SIM_TRACKED_REGS];	/* writes per register */
+	struct snvs_sim_rmw_stats rmw;
+};
+
+/* What this thread read last from each watched register */
+static __thread uint32_t read_generation[SIM_TRACKED_REGS];
+static __thread uint32_t read_value[SIM_TRACKED_REGS];
+static __thread uint64_t read_valid;
+
+/* Timing model, loaded from ZMK_SIM_TIMING; NULL runs the simulator untimed */
+static struct snvs_timing *sim_timing;
+
+static struct snvs_sim_state *sim_state(void *virt_addr)
+{
+	return (struct snvs_sim_state *)((char *)virt_addr + SNVS_PAGE_SIZE);
+}
+
+#define sim_reg(virt_addr, add_offset)	(*(volatile uint32_t *)((char *)(virt_addr) + (add_offset)))
+
+static void sim_zeroize_zmk_view(void *virt_addr)
+{
+	int i;
+
+	for (i = 0; i < SNVS_LPZMKR_COUNT; i++)
+		sim_reg(virt_addr, SNVS_LPZMKRn + 4 * i) = 0;
+}
+
+static void sim_reset(unsigned int *mem)
+{
+	pthread_mutexattr_t attr;
+	struct timespec now;
+
+	snvs_regs_reset(mem);
+
+	/* The SRTC does not advance in the simulator, start it at the wall clock time */
+	clock_gettime(CLOCK_REALTIME, &now);
+	uint64_t ticks = (uint64_t)now.tv_sec * SRTC_HZ + (uint64_t)now.tv_nsec * SRTC_HZ / 1000000000;
+	sim_reg(mem, SNVS_LPSRTCMR) = (ticks >> 32) & SRTC_MSB_MASK;
+	sim_reg(mem, SNVS_LPSRTCLR) = (uint32_t)ticks;
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+	pthread_mutex_init(&sim_state(mem)->lock, &attr);
+	pthread_mutex_init(&sim_state(mem)->update_lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+}
+
+/*
+ * Maps the simulated SNVS page. When ZMK_SIM_STATE names a file the state is kept there, so
+ * several invocations (or processes) share one simulated SNVS; otherwise it lives in anonymous
+ * memory for the life of the process.
+ */
+unsigned int *snvs_sim_map(void)
+{
+	const char *path = getenv("ZMK_SIM_STATE");
+	const char *timing = getenv("ZMK_SIM_TIMING");
+	unsigned int *mem;
+	int fresh = 1;
+
+	if (timing && !sim_timing) {
+		sim_timing = malloc(sizeof(*sim_timing));
+		if (!sim_timing || snvs_timing_load(timing, sim_timing)) {
+			free(sim_timing);
+			sim_timing = NULL;
+			errno = EINVAL;
+			return NULL;
+		}
+	}
+
+	if (path) {
+		int fd = open(path, O_RDWR | O_CREAT, 0600);
+		if (fd < 0)
+			return NULL;
+		fresh = lseek(fd, 0, SEEK_END) == 0;
+		if (fresh && ftruncate(fd, 2 * SNVS_PAGE_SIZE)) {
+			close(fd);
+			return NULL;
+		}
+		mem = mmap(NULL, 2 * SNVS_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+	} else {
+		mem = mmap(NULL, 2 * SNVS_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	}
+	if (mem == MAP_FAILED)
+		return NULL;
+
+	if (fresh)
+		sim_reset(mem);
+
+	return mem;
+}
+
+/*
+ * System reset: the SNVS_HP registers (soft locks, SNVS_HPCOMR[MKS_EN]) return to their reset
+ * values, the SNVS_LP domain keeps its state. The ZMK reads back again once no read lock is left.
+ */
+void snvs_sim_system_reset(void *virt_addr)
+{
+	struct snvs_sim_state *state = sim_state(virt_addr);
+	unsigned int r, i;
+
+	pthread_mutex_lock(&state->lock);
+	for (r = 0; r < snvs_regs_count; r++) {
+		const struct snvs_reg *reg = &snvs_regs_table[r];
+
+		if (snvs_lp_register(reg->offset))
+			continue;
+		for (i = 0; i < reg->count; i++)
+			sim_reg(virt_addr, reg->offset + 4 * i) = reg->reset;
+	}
+	state->zeroize_pending = 0;
+	if (!(sim_reg(virt_addr, SNVS_LPLR) & ZMK_RHL_MASK))
+		for (i = 0; i < SNVS_LPZMKR_COUNT; i++)
+			sim_reg(virt_addr, SNVS_LPZMKRn + 4 * i) = state->zmk[i];
+	else
+		//The reset completes a zeroization still pending behind the hard lock
+		sim_zeroize_zmk_view(virt_addr);
+	pthread_mutex_unlock(&state->lock);
+}
+
+/* Power-on reset: both domains back to their reset values, the ZMK cleared */
+void snvs_sim_power_on_reset(void *virt_addr)
+{
+	struct snvs_sim_state *state = sim_state(virt_addr);
+
+	pthread_mutex_lock(&state->lock);
+	memset(virt_addr, 0, SNVS_PAGE_SIZE);
+	snvs_regs_reset(virt_addr);
+	memset(state->zmk, 0, sizeof(state->zmk));
+	state->zeroize_pending = 0;
+	pthread_mutex_unlock(&state->lock);
+}
+
+/* Fuse shadow page of the simulated SoC; fuses never change, so every caller shares it */
+const volatile uint32_t *snvs_sim_ocotp(void)
+{
+	static uint32_t ocotp[OCOTP_PAGE_SIZE / sizeof(uint32_t)];
+
+	ocotp[OCOTP_CFG0 / sizeof(uint32_t)] = (uint32_t)SIM_UID;
+	ocotp[OCOTP_CFG1 / sizeof(uint32_t)] = (uint32_t)(SIM_UID >> 32);
+	return ocotp;
+}
+
+/* Key inputs of the simulated master key selection: the fuse OTPMK and the ZMK even when read locked */
+void snvs_sim_keys(void *virt_addr, uint8_t *otpmk, uint8_t *zmk)
+{
+	struct snvs_sim_state *state = sim_state(virt_addr);
+
+	memcpy(otpmk, sim_otpmk, MASTER_KEY_BYTES);
+	pthread_mutex_lock(&state->lock);
+	memcpy(zmk, state->zmk, MASTER_KEY_BYTES);
+	pthread_mutex_unlock(&state->lock);
+}
+
+/* Security violation: the ZMK itself is zeroized, not only its view */
+void snvs_sim_violation(void *virt_addr)
+{
+	struct snvs_sim_state *state = sim_state(virt_addr);
+
+	pthread_mutex_lock(&state->lock);
+	memset(state->zmk, 0, sizeof(state->zmk));
+	sim_zeroize_zmk_view(virt_addr);
+	state->zeroize_pending = 0;
+	sim_reg(virt_addr, SNVS_HPSVSR) |= LP_SEC_VIO_MASK;
+	sim_reg(virt_addr, SNVS_LPSR) |= ESVD_MASK;
+	pthread_mutex_unlock(&state->lock);
+}
+
+/* Change register bits the way the hardware does on its own, past the access rules */
+void snvs_sim_poke(void *virt_addr, unsigned int add_offset, uint32_t mask, uint32_t value)
+{
+	struct snvs_sim_state *state = sim_state(virt_addr);
+
+	pthread_mutex_lock(&state->lock);
+	sim_reg(virt_addr, add_offset) = (sim_reg(virt_addr, add_offset) & ~mask) | (value & mask);
+	pthread_mutex_unlock(&state->lock);
+}
+
+void snvs_sim_set_timing(struct snvs_timing *timing)
+{
+	sim_timing = timing;
+}
+
+/* Advance the simulated clock by one access and complete a pending zeroization that is due */
+static void sim_advance(const void *virt_addr, uint64_t ns)
+{
+	struct snvs_sim_state *state = sim_state((void *)virt_addr);
+	uint64_t now = __atomic_add_fetch(&state->clock_ns, ns, __ATOMIC_RELAXED);
+
+	if (!__atomic_load_n(&state->zeroize_pending, __ATOMIC_ACQUIRE) || now < state->zeroize_at)
+		return;
+
+	pthread_mutex_lock(&state->lock);
+	if (state->zeroize_pending) {
+		sim_zeroize_zmk_view((void *)virt_addr);
+		__atomic_store_n(&state->zeroize_pending, 0, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&state->lock);
+}
+
+static void sim_increment_mc(void *virt_addr)
+{
+	uint32_t msb = sim_reg(virt_addr, SNVS_LPSMCMR);
+	uint32_t lsb = sim_reg(virt_addr, SNVS_LPSMCLR);
+
+	if (!(sim_reg(virt_addr, SNVS_LPCR) & MC_ENV_MASK))
+		return;
+	if ((sim_reg(virt_addr, SNVS_LPLR) & MC_HL_MASK) || (sim_reg(virt_addr, SNVS_HPLR) & MC_SL_MASK))
+		return;
+
+	if (++lsb == 0) {
+		if ((msb & MC_MSB_MASK) == MC_MSB_MASK) {
+			/* Rollover: the counter stops and MCR is flagged */
+			sim_reg(virt_addr, SNVS_LPSR) |= MCR_MASK;
+			sim_reg(virt_addr, SNVS_LPCR) &= ~MC_ENV_MASK;
+			return;
+		}
+		msb++;
+	}
+	sim_reg(virt_addr, SNVS_LPSMCMR) = msb;
+	sim_reg(virt_addr, SNVS_LPSMCLR) = lsb;
+}
+
+/* Called with the state locked, before the write lands */
+static void sim_check_rmw(struct snvs_sim_state *state, unsigned int add_offset, uint32_t cur, uint32_t new)
+{
+	unsigned int i = add_offset / 4;
+
+	if (i >= SIM_TRACKED_REGS)
+		return;
+	if (read_valid & (1ULL << i)) {
+		read_valid &= ~(1ULL << i);
+		state->rmw.rmw++;
+
+		//Bits that appeared after this thread's read and that the write takes away again
+		uint32_t lost = cur & ~read_value[i] & ~new;
+
+		if (state->generation[i] != read_generation[i] && lost) {
+			state->rmw.lost++;
+			state->rmw.last_offset = add_offset;
+			state->rmw.last_bits = lost;
+		}
+	}
+	__atomic_store_n(&state->generation[i], state->generation[i] + 1, __ATOMIC_RELEASE);
+}
+
+void snvs_sim_rmw_stats(const void *virt_addr, struct snvs_sim_rmw_stats *stats, int clear)
+{
+	struct snvs_sim_state *state = sim_state((void *)virt_addr);
+
+	pthread_mutex_lock(&state->lock);
+	*stats = state->rmw;
+	if (clear)
+		memset(&state->rmw, 0, sizeof(state->rmw));
+	pthread_mutex_unlock(&state->lock);
+}
+
+void snvs_sim_update_lock(void *virt_addr)
+{
+	pthread_mutex_lock(&sim_state(virt_addr)->update_lock);
+}
+
+void snvs_sim_update_unlock(void *virt_addr)
+{
+	pthread_mutex_unlock(&sim_state(virt_addr)->update_lock);
+}
+
+void snvs_sim_write(void *virt_addr, unsigned int add_offset, unsigned int value)
+{
+	struct snvs_sim_state *state = sim_state(virt_addr);
+	uint32_t old, new;
+	int read_locked;
+
+	if (sim_timing)
+		sim_advance(virt_addr, sim_timing->write_ns[add_offset / 4]);
+	if (snvs_faults && snvs_fault_access(virt_addr, add_offset, 1))
+		return;
+	//A counter increment is a slow LP domain write, the writer waits for it as on the board
+	if ((add_offset == SNVS_LPSMCMR || add_offset == SNVS_LPSMCLR) && snvs_sim_mc_latency_us)
+		usleep(snvs_sim_mc_latency_us);
+
+	pthread_mutex_lock(&state->lock);
+
+	old = sim_reg(virt_addr, add_offset);
+	read_locked = (sim_reg(virt_addr, SNVS_HPLR) & ZMK_RSL_MASK) || (sim_reg(virt_addr, SNVS_LPLR) & ZMK_RHL_MASK);
+
+	/* Access rights, sticky and write-1-to-clear bits and lock bits come from the register map */
+	if (add_offset >= SNVS_LPZMKRn && add_offset < SNVS_LPZMKRn + 4 * SNVS_LPZMKR_COUNT) {
+		uint32_t *zmk = &state->zmk[(add_offset - SNVS_LPZMKRn) / 4];
+
+		new = snvs_regs_sim_update(virt_addr, add_offset, *zmk, value);
+		sim_check_rmw(state, add_offset, old, read_locked ? 0 : new);
+		*zmk = new;
+		sim_reg(virt_addr, add_offset) = read_locked ? 0 : new;
+	} else {
+		new = snvs_regs_sim_update(virt_addr, add_offset, old, value);
+		if (snvs_faults)
+			new = snvs_fault_stuck(add_offset, new);
+		sim_check_rmw(state, add_offset, old, new);
+		sim_reg(virt_addr, add_offset) = new;
+	}
+
+	switch (add_offset) {
+	case SNVS_HPLR:
+	case SNVS_LPLR:
+		if ((new & (add_offset == SNVS_HPLR ? ZMK_RSL_MASK : ZMK_RHL_MASK)) && !read_locked) {
+			uint32_t delay = sim_timing ? sim_timing->zeroize_ns : 0;
+
+			if (snvs_faults)
+				delay = snvs_fault_zeroize_delay(delay);
+			if (sim_timing && delay == SNVS_FAULT_NEVER) {
+				//A failed zeroization leaves the ZMK readable
+			} else if (sim_timing && delay) {
+				//The ZMK stays readable until the zeroization delay has passed
+				state->zeroize_at = state->clock_ns + delay;
+				__atomic_store_n(&state->zeroize_pending, 1, __ATOMIC_RELEASE);
+			} else {
+				sim_zeroize_zmk_view(virt_addr);
+			}
+		}
+		break;
+	case SNVS_LPSMCMR:
+	case SNVS_LPSMCLR:
+		sim_increment_mc(virt_addr);
+		break;
+	}
+
+	pthread_mutex_unlock(&state->lock);
+}
+
+unsigned int snvs_sim_read(const void *virt_addr, unsigned int add_offset)
+{
+	unsigned int i = add_offset / 4;
+
+	if (sim_timing)
+		sim_advance(virt_addr, sim_timing->read_ns[i]);
+	if (snvs_faults)
+		snvs_fault_access((void *)virt_addr, add_offset, 0);
+	if (i >= SIM_TRACKED_REGS)
+		return sim_reg(virt_addr, add_offset);
+
+	//Write count first: a write landing in between shows up as a conflict, never as a missed one
+	read_generation[i] = __atomic_load_n(&sim_state((void *)virt_addr)->generation[i], __ATOMIC_ACQUIRE);
+	read_value[i] = sim_reg(virt_addr, add_offset);
+	read_valid |= 1ULL << i;
+	return read_value[i];
+}
+
+int snvs_sim_timed(void)
+{
+	return sim_timing != NULL;
+}
+
+uint64_t snvs_sim_clock(const void *virt_addr)
+{
+	return __atomic_load_n(&sim_state((void *)virt_addr)->clock_ns, __ATOMIC_RELAXED);
+}
+
+void snvs_sim_wait(const void *virt_addr, uint64_t ns)
+{
+	if (sim_timing)
+		sim_advance(virt_addr, ns);
+}
+
+unsigned int read_SNVS_reg(const void *virt_addr, unsigned int add_offset)
+{
+	uint64_t start = snvs_trace_on ? snvs_trace_now() : 0;
+	unsigned int value;
+
+	if (snvs_backend)
+		value = snvs_backend->read(add_offset);
+	else if (snvs_sim)
+		value = snvs_sim_read(virt_addr, add_offset);
+	else
+		value = *(const volatile uint32_t *)((const char *)virt_addr + add_offset);
+
+	if (start)
+		snvs_trace_span(TRACE_READ, NULL, add_offset, value, start);
+	return value;
+}
+
+/* Atomic-update lock: in the simulator state when it is local, else a lock file plus a process mutex */
+static pthread_mutex_t update_process_lock = PTHREAD_MUTEX_INITIALIZER;
+static int update_fd = -2;
+
+static void update_lock(void *virt_addr)
+{
+	struct flock fl = { .l_type = F_WRLCK, .l_whence = SEEK_SET };
+
+	if (snvs_sim && !snvs_backend) {
+		snvs_sim_update_lock(virt_addr);
+		return;
+	}
+
+	//Open file description locks do not tell threads apart, so threads queue on the mutex first
+	pthread_mutex_lock(&update_process_lock);
+	if (update_fd == -2)
+		update_fd = open(SNVS_UPDATE_LOCK, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+	if (update_fd >= 0)
+		while (fcntl(update_fd, F_OFD_SETLKW, &fl) && errno == EINTR)
+			;
+}
+
+static void update_unlock(void *virt_addr)
+{
+	struct flock fl = { .l_type = F_UNLCK, .l_whence = SEEK_SET };
+
+	if (snvs_sim && !snvs_backend) {
+		snvs_sim_update_unlock(virt_addr);
+		return;
+	}
+	if (update_fd >= 0)
+		fcntl(update_fd, F_OFD_SETLK, &fl);
+	pthread_mutex_unlock(&update_process_lock);
+}
+
+void write_SNVS_reg(void *virt_addr, unsigned int add_offset, unsigned int value)
+{
+	uint64_t start = snvs_trace_on ? snvs_trace_now() : 0;
+
+	if (snvs_backend)
+		snvs_backend->write(add_offset, value);
+	else if (snvs_sim)
+		snvs_sim_write(virt_addr, add_offset, value);
+	else
+		*get_SNVS_reg(virt_addr, add_offset) = value;
+
+	if (start)
+		snvs_trace_span(TRACE_WRITE, NULL, add_offset, value, start);
+}
+
+void modify_SNVS_reg(void *virt_addr, unsigned int add_offset, unsigned int clear, unsigned int set)
+{
+	if (!snvs_atomic) {
+		write_SNVS_reg(virt_addr, add_offset, (read_SNVS_reg(virt_addr, add_offset) & ~clear) | set);
+		return;
+	}
+
+	update_lock(virt_addr);
+	write_SNVS_reg(virt_addr, add_offset, (read_SNVS_reg(virt_addr, add_offset) & ~clear) | set);
+	//A backend may still hold the write; it has to land before the next updater reads
+	if (snvs_backend && snvs_backend->flush)
+		snvs_backend->flush();
+	update_unlock(virt_addr);
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	SNVS simulator
+
+	Backs the SNVS page with anonymous shared memory holding the reset values of an i.MX6 SNVS,
+	so the provisioning sequence and the SNVS services can be exercised on a host. Every write
+	done through write_SNVS_reg() is passed to snvs_sim_write(), which applies the hardware side
+	effects the tool relies on: sticky lock bits, ZMK write/read locks (a read-locked ZMK reads
+	as zero), write-1-to-clear status bits in SNVS_LPSR and monotonic counter increments.
+	Reset values and per-bit access rules are generated from snvs_regs.yaml (snvs_regs.c);
+	the cross-register side effects are modelled here.
+	The OCOTP fuse shadows are simulated as a read-only page holding a fixed unique ID.
+	Set ZMK_SIM_STATE to a file name to keep the simulated SNVS across invocations;
+	snvs_sim_system_reset() then models a system reset between them (SNVS_HP reset, SNVS_LP kept).
+
+	Set ZMK_SIM_TIMING to a calibration file (snvs_timing.h) to turn on the timing model: every
+	access advances a simulated clock by the calibrated latency of its register, and a ZMK read
+	lock zeroizes the ZMK only once the calibrated delay has passed on that clock. The clock
+	(snvs_sim_clock) then predicts the time the same accesses take on the board. A caller that
+	sleeps between accesses instead of spinning adds the time slept with snvs_sim_wait().
+
+	The simulator also watches read-modify-writes for lost updates. Each thread remembers the
+	write count of a register when it reads it; when it writes the register back and another
+	thread or process wrote it in between, the bits that writer set and this write clears are
+	a lost update. snvs_sim_rmw_stats() returns the counts, across every process sharing the
+	state.
+
+	Faults can be injected into the simulated SNVS (snvs_fault.h): snvs_sim_violation() zeroizes
+	the ZMK as a security violation does, snvs_sim_poke() changes bits past the access rules.
+	snvs_sim_set_timing() turns the timing model on without a calibration file.
+
+	A monotonic counter increment is instantaneous unless snvs_sim_mc_latency_us is set; the
+	writing thread then sleeps that long (real time) before the counter advances, so concurrent
+	increment requests overlap as they do on the board.
+*/
+
+#ifndef SNVS_SIM_H
+#define SNVS_SIM_H
+
+#include <stdint.h>
+
+extern int snvs_sim;
+extern unsigned int snvs_sim_mc_latency_us;
+
+unsigned int *snvs_sim_map(void);
+unsigned int snvs_sim_read(const void *virt_addr, unsigned int add_offset);
+void snvs_sim_write(void *virt_addr, unsigned int add_offset, unsigned int value);
+int snvs_sim_timed(void);
+uint64_t snvs_sim_clock(const void *virt_addr);
+/* Let ns pass on the clock of a board that waits without accessing it (timing model only) */
+void snvs_sim_wait(const void *virt_addr, uint64_t ns);
+const volatile uint32_t *snvs_sim_ocotp(void);
+void snvs_sim_keys(void *virt_addr, uint8_t *otpmk, uint8_t *zmk);
+void snvs_sim_system_reset(void *virt_addr);
+void snvs_sim_power_on_reset(void *virt_addr);
+void snvs_sim_violation(void *virt_addr);
+void snvs_sim_poke(void *virt_addr, unsigned int add_offset, uint32_t mask, uint32_t value);
+
+struct snvs_timing;
+/* Use timing (kept by the caller) as the timing model, NULL turns it off */
+void snvs_sim_set_timing(struct snvs_timing *timing);
+
+struct snvs_sim_rmw_stats {
+	uint64_t rmw;			/* writes of a register the writer had read */
+	uint64_t lost;			/* of those, writes that cleared bits set by someone else meanwhile */
+	unsigned int last_offset;	/* register and bits of the last lost update */
+	uint32_t last_bits;
+};
+
+void snvs_sim_rmw_stats(const void *virt_addr, struct snvs_sim_rmw_stats *stats, int clear);
+void snvs_sim_update_lock(void *virt_addr);
+void snvs_sim_update_unlock(void *virt_addr);
+
+#endif /* SNVS_SIM_H */
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	SNVS_LP Secure Real Time Counter (SRTC) reader
+
+	The SRTC is a 47-bit counter clocked by the 32.768 kHz LP domain clock. It is split in
+	SNVS_LPSRTCMR (bits 46..32) and SNVS_LPSRTCLR (bits 31..0). The counter runs asynchronously
+	to the bus, so a single read of the two halves can tear. The counter is read twice and the
+	value is accepted only when two consecutive reads of both halves agree.
+
+	Everything here is static inline so that any process can map the SNVS page read-only once
+	(map_SNVS_ro) and then take a timestamp with a handful of loads and no system call.
+*/
+
+#ifndef SNVS_SRTC_H
+#define SNVS_SRTC_H
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifndef SNVS_BASE_REG
+#define SNVS_BASE_REG			0x020cc000
+#endif
+
+#define SNVS_PAGE_SIZE			0x1000
+
+#ifndef SNVS_LPCR
+#define SNVS_LPCR			0x38		//SNVS_LP Control Register
+	#define SRTC_ENV_MASK		0x1
+	#define SRTC_ENV_OFFSET		0
+#endif
+
+#ifndef SNVS_LPSRTCMR
+#define SNVS_LPSRTCMR			0x50		//SNVS_LP Secure Real Time Counter MSB Register (bits 14..0 are SRTC[46:32])
+	#define SRTC_MSB_MASK		0x7FFF
+#define SNVS_LPSRTCLR			0x54		//SNVS_LP Secure Real Time Counter LSB Register (SRTC[31:0])
+#endif
+
+#define SRTC_HZ				32768
+#define SRTC_READ_RETRIES		16
+
+/* Map the SNVS page read-only; returns MAP_FAILED on error */
+static inline const volatile uint32_t *map_SNVS_ro(void)
+{
+	int fd = open("/dev/mem", O_SYNC | O_RDONLY);
+	if (fd < 0)
+		return (const volatile uint32_t *)MAP_FAILED;
+
+	void *mem = mmap(NULL, SNVS_PAGE_SIZE, PROT_READ, MAP_SHARED, fd, SNVS_BASE_REG);
+	close(fd);
+	return (const volatile uint32_t *)mem;
+}
+
+static inline uint32_t read_SNVS_reg32(const volatile void *base, unsigned int offset)
+{
+	return *(const volatile uint32_t *)((const volatile char *)base + offset);
+}
+
+/* Consistent read of the 47-bit SRTC; returns 0 on success, -1 if the value never settled */
+static inline int read_SNVS_srtc(const volatile void *base, uint64_t *ticks)
+{
+	uint32_t msb, lsb, msb2, lsb2;
+	int retries = SRTC_READ_RETRIES;
+
+	msb = read_SNVS_reg32(base, SNVS_LPSRTCMR) & SRTC_MSB_MASK;
+	lsb = read_SNVS_reg32(base, SNVS_LPSRTCLR);
+	do {
+		msb2 = read_SNVS_reg32(base, SNVS_LPSRTCMR) & SRTC_MSB_MASK;
+		lsb2 = read_SNVS_reg32(base, SNVS_LPSRTCLR);
+		if (msb == msb2 && lsb == lsb2) {
+			*ticks = ((uint64_t)msb << 32) | lsb;
+			return 0;
+		}
+		msb = msb2;
+		lsb = lsb2;
+	} while (--retries);
+
+	return -1;
+}
+
+static inline int SNVS_srtc_enabled(const volatile void *base)
+{
+	return (read_SNVS_reg32(base, SNVS_LPCR) & SRTC_ENV_MASK) >> SRTC_ENV_OFFSET;
+}
+
+static inline void SNVS_srtc_to_timespec(uint64_t ticks, struct timespec *ts)
+{
+	ts->tv_sec = ticks / SRTC_HZ;
+	ts->tv_nsec = (long)(((ticks % SRTC_HZ) * 1000000000ULL) / SRTC_HZ);
+}
+
+#endif /* SNVS_SRTC_H */
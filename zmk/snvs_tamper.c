@@ -0,0 +1,149 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "snvs.h"
+#include "snvs_tamper.h"
+
+/*
+ * User specific: LP security violations are reported as non-fatal, the CAAM security violation
+ * (SV0) is routed to the LP section and SRTC / monotonic counter rollovers are tamper events.
+ * JTAG (SV1) is deliberately not enabled so that debugging a board does not zeroize the ZMK.
+ */
+const struct snvs_tamper_rule snvs_default_tamper_policy[] = {
+	{ SNVS_HPSVCR, LPSV_CFG_MASK, LPSV_CFG_NONFATAL << LPSV_CFG_OFFSET },
+	{ SNVS_LPSVCR, SV_EN_MASK, 0x1 },
+	{ SNVS_LPTDCR, SRTCR_EN_MASK | MCR_EN_MASK, SRTCR_EN_MASK | MCR_EN_MASK },
+};
+const unsigned int snvs_default_tamper_policy_len = sizeof(snvs_default_tamper_policy) / sizeof(snvs_default_tamper_policy[0]);
+
+static const struct snvs_event snvs_events[] = {
+	{ SNVS_HPSVSR, 0x00000001,		"SV0",		"security violation 0 (CAAM)" },
+	{ SNVS_HPSVSR, 0x00000002,		"SV1",		"security violation 1 (JTAG active)" },
+	{ SNVS_HPSVSR, 0x00000004,		"SV2",		"security violation 2 (watchdog 2 reset)" },
+	{ SNVS_HPSVSR, 0x00000008,		"SV3",		"security violation 3" },
+	{ SNVS_HPSVSR, 0x00000010,		"SV4",		"security violation 4" },
+	{ SNVS_HPSVSR, 0x00000020,		"SV5",		"security violation 5" },
+	{ SNVS_HPSVSR, SW_SV_MASK,		"SW_SV",	"software security violation" },
+	{ SNVS_HPSVSR, SW_FSV_MASK,		"SW_FSV",	"software fatal security violation" },
+	{ SNVS_HPSVSR, SW_LPSV_MASK,		"SW_LPSV",	"software LP security violation" },
+	{ SNVS_HPSVSR, ZMK_ECC_FAIL_MASK,	"ZMK_ECC_FAIL",	"ZMK error correction code check failed" },
+	{ SNVS_HPSVSR, LP_SEC_VIO_MASK,		"LP_SEC_VIO",	"LP security violation" },
+	{ SNVS_LPSR, LPTA_MASK,			"LPTA",		"LP time alarm" },
+	{ SNVS_LPSR, SRTCR_MASK,		"SRTCR",	"secure real time counter rollover" },
+	{ SNVS_LPSR, MCR_MASK,			"MCR",		"monotonic counter rollover" },
+	{ SNVS_LPSR, PGD_MASK,			"PGD",		"power supply glitch detected" },
+	{ SNVS_LPSR, ET1D_MASK,			"ET1D",		"external tampering 1 detected" },
+	{ SNVS_LPSR, ESVD_MASK,			"ESVD",		"external security violation detected" },
+	{ SNVS_LPSR, EO_MASK,			"EO",		"monotonic counter era overflow" },
+	{ SNVS_LPSR, SPO_MASK,			"SPO",		"set power off request" },
+};
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+/* Merge the rules per register; returns the number of registers, or -1 if more than SNVS_TAMPER_MAX_REGS */
+int snvs_tamper_merge(const struct snvs_tamper_rule *rules, unsigned int count, unsigned int *reg, unsigned int *mask, unsigned int *value)
+{
+	unsigned int i, j, n = 0;
+
+	for (i = 0; i < count; i++) {
+		for (j = 0; j < n && reg[j] != rules[i].reg; j++)
+			;
+		if (j == n) {
+			if (n == SNVS_TAMPER_MAX_REGS)
+				return -1;
+			reg[n] = rules[i].reg;
+			mask[n] = value[n] = 0;
+			n++;
+		}
+		mask[j] |= rules[i].mask;
+		value[j] = (value[j] & ~rules[i].mask) | (rules[i].value & rules[i].mask);
+	}
+
+	return n;
+}
+
+/*
+ * Applies the rules with one read per register, a modify_SNVS_reg() of the registers that differ
+ * (atomic under snvs_atomic) and a verification read. Returns 0 on success, -1 if a register did
+ * not take the requested value.
+ */
+int snvs_tamper_apply(void *mem, const struct snvs_tamper_rule *rules, unsigned int count, struct snvs_tamper_result *result)
+{
+	unsigned int reg[SNVS_TAMPER_MAX_REGS], mask[SNVS_TAMPER_MAX_REGS], value[SNVS_TAMPER_MAX_REGS];
+	unsigned int j;
+
+	result->reads = result->writes = result->failed_reg = 0;
+
+	int n = snvs_tamper_merge(rules, count, reg, mask, value);
+	if (n < 0)
+		return -1;
+
+	for (j = 0; j < (unsigned int)n; j++) {
+		unsigned int old = read_SNVS_reg(mem, reg[j]);
+		result->reads++;
+		if ((old & mask[j]) == value[j])
+			continue;
+		//Other updaters may change the register meanwhile; the modify merges with its current value
+		modify_SNVS_reg(mem, reg[j], mask[j], value[j]);
+		result->reads++;
+		result->writes++;
+
+		result->reads++;
+		if ((read_SNVS_reg(mem, reg[j]) & mask[j]) != value[j]) {
+			result->failed_reg = reg[j];
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+void snvs_tamper_snapshot(const void *mem, struct snvs_tamper_snapshot *snap)
+{
+	snap->hpsvsr = read_SNVS_reg(mem, SNVS_HPSVSR);
+	snap->lpsr = read_SNVS_reg(mem, SNVS_LPSR);
+}
+
+/* Fills events with the records flagged in the snapshot and returns their number */
+unsigned int snvs_tamper_decode(const struct snvs_tamper_snapshot *snap, const struct snvs_event **events, unsigned int max)
+{
+	unsigned int i, n = 0;
+
+	for (i = 0; i < ARRAY_SIZE(snvs_events) && n < max; i++) {
+		unsigned int value = snvs_events[i].reg == SNVS_HPSVSR ? snap->hpsvsr : snap->lpsr;
+		if (value & snvs_events[i].mask)
+			events[n++] = &snvs_events[i];
+	}
+
+	return n;
+}
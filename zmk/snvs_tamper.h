@@ -0,0 +1,85 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	Security violation and tamper detection policy engine (guideline step A.4)
+
+	A policy is a declarative list of (register, mask, value) rules over SNVS_HPSVCR, SNVS_LPSVCR
+	and SNVS_LPTDCR. snvs_tamper_apply() merges the rules per register, reads every target register
+	once, writes only the registers whose masked bits differ and verifies them with one read back.
+
+	snvs_tamper_snapshot() reads SNVS_HPSVSR and SNVS_LPSR once; snvs_tamper_decode() turns the
+	snapshot into a list of event records without touching the hardware again.
+*/
+
+#ifndef SNVS_TAMPER_H
+#define SNVS_TAMPER_H
+
+#include "snvs.h"
+
+#define SNVS_TAMPER_MAX_REGS		3
+#define SNVS_TAMPER_MAX_EVENTS		32
+
+struct snvs_tamper_rule {
+	unsigned int reg;
+	unsigned int mask;
+	unsigned int value;
+};
+
+struct snvs_tamper_result {
+	unsigned int reads;
+	unsigned int writes;
+	unsigned int failed_reg;	/* first register whose read back did not match, if any */
+};
+
+struct snvs_tamper_snapshot {
+	unsigned int hpsvsr;
+	unsigned int lpsr;
+};
+
+struct snvs_event {
+	unsigned int reg;
+	unsigned int mask;
+	const char *name;
+	const char *description;
+};
+
+extern const struct snvs_tamper_rule snvs_default_tamper_policy[];
+extern const unsigned int snvs_default_tamper_policy_len;
+
+int snvs_tamper_merge(const struct snvs_tamper_rule *rules, unsigned int count, unsigned int *reg, unsigned int *mask, unsigned int *value);
+int snvs_tamper_apply(void *mem, const struct snvs_tamper_rule *rules, unsigned int count, struct snvs_tamper_result *result);
+void snvs_tamper_snapshot(const void *mem, struct snvs_tamper_snapshot *snap);
+unsigned int snvs_tamper_decode(const struct snvs_tamper_snapshot *snap, const struct snvs_event **events, unsigned int max);
+
+#endif /* SNVS_TAMPER_H */
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "snvs.h"
+#include "snvs_sim.h"
+#include "snvs_tee.h"
+
+static size_t invoke_size(const struct snvs_tee_invoke *invoke)
+{
+	if (invoke->cmd == TEE_CMD_PROVISION)
+		return offsetof(struct snvs_tee_invoke, u) + sizeof(invoke->u.provision);
+	return offsetof(struct snvs_tee_invoke, u) + snvs_mu_request_size(invoke->u.batch.count);
+}
+
+static size_t return_size(const struct snvs_tee_return *ret, uint32_t cmd)
+{
+	if (cmd == TEE_CMD_PROVISION)
+		return offsetof(struct snvs_tee_return, u) + ret->log_len;
+	return offsetof(struct snvs_tee_return, u) + snvs_mu_reply_size(ret->u.batch.count);
+}
+
+/* Run the sequence in the trusted application with its log kept in the return buffer */
+static void ta_provision(snvs_t *snvs, const struct snvs_tee_provision *params, struct snvs_tee_return *ret)
+{
+	struct snvs_provision_config config;
+	char *log = NULL;
+	size_t len = 0;
+
+	memset(&config, 0, sizeof(config));
+	memcpy(config.zmk, params->zmk, sizeof(config.zmk));
+	config.zmk_words = params->zmk_words;
+	config.hard_locks = params->hard_locks;
+	config.master_key_sel = params->master_key_sel;
+	config.zeroize_timeout_us = params->zeroize_timeout_us;
+	config.log = params->want_log ? open_memstream(&log, &len) : NULL;
+
+	ret->status = snvs_provision(snvs, &config);
+
+	ret->log_len = 0;
+	if (config.log) {
+		fclose(config.log);
+		ret->log_len = len < SNVS_TEE_LOG_MAX ? len : SNVS_TEE_LOG_MAX;
+		memcpy(ret->u.log, log, ret->log_len);
+		free(log);
+	}
+}
+
+/* Trusted application stand-in: one call in, one return out, until the client closes its end */
+static void ta_serve(int fd)
+{
+	static struct snvs_tee_invoke invoke;
+	static struct snvs_tee_return ret;
+	ssize_t n;
+
+	snvs_t *snvs = snvs_open(SNVS_OPEN_SIM);
+	if (!snvs) {
+		perror("snvs_tee: can't map the simulator");
+		_exit(EXIT_FAILURE);
+	}
+
+	while ((n = recv(fd, &invoke, sizeof(invoke), 0)) > 0) {
+		if ((size_t)n < offsetof(struct snvs_tee_invoke, u) ||
+		    (invoke.cmd == TEE_CMD_BATCH && invoke.u.batch.count > SNVS_MU_MAX_OPS) ||
+		    (invoke.cmd != TEE_CMD_BATCH && invoke.cmd != TEE_CMD_PROVISION) || (size_t)n != invoke_size(&invoke)) {
+			fprintf(stderr, "snvs_tee: malformed call of %zd bytes\n", n);
+			_exit(EXIT_FAILURE);
+		}
+
+		if (invoke.cmd == TEE_CMD_PROVISION) {
+			ta_provision(snvs, &invoke.u.provision, &ret);
+		} else {
+			snvs_mu_execute(snvs_base(snvs), &invoke.u.batch, &ret.u.batch);
+			ret.status = 0;
+			ret.log_len = 0;
+		}
+		if (send(fd, &ret, return_size(&ret, invoke.cmd), 0) < 0)
+			_exit(EXIT_FAILURE);
+	}
+
+	_exit(n < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+static struct snvs_tee_invoke invoke;
+static struct snvs_tee_return ret;
+
+/* One call into the secure world and its return */
+static int tee_call(int fd, struct snvs_backend_stats *stats)
+{
+	uint32_t cmd = invoke.cmd;
+	ssize_t n;
+
+	if (send(fd, &invoke, invoke_size(&invoke), MSG_NOSIGNAL) < 0)
+		return -1;
+	n = recv(fd, &ret, sizeof(ret), 0);
+	if (n <= 0 || (size_t)n != return_size(&ret, cmd))
+		return -1;
+	stats->world_switches += 2;
+	return 0;
+}
+
+static int tee_exchange(int fd, const struct snvs_mu_request *request, struct snvs_mu_reply *reply, int wait,
+			struct snvs_backend_stats *stats)
+{
+	invoke.cmd = TEE_CMD_BATCH;
+	memcpy(&invoke.u.batch, request, snvs_mu_request_size(request->count));
+	if (tee_call(fd, stats))
+		return -1;
+
+	memcpy(reply, &ret.u.batch, snvs_mu_reply_size(ret.u.batch.count));
+	return 0;
+}
+
+static int tee_provision(int fd, const struct snvs_provision_config *config, struct snvs_backend_stats *stats)
+{
+	struct snvs_tee_provision *params = &invoke.u.provision;
+
+	invoke.cmd = TEE_CMD_PROVISION;
+	memcpy(params->zmk, config->zmk, sizeof(params->zmk));
+	params->zmk_words = config->zmk_words;
+	params->hard_locks = !!config->hard_locks;
+	params->master_key_sel = config->master_key_sel;
+	params->zeroize_timeout_us = config->zeroize_timeout_us;
+	params->want_log = config->log != NULL;
+	if (tee_call(fd, stats))
+		return -2;
+
+	if (config->log && ret.log_len)
+		fwrite(ret.u.log, 1, ret.log_len, config->log);
+	return ret.status;
+}
+
+static const struct snvs_mu_transport tee_transport = {
+	.name = "TEE",
+	.synchronous = 1,
+	.exchange = tee_exchange,
+	.provision = tee_provision,
+	.serve = ta_serve,
+};
+
+int snvs_tee_start(void)
+{
+	return snvs_mu_attach(&tee_transport);
+}
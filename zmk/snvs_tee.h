@@ -0,0 +1,95 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	TEE backend
+
+	SNVS owned by a trusted application in the secure world, with Linux only asking for
+	operations. Each call into the TEE is two world switches (entry and return), so requests are
+	made as large as possible:
+
+		TEE_CMD_PROVISION	the whole A/B sequence in one call; the trusted side runs
+					snvs_provision() and returns its result and its log
+		TEE_CMD_BATCH		a batch of register operations (struct snvs_mu_request),
+					for everything else, with the batching of snvs_mu.h
+
+	A call always returns, so unlike the messaging unit no write can be posted: every batch is
+	a round trip. snvs_tee_start() forks a user space stand-in for the trusted application that
+	runs the SNVS simulator; on a board the GlobalPlatform client API call replaces the socket.
+*/
+
+#ifndef SNVS_TEE_H
+#define SNVS_TEE_H
+
+#include <stdint.h>
+
+#include "snvs_mu.h"
+
+//Provisioning log returned by the trusted side; longer logs are cut
+#define SNVS_TEE_LOG_MAX		(64 * 1024)
+
+enum snvs_tee_cmd {
+	TEE_CMD_BATCH,
+	TEE_CMD_PROVISION,
+};
+
+struct snvs_tee_provision {
+	uint32_t zmk[8];
+	uint32_t zmk_words;
+	uint32_t hard_locks;
+	uint32_t master_key_sel;
+	uint32_t zeroize_timeout_us;
+	uint32_t want_log;
+};
+
+struct snvs_tee_invoke {
+	uint32_t cmd;
+	union {
+		struct snvs_mu_request batch;
+		struct snvs_tee_provision provision;
+	} u;
+};
+
+struct snvs_tee_return {
+	int32_t status;
+	uint32_t log_len;
+	union {
+		struct snvs_mu_reply batch;
+		char log[SNVS_TEE_LOG_MAX];
+	} u;
+};
+
+/* Fork the trusted application stand-in and route SNVS access through it; returns 0 or -1 with errno set */
+int snvs_tee_start(void);
+
+#endif /* SNVS_TEE_H */
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "snvs_timing.h"
+
+#define TIMING_LINE_MAX			128
+
+enum { TIMING_READ, TIMING_WRITE };
+
+//Fill the registers the file did not list with the average of their power domain
+static void fill_domains(uint32_t *ns, const uint8_t *listed)
+{
+	double sum[2] = { 0, 0 };
+	unsigned int count[2] = { 0, 0 }, i;
+	uint32_t avg[2];
+
+	for (i = 0; i < SNVS_TIMING_REGS; i++) {
+		if (listed[i]) {
+			sum[snvs_lp_register(4 * i)] += ns[i];
+			count[snvs_lp_register(4 * i)]++;
+		}
+	}
+	for (i = 0; i < 2; i++) {
+		if (count[i])
+			avg[i] = sum[i] / count[i] + 0.5;
+		else
+			avg[i] = count[!i] ? sum[!i] / count[!i] + 0.5 : 0;
+	}
+	for (i = 0; i < SNVS_TIMING_REGS; i++)
+		if (!listed[i])
+			ns[i] = avg[snvs_lp_register(4 * i)];
+}
+
+int snvs_timing_load(const char *path, struct snvs_timing *timing)
+{
+	uint8_t listed[2][SNVS_TIMING_REGS];
+	char line[TIMING_LINE_MAX];
+	unsigned int number = 0, i, j;
+	int errors = 0;
+
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+
+	memset(timing, 0, sizeof(*timing));
+	memset(listed, 0, sizeof(listed));
+	while (fgets(line, sizeof(line), f)) {
+		char *save, *comment = strchr(line, '#'), *end;
+		number++;
+		if (comment)
+			*comment = '\0';
+
+		char *kind = strtok_r(line, " \t\r\n", &save);
+		if (!kind)
+			continue;
+		char *name = strtok_r(NULL, " \t\r\n", &save);
+		char *value = !strcmp(kind, "zeroize") ? name : strtok_r(NULL, " \t\r\n", &save);
+		double ns = value ? strtod(value, &end) : -1;
+		if (!value || *end || ns < 0 || strtok_r(NULL, " \t\r\n", &save)) {
+			fprintf(stderr, "%s:%u: expected 'read|write REGISTER NS' or 'zeroize NS'\n", path, number);
+			errors++;
+			continue;
+		}
+		if (!strcmp(kind, "zeroize")) {
+			timing->zeroize_ns = ns + 0.5;
+			continue;
+		}
+
+		int write = !strcmp(kind, "write");
+		const struct snvs_reg *reg = NULL;
+		for (i = 0; i < snvs_regs_count; i++)
+			if (!strcmp(name, snvs_regs_table[i].name))
+				reg = &snvs_regs_table[i];
+		if ((!write && strcmp(kind, "read")) || !reg) {
+			fprintf(stderr, "%s:%u: unknown access '%s' or register '%s'\n", path, number, kind, name);
+			errors++;
+			continue;
+		}
+		for (j = 0; j < reg->count; j++) {
+			i = reg->offset / 4 + j;
+			(write ? timing->write_ns : timing->read_ns)[i] = ns + 0.5;
+			listed[write][i] = 1;
+		}
+	}
+	fclose(f);
+
+	fill_domains(timing->read_ns, listed[TIMING_READ]);
+	fill_domains(timing->write_ns, listed[TIMING_WRITE]);
+
+	return errors ? -1 : 0;
+}
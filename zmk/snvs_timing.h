@@ -0,0 +1,77 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	SNVS access timing model
+
+	Per-register read and write latencies and the ZMK zeroization delay, loaded from the
+	calibration file written by ./zmk mmio-bench on a board:
+
+		# comment
+		read   SNVS_HPLR     95.3		ns per read
+		write  SNVS_LPGPR    410.0		ns per write (posted write plus read back, minus the read)
+		zeroize 2000				ns from setting a ZMK read lock until the ZMK reads as zero
+
+	Registers missing from the file take the average of the listed registers of the same power
+	domain (SNVS_HP or SNVS_LP), so a file measured on a subset of registers still models the
+	slower LP accesses.
+*/
+
+#ifndef SNVS_TIMING_H
+#define SNVS_TIMING_H
+
+#include <stdint.h>
+
+#include "snvs.h"
+
+#define SNVS_TIMING_REGS		(SNVS_PAGE_SIZE / 4)
+
+//SNVS_LP registers sit between SNVS_LPLR and the end of the LP block; the rest is SNVS_HP
+#define SNVS_LP_FIRST			SNVS_LPLR
+#define SNVS_LP_END			0x800
+
+struct snvs_timing {
+	uint32_t read_ns[SNVS_TIMING_REGS];
+	uint32_t write_ns[SNVS_TIMING_REGS];
+	uint32_t zeroize_ns;
+};
+
+static inline int snvs_lp_register(unsigned int offset)
+{
+	return offset >= SNVS_LP_FIRST && offset < SNVS_LP_END;
+}
+
+/* Load a calibration file; errors are reported on stderr with the line number. Returns 0 on success. */
+int snvs_timing_load(const char *path, struct snvs_timing *timing);
+
+#endif /* SNVS_TIMING_H */
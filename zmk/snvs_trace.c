@@ -0,0 +1,167 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "libsnvs.h"
+#include "snvs_regs.h"
+#include "snvs_trace.h"
+
+struct snvs_trace_event {
+	uint64_t start;
+	uint64_t end;
+	const char *name;
+	uint32_t offset;
+	uint32_t value;
+	uint32_t tid;
+	uint8_t kind;
+};
+
+int snvs_trace_on;
+
+static struct snvs_trace_event *events;
+static unsigned int count, dropped;
+static uint64_t origin;
+static const char *step_name;
+static uint64_t step_start;
+static __thread uint32_t thread_id;
+
+uint64_t snvs_trace_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void snvs_trace_span(enum snvs_trace_kind kind, const char *name, unsigned int offset, uint32_t value, uint64_t start)
+{
+	uint64_t end = snvs_trace_now();
+	unsigned int i = __atomic_fetch_add(&count, 1, __ATOMIC_RELAXED);
+
+	if (i >= SNVS_TRACE_MAX_EVENTS) {
+		__atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	if (!thread_id)
+		thread_id = syscall(SYS_gettid);
+
+	events[i] = (struct snvs_trace_event){ start, end, name, offset, value, thread_id, kind };
+}
+
+void snvs_trace_step(const char *name)
+{
+	if (!snvs_trace_on)
+		return;
+	if (step_name)
+		snvs_trace_span(TRACE_STEP, step_name, 0, 0, step_start);
+	step_name = name;
+	step_start = snvs_trace_now();
+}
+
+SNVS_API int snvs_trace_start(void)
+{
+	if (!events) {
+		events = malloc(SNVS_TRACE_MAX_EVENTS * sizeof(*events));
+		if (!events)
+			return -1;
+	}
+	count = dropped = 0;
+	step_name = NULL;
+	origin = snvs_trace_now();
+	snvs_trace_on = 1;
+	return 0;
+}
+
+static const char * const kind_names[] = { "step", "mmio", "mmio", "poll", "log" };
+
+static void write_event(FILE *f, const struct snvs_trace_event *e, pid_t pid)
+{
+	const struct snvs_reg *reg = snvs_reg_lookup(e->offset);
+	const char *reg_name = reg ? reg->name : "?";
+
+	fprintf(f, ",\n{\"ph\":\"X\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"cat\":\"%s\",",
+		pid, e->tid, (e->start - origin) / 1e3, (e->end - e->start) / 1e3, kind_names[e->kind]);
+
+	switch (e->kind) {
+	case TRACE_READ:
+	case TRACE_WRITE:
+		fprintf(f, "\"name\":\"%s %s\",\"args\":{\"offset\":\"0x%x\",\"value\":\"0x%x\"}}",
+			e->kind == TRACE_READ ? "read" : "write", reg_name, e->offset, e->value);
+		break;
+	case TRACE_POLL:
+		fprintf(f, "\"name\":\"poll %s\",\"args\":{\"offset\":\"0x%x\",\"result\":\"%s\"}}",
+			reg_name, e->offset, e->value ? "timeout" : "match");
+		break;
+	case TRACE_LOG:
+		fprintf(f, "\"name\":\"log\",\"args\":{\"bytes\":%u}}", e->value);
+		break;
+	default:
+		fprintf(f, "\"name\":\"%s\"}", e->name);
+		break;
+	}
+}
+
+/* Stop tracing and write the Chrome trace JSON to path; returns the number of spans written or -1 */
+SNVS_API int snvs_trace_save(const char *path)
+{
+	unsigned int i, n;
+	pid_t pid = getpid();
+
+	if (!events) {
+		errno = EINVAL;
+		return -1;
+	}
+	snvs_trace_step(NULL);
+	snvs_trace_on = 0;
+	n = count < SNVS_TRACE_MAX_EVENTS ? count : SNVS_TRACE_MAX_EVENTS;
+
+	FILE *f = fopen(path, "w");
+	if (!f)
+		return -1;
+
+	fprintf(f, "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped\":%u},\"traceEvents\":[\n", dropped);
+	fprintf(f, "{\"ph\":\"M\",\"pid\":%d,\"name\":\"process_name\",\"args\":{\"name\":\"zmk\"}}", pid);
+	for (i = 0; i < n; i++)
+		write_event(f, &events[i], pid);
+	fprintf(f, "\n]}\n");
+
+	if (fclose(f))
+		return -1;
+	return n;
+}
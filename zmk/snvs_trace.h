@@ -0,0 +1,72 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	Timeline tracing
+
+	Records spans for provisioning steps, SNVS register accesses, snvs_poll() waits and log
+	output into a preallocated in-memory buffer, and writes them as a Chrome trace JSON file
+	(chrome://tracing, https://ui.perfetto.dev) when the run is over, so tracing adds no file
+	I/O to the timeline it records. Spans of one thread nest: a step contains the register
+	accesses, polls and log lines issued while it ran.
+
+	Tracing is a process wide switch like snvs_sim; while it is off each hook costs one branch.
+	The buffer holds SNVS_TRACE_MAX_EVENTS spans, later ones are counted and dropped.
+*/
+
+#ifndef SNVS_TRACE_H
+#define SNVS_TRACE_H
+
+#include <stdint.h>
+
+#define SNVS_TRACE_MAX_EVENTS		(1 << 18)
+
+enum snvs_trace_kind {
+	TRACE_STEP,
+	TRACE_READ,
+	TRACE_WRITE,
+	TRACE_POLL,
+	TRACE_LOG,
+};
+
+extern int snvs_trace_on;
+
+uint64_t snvs_trace_now(void);
+
+/* Span from start (snvs_trace_now()) until now; name for steps and log lines, offset/value for register accesses and polls */
+void snvs_trace_span(enum snvs_trace_kind kind, const char *name, unsigned int offset, uint32_t value, uint64_t start);
+
+/* Close the running step span and open the next one; NULL only closes */
+void snvs_trace_step(const char *name);
+
+#endif /* SNVS_TRACE_H */
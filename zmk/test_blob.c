@@ -0,0 +1,285 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/crypto.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+
+#include "test_blob.h"
+
+#define BLOB_KDF_LABEL			"zmk test blob key encryption key"
+
+//A fresh BK is drawn for every blob, so a fixed CCM nonce never repeats under one key
+static const uint8_t blob_nonce[BLOB_NONCE_BYTES];
+
+//This engine's own derivation, not CAAM's (see test_blob.h)
+static int blob_bkek(const uint8_t *master_key, const uint8_t *key_modifier, uint8_t *bkek)
+{
+	uint8_t msg[sizeof(BLOB_KDF_LABEL) + BLOB_KEY_MODIFIER_BYTES];
+	unsigned int len = BLOB_KEY_BYTES;
+
+	memcpy(msg, BLOB_KDF_LABEL, sizeof(BLOB_KDF_LABEL));
+	memcpy(msg + sizeof(BLOB_KDF_LABEL), key_modifier, BLOB_KEY_MODIFIER_BYTES);
+
+	return HMAC(EVP_sha256(), master_key, BLOB_KEY_BYTES, msg, sizeof(msg), bkek, &len) ? 0 : -1;
+}
+
+static int blob_ecb(EVP_CIPHER_CTX *ctx, const uint8_t *key, const uint8_t *in, uint8_t *out, int enc)
+{
+	int len;
+
+	return EVP_CipherInit_ex(ctx, EVP_aes_256_ecb(), NULL, key, NULL, enc) == 1 &&
+		EVP_CIPHER_CTX_set_padding(ctx, 0) == 1 &&
+		EVP_CipherUpdate(ctx, out, &len, in, BLOB_KEY_BYTES) == 1 && len == BLOB_KEY_BYTES ? 0 : -1;
+}
+
+/* One AES-CCM pass; on decryption the tag is checked and -1 returned on mismatch */
+static int blob_ccm(EVP_CIPHER_CTX *ctx, const EVP_CIPHER *cipher, int enc, const uint8_t *key,
+	const uint8_t *nonce, int nonce_len, const uint8_t *aad, int aad_len,
+	const uint8_t *in, int len, uint8_t *out, uint8_t *tag, int tag_len)
+{
+	int outl;
+
+	if (EVP_CipherInit_ex(ctx, cipher, NULL, NULL, NULL, enc) != 1 ||
+	    EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_IVLEN, nonce_len, NULL) != 1 ||
+	    EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, tag_len, enc ? NULL : tag) != 1 ||
+	    EVP_CipherInit_ex(ctx, NULL, NULL, key, nonce, enc) != 1 ||
+	    EVP_CipherUpdate(ctx, NULL, &outl, NULL, len) != 1)
+		return -1;
+	if (aad_len && EVP_CipherUpdate(ctx, NULL, &outl, aad, aad_len) != 1)
+		return -1;
+	if (EVP_CipherUpdate(ctx, out, &outl, in, len) != 1)
+		return -1;
+	if (enc && (EVP_CipherFinal_ex(ctx, out + outl, &outl) != 1 ||
+		    EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, tag_len, tag) != 1))
+		return -1;
+
+	return 0;
+}
+
+int test_blob_init(struct test_blob_ctx *ctx, const uint8_t *master_key, const uint8_t *key_modifier)
+{
+	ctx->ecb = EVP_CIPHER_CTX_new();
+	ctx->ccm = EVP_CIPHER_CTX_new();
+	if (!ctx->ecb || !ctx->ccm || blob_bkek(master_key, key_modifier, ctx->bkek)) {
+		test_blob_free(ctx);
+		return -1;
+	}
+
+	return 0;
+}
+
+void test_blob_free(struct test_blob_ctx *ctx)
+{
+	EVP_CIPHER_CTX_free(ctx->ecb);
+	EVP_CIPHER_CTX_free(ctx->ccm);
+	ctx->ecb = ctx->ccm = NULL;
+	OPENSSL_cleanse(ctx->bkek, sizeof(ctx->bkek));
+}
+
+/* blob must hold len + BLOB_OVERHEAD bytes */
+int test_blob_encap(struct test_blob_ctx *ctx, const uint8_t *in, size_t len, uint8_t *blob)
+{
+	uint8_t bk[BLOB_KEY_BYTES];
+	int ret = -1;
+
+	if (len > BLOB_MAX_PAYLOAD || RAND_bytes(bk, sizeof(bk)) != 1)
+		return -1;
+
+	if (!blob_ecb(ctx->ecb, ctx->bkek, bk, blob, 1) &&
+	    !blob_ccm(ctx->ccm, EVP_aes_256_ccm(), 1, bk, blob_nonce, BLOB_NONCE_BYTES, NULL, 0,
+		      in, len, blob + BLOB_KEY_BYTES, blob + BLOB_KEY_BYTES + len, BLOB_MAC_BYTES))
+		ret = 0;
+
+	OPENSSL_cleanse(bk, sizeof(bk));
+	return ret;
+}
+
+/* out must hold blob_len - BLOB_OVERHEAD bytes; returns -1 on a malformed blob or MAC mismatch */
+int test_blob_decap(struct test_blob_ctx *ctx, const uint8_t *blob, size_t blob_len, uint8_t *out)
+{
+	uint8_t bk[BLOB_KEY_BYTES], mac[BLOB_MAC_BYTES];
+	size_t len = blob_len - BLOB_OVERHEAD;
+	int ret = -1;
+
+	if (blob_len < BLOB_OVERHEAD || len > BLOB_MAX_PAYLOAD)
+		return -1;
+
+	memcpy(mac, blob + BLOB_KEY_BYTES + len, BLOB_MAC_BYTES);
+	if (!blob_ecb(ctx->ecb, ctx->bkek, blob, bk, 0) &&
+	    !blob_ccm(ctx->ccm, EVP_aes_256_ccm(), 0, bk, blob_nonce, BLOB_NONCE_BYTES, NULL, 0,
+		      blob + BLOB_KEY_BYTES, len, out, mac, BLOB_MAC_BYTES))
+		ret = 0;
+
+	OPENSSL_cleanse(bk, sizeof(bk));
+	if (ret)
+		memset(out, 0, len);
+	return ret;
+}
+
+struct blob_worker {
+	pthread_t thread;
+	const uint8_t *master_key;
+	const uint8_t *key_modifier;
+	struct test_blob_job *jobs;
+	size_t count;
+	size_t *next;
+	int decap;
+	size_t failed;
+};
+
+#define BLOB_WORKER_CHUNK		16
+
+static void *blob_worker(void *arg)
+{
+	struct blob_worker *w = arg;
+	struct test_blob_ctx ctx;
+	size_t i, end;
+
+	if (test_blob_init(&ctx, w->master_key, w->key_modifier)) {
+		w->failed = (size_t)-1;
+		return NULL;
+	}
+
+	while ((i = __atomic_fetch_add(w->next, BLOB_WORKER_CHUNK, __ATOMIC_RELAXED)) < w->count) {
+		end = i + BLOB_WORKER_CHUNK < w->count ? i + BLOB_WORKER_CHUNK : w->count;
+		for (; i < end; i++) {
+			struct test_blob_job *job = &w->jobs[i];
+			job->result = w->decap ? test_blob_decap(&ctx, job->in, job->len, job->out) :
+				test_blob_encap(&ctx, job->in, job->len, job->out);
+			w->failed += job->result != 0;
+		}
+	}
+
+	test_blob_free(&ctx);
+	return NULL;
+}
+
+/*
+ * Encapsulates (decap = 0) or decapsulates every job with the given master key and key
+ * modifier on threads worker threads. Returns the number of failed jobs.
+ */
+size_t test_blob_run(const uint8_t *master_key, const uint8_t *key_modifier, struct test_blob_job *jobs, size_t count,
+	int decap, unsigned int threads)
+{
+	struct blob_worker *workers;
+	size_t next = 0, failed = 0;
+	unsigned int i;
+
+	if (!threads)
+		threads = 1;
+	workers = calloc(threads, sizeof(*workers));
+	if (!workers)
+		return count;
+
+	for (i = 0; i < threads; i++) {
+		workers[i].master_key = master_key;
+		workers[i].key_modifier = key_modifier;
+		workers[i].jobs = jobs;
+		workers[i].count = count;
+		workers[i].next = &next;
+		workers[i].decap = decap;
+		if (pthread_create(&workers[i].thread, NULL, blob_worker, &workers[i]))
+			threads = i;
+	}
+	for (i = 0; i < threads; i++) {
+		pthread_join(workers[i].thread, NULL);
+		if (workers[i].failed == (size_t)-1)
+			failed = count;
+		else if (failed != count)
+			failed += workers[i].failed;
+	}
+	if (!threads)
+		failed = count;
+
+	free(workers);
+	return failed;
+}
+
+/*
+ * Known answer test of the AES-CCM layer (NIST SP 800-38C, example 1), then a blob round trip
+ * and the checks that a modified blob or a different key modifier is rejected.
+ */
+int test_blob_selftest(void)
+{
+	static const uint8_t kat_key[16] = {
+		0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f,
+	};
+	static const uint8_t kat_nonce[7] = { 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16 };
+	static const uint8_t kat_aad[8] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07 };
+	static const uint8_t kat_plain[4] = { 0x20, 0x21, 0x22, 0x23 };
+	static const uint8_t kat_cipher[4] = { 0x71, 0x62, 0x01, 0x5b };
+	static const uint8_t kat_tag[4] = { 0x4d, 0xac, 0x25, 0x5d };
+	uint8_t master_key[BLOB_KEY_BYTES] = { 0 }, modifier[BLOB_KEY_MODIFIER_BYTES] = { 0 };
+	uint8_t out[4], tag[4], payload[64], blob[sizeof(payload) + BLOB_OVERHEAD], back[sizeof(payload)];
+	struct test_blob_ctx ctx, other;
+	unsigned int i;
+	int ret = -1;
+
+	EVP_CIPHER_CTX *cctx = EVP_CIPHER_CTX_new();
+	if (!cctx)
+		return -1;
+	i = blob_ccm(cctx, EVP_aes_128_ccm(), 1, kat_key, kat_nonce, sizeof(kat_nonce), kat_aad, sizeof(kat_aad),
+		kat_plain, sizeof(kat_plain), out, tag, sizeof(tag));
+	EVP_CIPHER_CTX_free(cctx);
+	if (i || memcmp(out, kat_cipher, sizeof(out)) || memcmp(tag, kat_tag, sizeof(tag)))
+		return -1;
+
+	for (i = 0; i < sizeof(payload); i++)
+		payload[i] = i;
+	master_key[0] = 0x44;
+	modifier[0] = 0x01;
+
+	if (test_blob_init(&ctx, master_key, modifier))
+		return -1;
+	modifier[0] = 0x02;
+	if (test_blob_init(&other, master_key, modifier)) {
+		test_blob_free(&ctx);
+		return -1;
+	}
+
+	if (!test_blob_encap(&ctx, payload, sizeof(payload), blob) &&
+	    !test_blob_decap(&ctx, blob, sizeof(blob), back) && !memcmp(back, payload, sizeof(payload)) &&
+	    test_blob_decap(&other, blob, sizeof(blob), back)) {
+		blob[BLOB_KEY_BYTES + 3] ^= 0x80;
+		ret = test_blob_decap(&ctx, blob, sizeof(blob), back) ? 0 : -1;
+	}
+
+	test_blob_free(&ctx);
+	test_blob_free(&other);
+	return ret;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2017 NXP
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+ /**
+	Software test blob engine (host side, no board needed) - NOT a CAAM blob format
+
+	The engine follows the structure of a CAAM red blob: a payload is protected with a fresh
+	random 256-bit blob key (BK), the BK is encrypted with a blob key encryption key (BKEK)
+	derived from the master key selected by SNVS and a 128-bit key modifier, and the payload is
+	encrypted and authenticated with the BK:
+
+		+--------------------+-----------------------------+------------+
+		| AES-ECB(BKEK, BK)  | AES-CCM(BK) payload         | CCM MAC    |
+		| 32 bytes           | payload length              | 16 bytes   |
+		+--------------------+-----------------------------+------------+
+
+	The BKEK derivation is not CAAM's, which is not public: blob_bkek() uses an HMAC-SHA256 of
+	the key modifier under a label of this engine. Blobs made here open only with this engine,
+	never on a board, and no board blob opens here; they exist to test the blob store, the job
+	ring simulator and migration after a master key change. Making the engine CAAM compatible
+	needs the real derivation, validated against blobs captured from hardware.
+
+	AES runs through OpenSSL EVP, which uses AES-NI on x86 hosts and the ARMv8 crypto extensions
+	where present. test_blob_run() spreads a batch of blobs over worker threads, each with its
+	own cipher contexts.
+*/
+
+#ifndef TEST_BLOB_H
+#define TEST_BLOB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <openssl/evp.h>
+
+#define BLOB_KEY_BYTES			32
+#define BLOB_KEY_MODIFIER_BYTES		16
+#define BLOB_MAC_BYTES			16
+#define BLOB_OVERHEAD			(BLOB_KEY_BYTES + BLOB_MAC_BYTES)
+#define BLOB_NONCE_BYTES		12
+#define BLOB_MAX_PAYLOAD		0xFFFFFF	//CCM length field of 3 bytes
+
+struct test_blob_ctx {
+	uint8_t bkek[BLOB_KEY_BYTES];
+	EVP_CIPHER_CTX *ecb;
+	EVP_CIPHER_CTX *ccm;
+};
+
+struct test_blob_job {
+	const uint8_t *in;
+	size_t len;			/* payload length for encap, blob length for decap */
+	uint8_t *out;			/* len + BLOB_OVERHEAD for encap, len - BLOB_OVERHEAD for decap */
+	int result;			/* 0 on success, -1 on failure (bad MAC for decap) */
+};
+
+int test_blob_init(struct test_blob_ctx *ctx, const uint8_t *master_key, const uint8_t *key_modifier);
+void test_blob_free(struct test_blob_ctx *ctx);
+int test_blob_encap(struct test_blob_ctx *ctx, const uint8_t *in, size_t len, uint8_t *blob);
+int test_blob_decap(struct test_blob_ctx *ctx, const uint8_t *blob, size_t blob_len, uint8_t *out);
+size_t test_blob_run(const uint8_t *master_key, const uint8_t *key_modifier, struct test_blob_job *jobs, size_t count,
+	int decap, unsigned int threads);
+int test_blob_selftest(void);
+
+#endif /* TEST_BLOB_H */
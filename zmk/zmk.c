@@ -41,7 +41,7 @@
 	1. Transition SSM (System Security Monitor - see SNVS_HPSR[SSM_ST]) from check state to functional state (trusted/secure/non-secure)
 	2. Set the correct value in the Power Glitch Detector Register
 	3. Clear the power glitch record in the LP Status Register
-	4. User Specific: Enable security violations and interrupts in SNVS control and configuration registers		-- see B section
+	4. User Specific: Enable security violations and interrupts in SNVS control and configuration registers		-- see snvs_tamper.c
 	5. User specific: Program SNVS general functions/configurations		-- see B section
 	6. User specific: Set lock bits			-- see B section
 
@@ -69,6 +69,7 @@
 */
 
 #include <stdio.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -80,245 +81,2504 @@
 #include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/time.h>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 
-#define ADDR_SIZE 4
+#include "snvs.h"
+#include "libsnvs.h"
+#include "snvs_sim.h"
+#include "snvs_mc.h"
+#include "snvs_gpr.h"
+#include "snvs_tamper.h"
+#include "snvs_mkey.h"
+#include "test_blob.h"
+#include "caam_desc.h"
+#include "caam_jr_sim.h"
+#include "blob_store.h"
+#include "blob_migrate.h"
+#include "snvs_script.h"
+#include "snvs_timing.h"
+#include "snvs_backend.h"
+#include "snvs_bc.h"
+#include "snvs_async.h"
+#include "snvs_daemon.h"
+#include "snvs_archive.h"
+#include "snvs_campaign.h"
 
 #define	POR				0x1000
 #define	SYSTEM_RESET			0x2000
 #define RESET				POR
 
-//SNVS = Secure Non-Volatile Storage registers
-#define SNVS_BASE_REG			0x020cc000
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
 
-//SNVS registers offsets (all these need to be referred using SNVS_BASE_REG)
-#define SNVS_HPLR			0x0		//SNVS_HP Lock Register (contains lock bits for the SNVS registers; this is a privileged write register)
-	#define ZMK_WSL_MASK		0x1
-	#define ZMK_WSL_OFFSET		0
-	#define ZMK_RSL_MASK		0x2
-	#define ZMK_RSL_OFFSET		1
-	#define MKS_SL_MASK		0x0200
-	#define MKS_SL_OFFSET		9
+static unsigned int print_tamper_events(const void *mem)
+{
+	const struct snvs_event *events[SNVS_TAMPER_MAX_EVENTS];
+	struct snvs_tamper_snapshot snap;
+	unsigned int i, n;
 
-#define SNVS_HPCOMR			0x4		//SNVS_HP Command Register
-	#define MKS_EN_MASK		0x00002000
-	#define MKS_EN_OFFSET		13
+	snvs_tamper_snapshot(mem, &snap);
+	n = snvs_tamper_decode(&snap, events, SNVS_TAMPER_MAX_EVENTS);
+	for (i = 0; i < n; i++)
+		printf("[INFO] \t\t %s[%s] %s\n", events[i]->reg == SNVS_HPSVSR ? "SNVS_HPSVSR" : "SNVS_LPSR",
+			events[i]->name, events[i]->description);
 
-#define SNVS_HPCR			0x8		//SNVS_HP Control Register
-
-#define SNVS_HPSR			0x14		//SNVS_HP Status Register	(reflects the internal state of the SNVS)
-	#define SSM_ST_MASK		0x00000F00
-	#define SSM_ST_OFFSET		8
+	return n;
+}
 
-#define SNVS_LPLR			0x34		//SNVS_LP Lock Register (contains lock bits for the SNVS_LP registers)
-	#define ZMK_WHL_MASK		0x1
-	#define ZMK_WHL_OFFSET		0
-	#define ZMK_RHL_MASK		0x2
-	#define ZMK_RHL_OFFSET		1
-	#define MKS_HL_MASK		0x200
-	#define MKS_HL_OFFSET		9
+static snvs_t *snvs;
 
+//snvs_open() flags selected on the command line
+static unsigned int open_flags;
 
-#define SNVS_LPMKCR			0x3C		//SNVS_LP Master Key Control Register
-	#define ZMK_HWP_MASK		0x4
-	#define ZMK_HWP_OFFSET		2
-	#define ZMK_VAL_MASK		0x8
-	#define ZMK_VAL_OFFSET		3
-	#define MASTER_KEY_SEL_VALUE	0x2
-	#define ZMK_ECC_EN		0x10
+static unsigned int *map_SNVS(void)
+{
+	if (!snvs)
+		snvs = snvs_open(open_flags);
+	if (!snvs) {
+		perror ("Can't map SNVS");
+		return NULL;
+	}
 
-#define SNVS_LPSR			0x4c		//SNVS_LP Status Register (reflects the internal state and behavior of the SNVS_LP) (need to write 1 to PGD)
-	#define	PGD_MASK		0x8
+	return snvs_base(snvs);
+}
 
-#define SNVS_LPPGDR			0x64		//SNVS_LP Power Glitch Detector Register (by default need to write 0x41736166 accordint with Security RM)
-	#define POWER_GLITCH_VALUE	0x41736166
+/*
+ * Read-only handle for the SRTC readers, which load from the page directly. Behind a messaging
+ * unit or a TEE there is no page to load from, only a placeholder.
+ */
+static snvs_t *open_SNVS_reader(const char *cmd)
+{
+	if (open_flags & (SNVS_OPEN_MU | SNVS_OPEN_TEE)) {
+		fprintf(stderr, "%s: reads the SNVS page directly, not available with -m or -t\n", cmd);
+		return NULL;
+	}
 
-#define SNVS_LPZMKRn			0x6c		//8 registers SNVS_LPZMKR0 ... SNVS_LPZMKR7; this example will set up only SNVS_LPZMKR0
-	#define ZMK_VALUE		0x11223344
+	snvs_t *reader = snvs_open(open_flags | SNVS_OPEN_READONLY);
+	if (!reader)
+		perror ("Can't map SNVS read-only");
+	return reader;
+}
 
-#define SNVS_HPVIDR1			0xBF8
-	#define IP_ID_MASK		0xFFFF0000
-	#define IP_ID_OFFSET		16
-	#define MAJOR_REV_MASK		0x0000FF00
-	#define MAJOR_REV_OFFSET	8
-	#define MINOR_REV_MASK		0x000000FF
-	#define MINOR_REV_OFFSET	0
+/* With the simulator timing model, report the register access time the board would spend */
+static void print_predicted(const void *mem, uint64_t start)
+{
+	if (snvs_sim && snvs_sim_timed())
+		printf("[INFO] \t Predicted on-target register access time: %.1f us\n", (snvs_sim_clock(mem) - start) / 1e3);
+}
 
-#define SNVS_HPVIDR2			0xBFC
+static const struct snvs_provision_config default_config = {
+	.zmk = { ZMK_VALUE },
+	.zmk_words = 1,
+	.hard_locks = RESET == POR,
+	.master_key_sel = MASTER_KEY_SEL_VALUE,
+};
 
-#define get_value_of_SNVS_reg_field(virt_addr, add_offset, field, offset)  ((((*(int*)(((void*)virt_addr)+add_offset))) & field) >> offset)
-#define get_SNVS_reg(virt_addr, add_offset)  (int*)(((void*)virt_addr)+add_offset)
-#define set_value_of_SNVS_reg(virt_addr, add_offset, value)	*get_SNVS_reg(virt_addr, add_offset) = ((*get_SNVS_reg(virt_addr, add_offset) | (unsigned int)value))
+static int provision_ZMK(int argc, char *argv[])
+{
+	struct snvs_provision_config config = default_config;
 
+	config.log = stdout;
 
-int main(){
 	printf("\n\t ZMK Programming Example\n\n");
 
-	int fd = open("/dev/mem", O_SYNC | O_RDWR);
-	if (fd < 0) {
-		perror ("Can't open /dev/mem!\n");
+	unsigned int *mem = map_SNVS();
+	if (!mem)
+		return EXIT_FAILURE;
+
+	uint64_t start = snvs_sim_timed() ? snvs_sim_clock(mem) : 0;
+	int ret = snvs_provision(snvs, &config);
+	print_predicted(mem, start);
+
+	return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static int show_id(int argc, char *argv[])
+{
+	if (!map_SNVS())
+		return EXIT_FAILURE;
+
+	const struct snvs_identity *id = snvs_identity(snvs);
+
+	printf("[INFO] \t SoC UID = 0x%016llx\n", (unsigned long long)id->uid);
+	printf("[INFO] \t SNVS_HPVIDR1=0x%x, SNVS_HPVIDR2=0x%x, SNVS_HPSR[SSM_ST] = 0x%x\n", id->hpvidr1, id->hpvidr2,
+		snvs_field(id->hpsr, SSM_ST_MASK));
+	printf("[INFO] \t SNVS_HPLR = 0x%x, SNVS_LPLR = 0x%x, SNVS_LPMKCR = 0x%x\n", id->hplr, id->lplr, id->lpmkcr);
+
+	return EXIT_SUCCESS;
+}
+
+static int show_regs(int argc, char *argv[])
+{
+	char line[256];
+	unsigned int i, j;
+
+	unsigned int *mem = map_SNVS();
+	if (!mem)
+		return EXIT_FAILURE;
+
+	for (i = 0; i < snvs_regs_count; i++) {
+		const struct snvs_reg *reg = &snvs_regs_table[i];
+		for (j = 0; j < reg->count; j++) {
+			unsigned int offset = reg->offset + 4 * j;
+			snvs_regs_decode(offset, read_SNVS_reg(mem, offset), line, sizeof(line));
+			printf("[INFO] \t %s\n", line);
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+
+static int show_srtc(int argc, char *argv[])
+{
+	snvs_t *reader = open_SNVS_reader("srtc");
+	if (!reader)
+		return EXIT_FAILURE;
+
+	const volatile uint32_t *mem = snvs_base(reader);
+	uint64_t ticks;
+	struct timespec ts;
+	if (read_SNVS_srtc(mem, &ticks)) {
+		printf("[ERROR] \t SNVS_LPSRTCMR/SNVS_LPSRTCLR did not settle after %d reads.\n", SRTC_READ_RETRIES);
+		snvs_close(reader);
+		return EXIT_FAILURE;
+	}
+	SNVS_srtc_to_timespec(ticks, &ts);
+
+	printf("[INFO] \t SNVS_LPCR[SRTC_ENV] = %d\n", SNVS_srtc_enabled(mem));
+	printf("[INFO] \t SRTC = 0x%012llx ticks (%lld.%09ld s)\n",
+		(unsigned long long)ticks, (long long)ts.tv_sec, ts.tv_nsec);
+	snvs_close(reader);
+
+	return EXIT_SUCCESS;
+}
+
+static double elapsed_ns(const struct timespec *t0, const struct timespec *t1)
+{
+	return (t1->tv_sec - t0->tv_sec) * 1e9 + (t1->tv_nsec - t0->tv_nsec);
+}
+
+#define SRTC_BENCH_ITERATIONS		1000000
+
+static int bench_srtc(int argc, char *argv[])
+{
+	long i, n = argc > 0 ? atol(argv[0]) : SRTC_BENCH_ITERATIONS;
+	if (n <= 0)
+		n = SRTC_BENCH_ITERATIONS;
+
+	snvs_t *reader = open_SNVS_reader("srtc-bench");
+	if (!reader)
+		return EXIT_FAILURE;
+
+	const volatile uint32_t *mem = snvs_base(reader);
+	struct timespec t0, t1, ts;
+	uint64_t ticks = 0, sink = 0;
+	long failed = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < n; i++) {
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		sink += ts.tv_nsec;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	double ns_clock = elapsed_ns(&t0, &t1) / n;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < n; i++) {
+		if (read_SNVS_srtc(mem, &ticks))
+			failed++;
+		sink += ticks;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	double ns_srtc = elapsed_ns(&t0, &t1) / n;
+
+	printf("[INFO] \t %ld iterations (checksum 0x%llx)\n", n, (unsigned long long)sink);
+	printf("[INFO] \t clock_gettime(CLOCK_MONOTONIC) %8.1f ns/read\n", ns_clock);
+	printf("[INFO] \t SNVS SRTC double read           %8.1f ns/read (%ld unsettled)\n", ns_srtc, failed);
+	snvs_close(reader);
+
+	return EXIT_SUCCESS;
+}
+
+#define MMIO_BENCH_ITERATIONS		100000
+
+//Registers that can be written back with their own value without side effects
+static const unsigned int mmio_bench_writable[] = { SNVS_HPCR, SNVS_LPPGDR, SNVS_LPGPR };
+
+static int bench_mmio(int argc, char *argv[])
+{
+	long i, n = argc > 0 ? atol(argv[0]) : MMIO_BENCH_ITERATIONS;
+	const char *path = argc > 1 ? argv[1] : NULL;
+	long zeroize_ns = argc > 2 ? atol(argv[2]) : 0;
+	double read_ns[SNVS_TIMING_REGS] = { 0 }, domain[2] = { 0, 0 };
+	unsigned int count[2] = { 0, 0 }, r;
+	struct timespec t0, t1;
+	uint32_t sink = 0;
+
+	if (n <= 0)
+		n = MMIO_BENCH_ITERATIONS;
+
+	unsigned int *mem = map_SNVS();
+	if (!mem)
+		return EXIT_FAILURE;
+
+	FILE *f = path ? fopen(path, "w") : stdout;
+	if (!f) {
+		perror(path);
 		return EXIT_FAILURE;
 	}
+	fprintf(f, "# zmk mmio-bench: %ld accesses per register on %s\n", n, snvs_sim ? "the simulator" : "/dev/mem");
+
+	for (r = 0; r < snvs_regs_count; r++) {
+		unsigned int offset = snvs_regs_table[r].offset;
+
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		for (i = 0; i < n; i++)
+			sink += read_SNVS_reg(mem, offset);
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+
+		read_ns[offset / 4] = elapsed_ns(&t0, &t1) / n;
+		domain[snvs_lp_register(offset)] += read_ns[offset / 4];
+		count[snvs_lp_register(offset)]++;
+		fprintf(f, "read %-14s %8.1f\n", snvs_regs_table[r].name, read_ns[offset / 4]);
+	}
+
+	//A posted write returns before it reaches SNVS; the read back waits for it to land
+	for (r = 0; r < ARRAY_SIZE(mmio_bench_writable); r++) {
+		unsigned int offset = mmio_bench_writable[r];
+		uint32_t value = read_SNVS_reg(mem, offset);
+
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		for (i = 0; i < n; i++) {
+			write_SNVS_reg(mem, offset, value);
+			sink += read_SNVS_reg(mem, offset);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+
+		double ns = elapsed_ns(&t0, &t1) / n - read_ns[offset / 4];
+		fprintf(f, "write %-13s %8.1f\n", snvs_reg_lookup(offset)->name, ns > 0 ? ns : 0);
+	}
+	fprintf(f, "zeroize %ld\n", zeroize_ns);
+	if (f != stdout)
+		fclose(f);
+
+	printf("[INFO] \t Average read: SNVS_HP %.1f ns, SNVS_LP %.1f ns (checksum 0x%x)\n",
+		count[0] ? domain[0] / count[0] : 0, count[1] ? domain[1] / count[1] : 0, sink);
+	if (path)
+		printf("[SUCCESS] \t Calibration written to %s; use it with ZMK_SIM_TIMING=%s ./zmk -s\n", path, path);
+
+	return EXIT_SUCCESS;
+}
+
+/* Bytecode host for Linux: steps are recorded in SNVS_LPGPR like snvs_provision() does */
+struct bc_host_ctx {
+	void *mem;
+	struct snvs_gpr_record rec;
+	int verbose;
+};
+
+static void bc_host_step(void *ctx, unsigned int step)
+{
+	struct bc_host_ctx *host = ctx;
+
+	host->rec.step = step;
+	if (snvs_gpr_store(host->mem, &host->rec))
+		printf("[ERROR] \t\t Step %s could not be recorded in SNVS_LPGPR.\n", snvs_step_name(step));
+	else if (host->verbose)
+		printf("[INFO] \t Step %s recorded in SNVS_LPGPR\n", snvs_step_name(step));
+}
+
+static uint64_t bc_host_now_us(void *ctx)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void bc_host_init(struct bc_host_ctx *ctx, struct snvs_bc_host *host, void *mem, const struct snvs_provision_config *config)
+{
+	ctx->mem = mem;
+	ctx->verbose = 0;
+	ctx->rec.policy = (config->hard_locks ? GPR_POLICY_HARD_LOCKS : 0) |
+		((config->master_key_sel & MASTER_KEY_SEL_MASK) << GPR_POLICY_MKS_OFFSET);
+	snvs_gpr_fingerprint(config->zmk, config->zmk_words, ctx->rec.fingerprint);
+	host->ctx = ctx;
+	host->step = bc_host_step;
+	host->now_us = bc_host_now_us;
+}
 
-	unsigned int *mem = mmap (NULL, ADDR_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, SNVS_BASE_REG);
-	if (mem == MAP_FAILED) {
-		perror ("Can't map memory, maybe the address is not truncated\n");
+static int show_bc(int argc, char *argv[])
+{
+	uint8_t code[SNVS_BC_MAX];
+	char line[128];
+	size_t pc, n;
+
+	int len = snvs_bc_compile_provision(&default_config, code, sizeof(code));
+	if (len < 0) {
+		fprintf(stderr, "bc: program does not fit in %d bytes\n", SNVS_BC_MAX);
 		return EXIT_FAILURE;
 	}
+	for (pc = 0; pc < (size_t)len; pc += n) {
+		n = snvs_bc_disassemble(code, len, pc, line, sizeof(line));
+		printf("%s\n", line);
+	}
+	printf("[INFO] \t %d bytes\n", len);
+
+	if (argc > 0) {
+		FILE *f = fopen(argv[0], "wb");
+		if (!f || fwrite(code, 1, len, f) != (size_t)len || fclose(f)) {
+			perror(argv[0]);
+			return EXIT_FAILURE;
+		}
+		printf("[SUCCESS] \t Program written to %s\n", argv[0]);
+	}
+
+	return EXIT_SUCCESS;
+}
 
-	unsigned int rev1 = *get_SNVS_reg(mem, SNVS_HPVIDR1);
-	unsigned int rev2 = *get_SNVS_reg(mem, SNVS_HPVIDR2);
+static int run_bc(int argc, char *argv[])
+{
+	uint8_t code[SNVS_BC_MAX];
+	struct snvs_bc_host host;
+	struct bc_host_ctx ctx;
+	struct snvs_bc_result result;
 
-	printf("[INFO] \t SNVS_HPVIDR1=0x%x, SNVS_HPVIDR2=0x%x\n", rev1, rev2);
-	printf("[INFO] \t\t  SNVS_HPVIDR1[IP_ID,MAJOR_REV,MINOR_REV]=[0x%x, 0x%x, 0x%x]\n",
-		get_value_of_SNVS_reg_field(mem, SNVS_HPVIDR1, IP_ID_MASK, IP_ID_OFFSET),
-		get_value_of_SNVS_reg_field(mem, SNVS_HPVIDR1, MAJOR_REV_MASK, MAJOR_REV_OFFSET),
-		get_value_of_SNVS_reg_field(mem, SNVS_HPVIDR1, MINOR_REV_MASK, MINOR_REV_OFFSET));
+	if (argc < 1) {
+		fprintf(stderr, "bc-run: missing program file\n");
+		return EXIT_FAILURE;
+	}
+	FILE *f = fopen(argv[0], "rb");
+	if (!f) {
+		perror(argv[0]);
+		return EXIT_FAILURE;
+	}
+	size_t len = fread(code, 1, sizeof(code), f);
+	fclose(f);
 
-	printf("[INFO] \t The current ZMK key value before starting the ZMK algorithm is 0x%x \n", *get_SNVS_reg(mem, SNVS_LPZMKRn));
-	printf("[INFO] \t SNVS_HPLR  = 0x%x\n", *get_SNVS_reg(mem, SNVS_HPLR));
-	printf("[INFO] \t SNVS_LPLR  = 0x%x\n", *get_SNVS_reg(mem, SNVS_LPLR));
+	unsigned int *mem = map_SNVS();
+	if (!mem)
+		return EXIT_FAILURE;
+
+	//The program carries the key; the record fingerprint follows the built-in configuration
+	bc_host_init(&ctx, &host, mem, &default_config);
+	ctx.verbose = 1;
+	snvs_bc_run(code, len, mem, &host, &result);
 
-	//A.1. Check transition SSM (System Security Monitor - see SNVS_HPSR[SSM_ST]) from check state to functional state (trusted/secure/non-secure)
-	printf("[INFO] \t A.1. Checking transition SSM (System Security Monitor - see SNVS_HPSR[SSM_ST]) from check state to functional state (trusted/secure/non-secure)\n");
-	unsigned char SSM_state = get_value_of_SNVS_reg_field(mem, SNVS_HPSR, SSM_ST_MASK, SSM_ST_OFFSET);
-	if (SSM_state < 0xB) {
-		printf("[ERROR] \t\t Transition of SSM[System Security Monitor] is not trusted, secure or non-secure. Please check the Security Reference Manual for more details.\n");
+	if (result.fail) {
+		printf("[ERROR] \t %s at 0x%04x after %u instructions\n", snvs_bc_fail_name(result.fail), result.pc, result.executed);
 		return EXIT_FAILURE;
 	}
-	switch (SSM_state) {
-		case 0xb:
-			printf ("[INFO] \t\t System Security Monitor is in Non-Secure mode\n");
+	printf("[SUCCESS] \t Program of %zu bytes done, %u instructions\n", len, result.executed);
+	return EXIT_SUCCESS;
+}
+
+#define BC_BENCH_RUNS			10000
+#define BC_TRACE_MAX			256
+
+enum { BC_OP_READ, BC_OP_WRITE, BC_OP_MODIFY, BC_OP_POLL, BC_OP_STEP };
+
+/* Register operations and steps of one interpreted run, in order */
+struct bc_trace {
+	struct bc_host_ctx *host;
+	unsigned int count;
+	struct {
+		unsigned int kind;
+		unsigned int offset;
+		uint32_t mask;
+		uint32_t value;
+	} op[BC_TRACE_MAX];
+};
+
+static void bc_trace_op(struct bc_trace *trace, unsigned int kind, unsigned int offset, uint32_t mask, uint32_t value)
+{
+	if (trace->count < BC_TRACE_MAX) {
+		trace->op[trace->count].kind = kind;
+		trace->op[trace->count].offset = offset;
+		trace->op[trace->count].mask = mask;
+		trace->op[trace->count].value = value;
+	}
+	trace->count++;
+}
+
+static void bc_trace_write(void *ctx, unsigned int offset, uint32_t value)
+{
+	struct bc_trace *trace = ctx;
+
+	bc_trace_op(trace, BC_OP_WRITE, offset, 0, value);
+	write_SNVS_reg(trace->host->mem, offset, value);
+}
+
+static void bc_trace_modify(void *ctx, unsigned int offset, uint32_t clear, uint32_t set)
+{
+	struct bc_trace *trace = ctx;
+
+	bc_trace_op(trace, BC_OP_MODIFY, offset, clear, set);
+	modify_SNVS_reg(trace->host->mem, offset, clear, set);
+}
+
+static void bc_trace_step(void *ctx, unsigned int step)
+{
+	struct bc_trace *trace = ctx;
+
+	bc_trace_op(trace, BC_OP_STEP, 0, 0, step);
+	bc_host_step(trace->host, step);
+}
+
+/* Run the program once through the resumable interpreter and record what it did */
+static int bc_trace_record(const uint8_t *code, size_t len, struct bc_trace *trace)
+{
+	struct snvs_bc_io io = { trace, bc_trace_write, bc_trace_step, bc_trace_modify };
+	struct snvs_bc_vm vm;
+	unsigned int wait;
+	uint32_t mask, value, timeout_us;
+
+	trace->count = 0;
+	snvs_bc_start(&vm, code, len);
+	while ((wait = snvs_bc_resume(&vm, &io)) != BC_WAIT_NONE) {
+		uint32_t reg = read_SNVS_reg(trace->host->mem, vm.offset);
+
+		//A poll met on this read replays as a spin, one that was not as a single read
+		if (wait == BC_WAIT_POLL)
+			snvs_bc_poll_args(&vm, &mask, &value, &timeout_us);
+		if (wait == BC_WAIT_POLL && (reg & mask) == value)
+			bc_trace_op(trace, BC_OP_POLL, vm.offset, mask, value);
+		else
+			bc_trace_op(trace, BC_OP_READ, vm.offset, 0, 0);
+		snvs_bc_feed(&vm, reg, 0);
+	}
+	return trace->count <= BC_TRACE_MAX && !vm.fail ? 0 : -1;
+}
+
+/* The recorded sequence as straight-line native code would issue it, no decoding or branching */
+static void bc_trace_replay(const struct bc_trace *trace)
+{
+	void *mem = trace->host->mem;
+	unsigned int i;
+
+	for (i = 0; i < trace->count; i++) {
+		switch (trace->op[i].kind) {
+		case BC_OP_READ:
+			read_SNVS_reg(mem, trace->op[i].offset);
 			break;
-		case 0xd:
-			printf ("[INFO] \t\t System Security Monitor is in Trusted mode\n");
+		case BC_OP_WRITE:
+			write_SNVS_reg(mem, trace->op[i].offset, trace->op[i].value);
 			break;
-		case 0xf:
-			printf ("[INFO] \t\t System Security Monitor is in Secure mode\n");
+		case BC_OP_MODIFY:
+			modify_SNVS_reg(mem, trace->op[i].offset, trace->op[i].mask, trace->op[i].value);
 			break;
-		default:
-			printf ("[ERROR] \t\t System Security Monitor is in an undefined mode. Possible to have a hw problem or a Secure-boot issue (check HAB events.\n");
-			return EXIT_FAILURE;
+		case BC_OP_POLL:
+			while ((read_SNVS_reg(mem, trace->op[i].offset) & trace->op[i].mask) != trace->op[i].value)
+				;
+			break;
+		case BC_OP_STEP:
+			bc_host_step(trace->host, trace->op[i].value);
+			break;
+		}
 	}
+}
 
-	//A.2. Set the correct value in the Power Glitch Detector Register
-	printf("[INFO] \t A.2. Set the correct value in the Power Glitch Detector Register.\n");
-	printf("[INFO] \t\t SNVS_LPPGDR power glitch before init 0x%x\n", *get_SNVS_reg(mem, SNVS_LPPGDR));
-	set_value_of_SNVS_reg(mem, SNVS_LPPGDR, POWER_GLITCH_VALUE);
-	printf("[INFO] \t\t SNVS_LPPGDR power glitch after init 0x%x\n", *get_SNVS_reg(mem, SNVS_LPPGDR));
+/* Boards both engines provision: fault-free ones and one per failure branch */
+struct bc_check {
+	const char *name;
+	int soft_locks;			//lock with SNVS_HPLR instead of the default
+	unsigned int master_key_sel;
+	unsigned int zmk_words;
+	unsigned int poke_offset;	//bits set before provisioning
+	uint32_t poke_mask;		//0 for none
+	int drop_zmk;			//the SNVS_LPZMKR0 write is lost
+	unsigned int fail;		//enum snvs_bc_fail expected
+};
 
-	//A.3. Clear the power glitch record in the LP Status Register
-	printf("[INFO] \t A.3. Clear the power glitch record in the LP Status Register.\n");
-	printf("[INFO] \t\t SNVS_LPSR  before init 0x%x\n", *get_SNVS_reg(mem, SNVS_LPSR));
-	set_value_of_SNVS_reg(mem, SNVS_LPSR, PGD_MASK);
-	printf("[INFO] \t\t SNVS_LPSR  after init 0x%x\n", *get_SNVS_reg(mem, SNVS_LPSR));
+static const struct bc_check bc_checks[] = {
+	{ "default configuration", 0, MASTER_KEY_SEL_VALUE, 1, 0, 0, 0, BC_FAIL_NONE },
+	{ "soft locks, 8 ZMK words, OTPMK xor ZMK", 1, 3, 8, 0, 0, 0, BC_FAIL_NONE },
+	{ "ZMK soft locked", 0, MASTER_KEY_SEL_VALUE, 1, SNVS_HPLR, ZMK_WSL_MASK, 0, BC_FAIL_LOCKED },
+	{ "ZMK hard locked", 0, MASTER_KEY_SEL_VALUE, 1, SNVS_LPLR, ZMK_WHL_MASK, 0, BC_FAIL_LOCKED },
+	{ "ZMK_HWP set", 0, MASTER_KEY_SEL_VALUE, 1, SNVS_LPMKCR, ZMK_HWP_MASK, 0, BC_FAIL_HWP },
+	{ "ZMK write lost", 0, MASTER_KEY_SEL_VALUE, 1, 0, 0, 1, BC_FAIL_VERIFY },
+};
 
-	//B.1. Verify that  ZMK_HWP bit is not set - using SNVS_LPMKCR[ZMK_HWP]
-	printf("[INFO] \t B.1. Verify that ZMK_HWP bit is not set - using SNVS_LPMKCR[ZMK_HWP]\n");
-	printf("[INFO] \t\t SNVS_LPMKCR before check ZMK_HWP 0x%x\n", *get_SNVS_reg(mem, SNVS_LPMKCR));
-	unsigned char ZMK_HWP_state = get_value_of_SNVS_reg_field(mem, SNVS_LPMKCR, ZMK_HWP_MASK, ZMK_HWP_OFFSET);
-	if (ZMK_HWP_state) {
-		printf("[ERROR] \t\t  SNVS_LPMKCR[ZMK_HWP] Zeroizable Master Key hardware Programming mode is set.  \
-		ZMK is in the hardware programming mode, cannot be programmed by software. See the ZMK hardware programming mechanism in Security RM.\n");
-		return EXIT_FAILURE;
+static void bc_check_board(void *mem, const struct bc_check *check, struct snvs_faults *faults)
+{
+	snvs_sim_power_on_reset(mem);
+	if (check->poke_mask)
+		snvs_sim_poke(mem, check->poke_offset, check->poke_mask, check->poke_mask);
+	if (check->drop_zmk) {
+		memset(faults, 0, sizeof(*faults));
+		faults->fault[0].kind = FAULT_DROP;
+		faults->fault[0].trigger = FAULT_AT_ACCESS;
+		faults->fault[0].offset = SNVS_LPZMKRn;
+		faults->fault[0].value = 1;
+		faults->count = 1;
+		snvs_faults_arm(faults);
+		snvs_faults = faults;
 	}
-	printf("[INFO] \t\t SNVS_LPMKCR[ZMK_HWP] Zeroizable Master Key hardware Programming mode is not set.\n");
+}
+
+/* Provision the board natively and with bytecode; both must stop the same way and leave the same registers */
+static int bc_check_run(void *mem, const struct bc_check *check)
+{
+	struct snvs_provision_config config = default_config;
+	struct snvs_regs native, interpreted;
+	uint8_t code[SNVS_BC_MAX];
+	struct snvs_bc_host host;
+	struct bc_host_ctx ctx;
+	struct snvs_bc_result result;
+	struct snvs_faults faults;
+	unsigned int i;
+
+	if (check->soft_locks)
+		config.hard_locks = !config.hard_locks;
+	config.master_key_sel = check->master_key_sel;
+	config.zmk_words = check->zmk_words;
+	for (i = 1; i < config.zmk_words; i++)
+		config.zmk[i] = ZMK_VALUE * (i + 1);
+
+	int len = snvs_bc_compile_provision(&config, code, sizeof(code));
+	if (len < 0)
+		return -1;
+	bc_host_init(&ctx, &host, mem, &config);
+
+	bc_check_board(mem, check, &faults);
+	int ret = snvs_provision(snvs, &config);
+	snvs_faults = NULL;
+	snvs_regs_read(snvs, &native);
 
-	//B.2. Verify that ZMK is not locked for write - using SNVS_HPLR, SNVS_LPLR registers
-	printf("[INFO] \t B.2. Verify that ZMK is not locked for write - using SNVS_HPLR, SNVS_LPLR registers\n");
+	bc_check_board(mem, check, &faults);
+	snvs_bc_run(code, len, mem, &host, &result);
+	snvs_faults = NULL;
+	snvs_regs_read(snvs, &interpreted);
 
-	printf("[INFO] \t\t SNVS_HPLR  before checking is 0x%x\n", *get_SNVS_reg(mem, SNVS_HPLR));
-	printf("[INFO] \t\t SNVS_LPLR  before checking is 0x%x\n", *get_SNVS_reg(mem, SNVS_LPLR));
+	//The SRTC is seeded from the wall clock, everything else must match register for register
+	native.lpsrtcmr = interpreted.lpsrtcmr;
+	native.lpsrtclr = interpreted.lpsrtclr;
 
-	unsigned char ZMK_WSL_state = get_value_of_SNVS_reg_field(mem, SNVS_HPLR, ZMK_WSL_MASK, ZMK_WSL_OFFSET);
-	unsigned char ZMK_RSL_state = get_value_of_SNVS_reg_field(mem, SNVS_HPLR, ZMK_RSL_MASK, ZMK_RSL_OFFSET);
-	unsigned char MKS_SL_state = get_value_of_SNVS_reg_field(mem, SNVS_HPLR, MKS_SL_MASK, MKS_SL_OFFSET);
+	if (ret != (check->fail ? -1 : 0) || result.fail != check->fail) {
+		printf("[ERROR] \t %s: native returned %d, bytecode stopped with %s, expected %s\n", check->name,
+			ret, snvs_bc_fail_name(result.fail), snvs_bc_fail_name(check->fail));
+		return -1;
+	}
+	//SNVS_LPGPR holds the step each engine recorded last, so this also compares the fail step
+	if (memcmp(&native, &interpreted, sizeof(native))) {
+		printf("[ERROR] \t %s: native and bytecode runs left different SNVS states\n", check->name);
+		return -1;
+	}
+	printf("[SUCCESS] \t %s: both %s, identical SNVS states\n", check->name,
+		check->fail ? snvs_bc_fail_name(check->fail) : "provisioned");
+	return 0;
+}
 
-	unsigned char MKS_HL_state = get_value_of_SNVS_reg_field(mem, SNVS_LPLR, MKS_HL_MASK, MKS_HL_OFFSET);
-	unsigned char ZMK_RHL_state = get_value_of_SNVS_reg_field(mem, SNVS_LPLR, ZMK_RHL_MASK, ZMK_RHL_OFFSET);
-	unsigned char ZMK_WHL_state = get_value_of_SNVS_reg_field(mem, SNVS_LPLR, ZMK_WHL_MASK, ZMK_WHL_OFFSET);
+static int bench_bc(int argc, char *argv[])
+{
+	long i, n = argc > 0 ? atol(argv[0]) : BC_BENCH_RUNS;
+	uint8_t code[SNVS_BC_MAX];
+	struct snvs_bc_host host;
+	struct bc_host_ctx ctx;
+	struct snvs_bc_result result;
+	static struct bc_trace trace;
+	struct timespec t0, t1;
+	double ns_replay = 0, ns_bc = 0;
+	unsigned int c, failed = 0;
 
-	if (ZMK_WSL_state || ZMK_RSL_state || MKS_SL_state) {
-		printf("[ERROR] \t\t SNVS_HPLR[ZMK_WSL,ZMK_RSL,MKS_SL] Zeroizable Master Write, Read, Select Soft Locks one of these bits are set - Write access is not allowed.\
-		Once set, these bits can only be cleared by system reset. \n");
+	if (!snvs_sim || snvs_backend) {
+		fprintf(stderr, "bc-bench: resets SNVS between runs, only with -s\n");
 		return EXIT_FAILURE;
 	}
+	if (n <= 0)
+		n = BC_BENCH_RUNS;
+
+	unsigned int *mem = map_SNVS();
+	if (!mem)
+		return EXIT_FAILURE;
 
-	printf("[INFO] \t\t SNVS_HPLR[ZMK_WSL,ZMK_RSL,MKS_SL] Zeroizable Master Write, Read, Select Soft Locks fields are not set.\n");
+	for (c = 0; c < sizeof(bc_checks) / sizeof(bc_checks[0]); c++)
+		if (bc_check_run(mem, &bc_checks[c]))
+			failed++;
+	if (failed)
+		return EXIT_FAILURE;
 
-	if (ZMK_WHL_state || ZMK_RHL_state || MKS_HL_state) {
-		printf("[ERROR] \t\t SNVS_LPLR[ZMK_WHL,ZMK_RHL,MKS_HL] Zeroizable Master Write, Read, Select Hard Locks one of these bits are set - Write access is not allowed.\
-		Once set, these bits can only be cleared by the LP LOR. \n");
+	int len = snvs_bc_compile_provision(&default_config, code, sizeof(code));
+	if (len < 0)
 		return EXIT_FAILURE;
+	bc_host_init(&ctx, &host, mem, &default_config);
+	trace.host = &ctx;
+	snvs_sim_power_on_reset(mem);
+	if (bc_trace_record(code, len, &trace)) {
+		printf("[ERROR] \t Bytecode run could not be recorded for replay\n");
+		return EXIT_FAILURE;
+	}
+
+	//Same register operations both ways, so the difference is decoding and dispatch
+	for (i = 0; i < n; i++) {
+		snvs_sim_power_on_reset(mem);
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		bc_trace_replay(&trace);
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		ns_replay += elapsed_ns(&t0, &t1);
+
+		snvs_sim_power_on_reset(mem);
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		snvs_bc_run(code, len, mem, &host, &result);
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		ns_bc += elapsed_ns(&t0, &t1);
+	}
+
+	printf("[INFO] \t %d byte program, %u instructions, %u register operations and steps\n",
+		len, result.executed, trace.count);
+	printf("[INFO] \t native replay %8.2f us/run\n", ns_replay / n / 1e3);
+	printf("[INFO] \t bytecode      %8.2f us/run (%+.1f ns dispatch per instruction)\n", ns_bc / n / 1e3,
+		(ns_bc - ns_replay) / n / result.executed);
+
+	return EXIT_SUCCESS;
+}
+
+#define ASYNC_BENCH_BOARDS		100
+#define ASYNC_BENCH_LATENCY_US		100
+
+/* Provision every board, one after the other or all in flight; returns the wall time in ns, or -1 */
+static double async_round(struct snvs_async *loop, struct snvs_async_board *boards, unsigned int **pages,
+	long n, unsigned int transport, int serial)
+{
+	struct timespec t0, t1;
+	long i;
+
+	loop->peak = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < n; i++) {
+		if (pages)
+			snvs_sim_power_on_reset(pages[i]);
+		if (snvs_async_add(loop, &boards[i], transport, pages ? pages[i] : NULL)) {
+			perror("async-bench");
+			return -1;
+		}
+		while (serial && loop->running)
+			if (snvs_async_dispatch(loop, -1) < 0)
+				return -1;
+	}
+	while (loop->running)
+		if (snvs_async_dispatch(loop, -1) < 0)
+			return -1;
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	for (i = 0; i < n; i++) {
+		if (boards[i].vm.fail == BC_FAIL_NONE)
+			continue;
+		printf("[ERROR] \t Board %ld stopped after step %u: %s\n", i, boards[i].step,
+			boards[i].error ? strerror(boards[i].error) : snvs_bc_fail_name(boards[i].vm.fail));
+		return -1;
 	}
+	for (i = 0; i < n; i++) {
+		if (boards[i].zeroized)
+			continue;
+		printf("[ERROR] \t Board %ld: SNVS_LPZMKRn not zeroized when the B.8 poll timed out\n", i);
+		return -1;
+	}
+	return elapsed_ns(&t0, &t1);
+}
 
-	printf("[INFO] \t\t SNVS_LPLR[ZMK_WHL,ZMK_RHL,MKS_HL] Zeroizable Master Write, Read, Select Hard Locks fields are not set.\n");
-	printf("[INFO] \t\t SNVS_LPLR[MKS_HL] Master Key Select Hard Lock is not set.\n");
-	printf("[INFO] \t\t SNVS_LPLR[ZMK_RHL] Zeroizable Master Key Read Hard Lock is not set.\n");
-	printf("[INFO] \t B.3. Write key value to the ZMK registers.\n");
-	printf("[INFO] \t\t The ZMK key value before writing with 0x%x is 0x%x \n", ZMK_VALUE, *get_SNVS_reg(mem, SNVS_LPZMKRn));
+static void async_report(const char *name, const struct snvs_async *loop, const struct snvs_async_board *boards,
+	long n, double ns)
+{
+	unsigned long round_trips = 0, suspensions = 0;
+	double board_us = 0;
+	long i;
+
+	for (i = 0; i < n; i++) {
+		round_trips += boards[i].round_trips;
+		suspensions += boards[i].suspensions;
+		board_us += boards[i].end_us - boards[i].start_us;
+	}
+	printf("[INFO] \t %-10s %9.2f ms %9.0f boards/s, %.1f round trips and %.1f suspensions per board, %.0f us per board, peak %u in flight\n",
+		name, ns / 1e6, n / (ns / 1e9), (double)round_trips / n, (double)suspensions / n, board_us / n, loop->peak);
+}
 
-	set_value_of_SNVS_reg(mem, SNVS_LPZMKRn, ZMK_VALUE);
+static int bench_async(int argc, char *argv[])
+{
+	long i, n = argc > 0 ? atol(argv[0]) : ASYNC_BENCH_BOARDS;
+	unsigned int transport = argc > 2 && !strcmp(argv[2], "page") ? SNVS_ASYNC_PAGE : SNVS_ASYNC_MU;
+	struct snvs_async_board *boards;
+	struct snvs_async loop;
+	unsigned int **pages = NULL;
+	int ret = EXIT_FAILURE;
 
-	printf("[INFO] \t B.4. Verify that the correct key value is written.\n");
-	if (*get_SNVS_reg(mem, SNVS_LPZMKRn) != ZMK_VALUE) {
-		printf("[ERROR] \t\t The new ZMK key value 0x%x is not matching with the user desire value!!! \n", *get_SNVS_reg(mem, SNVS_LPZMKRn));
+	if (n <= 0)
+		n = ASYNC_BENCH_BOARDS;
+	snvs_mu_latency_us = argc > 1 ? (unsigned int)atoi(argv[1]) : ASYNC_BENCH_LATENCY_US;
+	if (transport == SNVS_ASYNC_PAGE && !snvs_sim) {
+		fprintf(stderr, "async-bench: page boards are simulator instances, only with -s\n");
+		return EXIT_FAILURE;
+	}
+	if (getenv("ZMK_SIM_STATE")) {
+		fprintf(stderr, "async-bench: every board needs its own simulator, unset ZMK_SIM_STATE\n");
 		return EXIT_FAILURE;
 	}
-	printf("[SUCCESS] \t\t The new ZMK key value is = 0x%x and matches with the user desired value.\n", *get_SNVS_reg(mem, SNVS_LPZMKRn));
 
-	printf("[INFO] \t B.5. Set SNVS_LPMKCR[ZMK_VAL] bit if the ZMK (or the ZMK XORed with the OTPMK) will be used by CAAM as the master key.\n");
+	boards = calloc(n, sizeof(*boards));
+	if (transport == SNVS_ASYNC_PAGE)
+		pages = calloc(n, sizeof(*pages));
+	if (!boards || (transport == SNVS_ASYNC_PAGE && !pages)) {
+		perror("async-bench");
+		goto out;
+	}
+	for (i = 0; pages && i < n; i++) {
+		pages[i] = snvs_sim_map();
+		if (!pages[i]) {
+			perror("snvs_sim_map");
+			goto out;
+		}
+	}
 
-	printf("[INFO] \t\t SNVS_LPMKCR  before init 0x%x\n", *get_SNVS_reg(mem, SNVS_LPMKCR));
-	set_value_of_SNVS_reg(mem, SNVS_LPMKCR, ZMK_VAL_MASK);
-	printf("[INFO] \t\t SNVS_LPMKCR  after init 0x%x\n", *get_SNVS_reg(mem, SNVS_LPMKCR));
+	if (snvs_async_init(&loop, &default_config)) {
+		perror("async-bench");
+		goto out;
+	}
+	if (transport == SNVS_ASYNC_PAGE)
+		printf("[INFO] \t %ld boards over mapped pages, %zu byte program\n", n, loop.len);
+	else
+		printf("[INFO] \t %ld boards over messaging unit stand-ins, %u us controller latency, %zu byte program\n",
+			n, snvs_mu_latency_us, loop.len);
 
-	printf("[INFO] \t B.6 (optional) Set SNVS_LPMKCR[ZMK_ECC_EN] bit to enable ZMK error correction code verification. \
-								\n\t Software can verify that the correct nine bit codeword is generated by reading ZMK_ECC_VALUE field.\n");
-	set_value_of_SNVS_reg(mem, SNVS_LPMKCR, ZMK_ECC_EN);
+	double ns_serial = async_round(&loop, boards, pages, n, transport, 1);
+	if (ns_serial < 0)
+		goto close;
+	async_report("serial", &loop, boards, n, ns_serial);
 
-	printf("[INFO] \t B.7 (optional) Block software read accesses to the ZMK registers and ZMK_ECC_VALUE field by setting ZMK Read lock bit.\n");
-	printf("[INFO] \t B.8 (optional) Block software write accesses to the ZMK registers by setting ZMK Write Lock bit.\n");
+	double ns_async = async_round(&loop, boards, pages, n, transport, 0);
+	if (ns_async < 0)
+		goto close;
+	async_report("concurrent", &loop, boards, n, ns_async);
 
-	if (RESET == POR) {
-		//POR to clear next bits
-		set_value_of_SNVS_reg(mem, SNVS_LPLR, ZMK_RHL_MASK);
-		set_value_of_SNVS_reg(mem, SNVS_LPLR, ZMK_WHL_MASK);
-	} else {
-		//system reset to clear next bits
-		set_value_of_SNVS_reg(mem, SNVS_HPLR, ZMK_RSL_MASK);
-		set_value_of_SNVS_reg(mem, SNVS_HPLR, ZMK_WSL_MASK);
+	printf("[SUCCESS] \t %ld boards provisioned in both rounds, concurrent is %.1fx faster\n", n, ns_serial / ns_async);
+	ret = EXIT_SUCCESS;
+close:
+	snvs_async_close(&loop);
+out:
+	for (i = 0; pages && i < n && pages[i]; i++)
+		munmap(pages[i], 2 * SNVS_PAGE_SIZE);
+	free(pages);
+	free(boards);
+	return ret;
+}
+
+//Timing model of fault campaigns run without ZMK_SIM_TIMING: polls and delays need a simulated clock
+#define FAULT_HP_READ_NS		100
+#define FAULT_LP_READ_NS		300
+#define FAULT_WRITE_NS			400
+#define FAULT_ZEROIZE_NS		2000
+
+static struct snvs_timing fault_timing;
+
+static void fault_timing_default(void)
+{
+	unsigned int i;
+
+	if (snvs_sim_timed())
+		return;
+	for (i = 0; i < SNVS_TIMING_REGS; i++) {
+		fault_timing.read_ns[i] = snvs_lp_register(4 * i) ? FAULT_LP_READ_NS : FAULT_HP_READ_NS;
+		fault_timing.write_ns[i] = FAULT_WRITE_NS;
 	}
+	fault_timing.zeroize_ns = FAULT_ZEROIZE_NS;
+	snvs_sim_set_timing(&fault_timing);
+}
 
-	//Let some time for SNVS_LPZMKRn to be cleared after ZMK_RHL was set
-	#define TIMEOUT_MAX_VAL 0x1000
-	volatile int i;
-	for (i = 0; i < TIMEOUT_MAX_VAL; i++) {}
+static int inject_faults(int argc, char *argv[])
+{
+	struct snvs_provision_config config = default_config;
+	struct snvs_scenario_result result;
+	struct snvs_faults faults;
+	char spec[SNVS_FAULT_SPEC_MAX];
+	unsigned int i;
 
-	printf("[INFO] \t\t [SECURITY_CHECK] if SNVS_LPZMKRn is zero'd after ZMK_RHL was set\n");
-	if (*get_SNVS_reg(mem, SNVS_LPZMKRn) == 0x0) {
-		printf("[INFO] \t\t [PASSED] - SNVS_LPZMKRn is 0x0 and cannot be read by a hacker\n");
-	} else {
-		printf("[INFO] \t\t [FAILED] - SNVS_LPZMKRn is 0x%x and can be read by a hacker. Try to increase the TIMEOUT_MAX_VAL\n", *get_SNVS_reg(mem, SNVS_LPZMKRn));
+	if (!snvs_sim || snvs_backend) {
+		fprintf(stderr, "fault: faults go into the local simulator, only with -s\n");
+		return EXIT_FAILURE;
+	}
+	if (argc > SNVS_FAULT_MAX) {
+		fprintf(stderr, "fault: at most %d faults per scenario\n", SNVS_FAULT_MAX);
+		return EXIT_FAILURE;
 	}
+	memset(&faults, 0, sizeof(faults));
+	for (i = 0; i < (unsigned int)argc; i++)
+		if (snvs_fault_parse(argv[i], &faults.fault[i]))
+			return EXIT_FAILURE;
+	faults.count = argc;
 
-	printf("[INFO] \t B.9. Set SNVS_LPMKCR[MASTER_KEY_SEL] and SNVS_HPCOMR[MKS_EN] bits to select combination of OTPMK and ZMK to be provided to the hardware cryptographic module.\n");
-	printf("[INFO] \t\t For our example MASTER_KEY_SEL is set as 0b10 - Select zeroizable master key when MKS_EN bit is set.\n");
-	set_value_of_SNVS_reg(mem, SNVS_LPMKCR, MASTER_KEY_SEL_VALUE);
-	printf("[INFO] \t\t SNVS_LPMKCR  after init 0x%x\n", *get_SNVS_reg(mem, SNVS_LPMKCR));
+	if (!map_SNVS())
+		return EXIT_FAILURE;
+	fault_timing_default();
 
-	printf("[INFO] \t\t SNVS_HPCOMR  before init 0x%x\n", *get_SNVS_reg(mem, SNVS_HPCOMR));
-	set_value_of_SNVS_reg(mem, SNVS_HPCOMR, MKS_EN_MASK);
-	printf("[INFO] \t\t SNVS_HPCOMR  after init 0x%x\n", *get_SNVS_reg(mem, SNVS_HPCOMR));
+	config.log = stdout;
+	snvs_scenario_run(snvs, &config, &faults, &result);
 
-	printf("[INFO] \t B.10 (optional) Block software write accesses to the MASTER_KEY_SEL field by setting MKS lock bit.\n");
+	printf("\n");
+	for (i = 0; i < faults.count; i++) {
+		snvs_fault_format(&faults.fault[i], spec, sizeof(spec));
+		printf("[INFO] \t Fault %s %s\n", spec, faults.fired & (1U << i) ? "fired" : "did not fire");
+	}
+	printf("[INFO] \t Outcome: %s after %llu register accesses%s%s\n", snvs_outcome_name(result.outcome),
+		(unsigned long long)result.accesses, result.problem ? ", " : "", result.problem ? result.problem : "");
 
-	if (RESET == POR) {
-		//POR to clear next bit
-		set_value_of_SNVS_reg(mem, SNVS_LPLR, MKS_HL_MASK);
+	if (result.recovery == RECOVERY_NONE) {
+		printf("[SUCCESS] \t The board is correct, no recovery needed\n");
+	} else if (result.recovery == RECOVERY_FAILED) {
+		printf("[ERROR] \t The board did not recover, not even after a power-on reset\n");
+		return EXIT_FAILURE;
 	} else {
-		//system reset to clear next bit
-		set_value_of_SNVS_reg(mem, SNVS_HPLR, MKS_SL_MASK);
+		printf("[SUCCESS] \t Recovered by %s, %.1f us of board time after the first fault\n",
+			snvs_recovery_name(result.recovery), result.recovery_ns / 1e3);
+	}
+
+	return result.outcome == OUTCOME_SILENT ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#define FAULT_BENCH_SCENARIOS		100000
+#define FAULT_BENCH_SHOW		5
+
+struct fault_row {
+	unsigned long scenarios;
+	unsigned long outcome[OUTCOMES];
+	unsigned long recovery[RECOVERIES];
+	double recovery_ns;
+	uint64_t max_ns;
+};
+
+static int bench_faults(int argc, char *argv[])
+{
+	long i, n = argc > 0 ? atol(argv[0]) : FAULT_BENCH_SCENARIOS;
+	uint64_t seed = argc > 1 ? strtoull(argv[1], NULL, 0) : 1;
+	unsigned int per = argc > 2 ? (unsigned int)atoi(argv[2]) : 1;
+	struct fault_row rows[FAULT_KINDS + 1];
+	struct snvs_scenario_result result;
+	struct snvs_faults faults;
+	struct timespec t0, t1;
+	char spec[SNVS_FAULT_SPEC_MAX];
+	unsigned int j, k, shown = 0;
+
+	if (!snvs_sim || snvs_backend) {
+		fprintf(stderr, "fault-bench: faults go into the local simulator, only with -s\n");
+		return EXIT_FAILURE;
+	}
+	if (n <= 0)
+		n = FAULT_BENCH_SCENARIOS;
+	if (per < 1 || per > SNVS_FAULT_MAX)
+		per = 1;
+	seed |= 1;
+
+	if (!map_SNVS())
+		return EXIT_FAILURE;
+	fault_timing_default();
+
+	//The fault free run sets the range of access triggers
+	memset(&faults, 0, sizeof(faults));
+	snvs_scenario_run(snvs, &default_config, &faults, &result);
+	if (result.outcome != OUTCOME_MASKED) {
+		printf("[ERROR] \t Provisioning fails without faults: %s\n", result.problem ? result.problem : "error");
+		return EXIT_FAILURE;
+	}
+	unsigned int accesses = result.accesses;
+	printf("[INFO] \t %ld scenarios of %u fault%s, seed 0x%llx; a fault free run makes %u register accesses\n",
+		n, per, per > 1 ? "s" : "", (unsigned long long)seed, accesses);
+
+	memset(rows, 0, sizeof(rows));
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < n; i++) {
+		faults.count = per;
+		for (j = 0; j < per; j++)
+			snvs_fault_random(&faults.fault[j], &seed, accesses);
+		snvs_scenario_run(snvs, &default_config, &faults, &result);
+
+		//A scenario counts for the kind of its first fault that fired
+		for (k = 0; k < per && !(faults.fired & (1U << k)); k++)
+			;
+		struct fault_row *row = &rows[k < per ? faults.fault[k].kind : FAULT_KINDS];
+
+		row->scenarios++;
+		row->outcome[result.outcome]++;
+		row->recovery[result.recovery]++;
+		if (result.recovery != RECOVERY_NONE && result.recovery != RECOVERY_FAILED) {
+			row->recovery_ns += result.recovery_ns;
+			if (result.recovery_ns > row->max_ns)
+				row->max_ns = result.recovery_ns;
+		}
+
+		if (result.outcome == OUTCOME_SILENT && shown < FAULT_BENCH_SHOW) {
+			if (!shown++)
+				printf("[INFO] \t Silent failures, replay with ./zmk -s fault SPEC...\n");
+			printf("[INFO] \t\t");
+			for (j = 0; j < per; j++) {
+				snvs_fault_format(&faults.fault[j], spec, sizeof(spec));
+				printf(" %s", spec);
+			}
+			printf("  (%s)\n", result.problem);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	printf("[INFO] \t %-8s %9s %9s %9s %9s %9s %9s %9s %9s %10s %10s\n", "fault", "scenarios", "masked",
+		"detected", "silent", "retry", "sys reset", "POR", "failed", "mean us", "max us");
+	for (k = 0; k <= FAULT_KINDS; k++) {
+		const struct fault_row *row = &rows[k];
+		unsigned long recovered = row->recovery[RECOVERY_RETRY] + row->recovery[RECOVERY_SYSTEM_RESET] + row->recovery[RECOVERY_POR];
+
+		if (!row->scenarios)
+			continue;
+		printf("[INFO] \t %-8s %9lu %9lu %9lu %9lu %9lu %9lu %9lu %9lu %10.1f %10.1f\n",
+			k < FAULT_KINDS ? snvs_fault_kind_name(k) : "unfired", row->scenarios,
+			row->outcome[OUTCOME_MASKED], row->outcome[OUTCOME_DETECTED], row->outcome[OUTCOME_SILENT],
+			row->recovery[RECOVERY_RETRY], row->recovery[RECOVERY_SYSTEM_RESET], row->recovery[RECOVERY_POR],
+			row->recovery[RECOVERY_FAILED], recovered ? row->recovery_ns / recovered / 1e3 : 0, row->max_ns / 1e3);
+	}
+
+	double s = elapsed_ns(&t0, &t1) / 1e9;
+	printf("[SUCCESS] \t %ld scenarios in %.2f s (%.0f scenarios/s)\n", n, s, n / s);
+	return EXIT_SUCCESS;
+}
+
+static int show_mc(int argc, char *argv[])
+{
+	unsigned int *mem = map_SNVS();
+	if (!mem)
+		return EXIT_FAILURE;
+
+	uint64_t value;
+	unsigned int era;
+	if (read_SNVS_mc(mem, &value, &era)) {
+		printf("[ERROR] \t SNVS_LPSMCMR/SNVS_LPSMCLR did not settle after %d reads.\n", MC_READ_RETRIES);
+		return EXIT_FAILURE;
+	}
+
+	printf("[INFO] \t SNVS_LPCR[MC_ENV] = %d, SNVS_LPLR[MC_HL] = %d, SNVS_HPLR[MC_SL] = %d, SNVS_LPSR[MCR] = %d\n",
+		get_value_of_SNVS_reg_field(mem, SNVS_LPCR, MC_ENV_MASK, MC_ENV_OFFSET),
+		get_value_of_SNVS_reg_field(mem, SNVS_LPLR, MC_HL_MASK, MC_HL_OFFSET),
+		get_value_of_SNVS_reg_field(mem, SNVS_HPLR, MC_SL_MASK, MC_SL_OFFSET),
+		!!(read_SNVS_reg(mem, SNVS_LPSR) & MCR_MASK));
+	printf("[INFO] \t Monotonic counter = 0x%012llx (era 0x%x)\n", (unsigned long long)value, era);
+
+	return EXIT_SUCCESS;
+}
+
+/* The tool enables the counter if it is off; the library leaves that decision to its caller */
+static int open_mc(struct snvs_mc *mc, unsigned int *mem)
+{
+	if (!snvs_mc_init(mc, mem, SNVS_MC_ENABLE))
+		return 0;
+	if (errno == EPERM)
+		printf("[ERROR] \t SNVS_LPLR[MC_HL] or SNVS_HPLR[MC_SL] is set - the monotonic counter cannot be incremented.\n");
+	else if (errno == ENODEV)
+		printf("[ERROR] \t SNVS_LPCR[MC_ENV] cannot be set - the monotonic counter is disabled.\n");
+	else
+		printf("[ERROR] \t SNVS_LPSMCMR/SNVS_LPSMCLR did not settle after %d reads.\n", MC_READ_RETRIES);
+	return -1;
+}
+
+static int increment_mc(int argc, char *argv[])
+{
+	struct snvs_mc mc;
+	uint64_t value;
+
+	unsigned int *mem = map_SNVS();
+	if (!mem || open_mc(&mc, mem))
+		return EXIT_FAILURE;
+
+	printf("[INFO] \t Monotonic counter before increment = 0x%012llx\n", (unsigned long long)mc.value);
+	if (snvs_mc_increment(&mc, &value)) {
+		printf("[ERROR] \t The monotonic counter did not advance.\n");
+		return EXIT_FAILURE;
 	}
+	printf("[SUCCESS] \t Monotonic counter after increment  = 0x%012llx\n", (unsigned long long)value);
+	snvs_mc_destroy(&mc);
 
 	return EXIT_SUCCESS;
 }
+
+#define MC_BENCH_THREADS		8
+#define MC_BENCH_REQUESTS		10000
+#define MC_BENCH_LATENCY_US		50
+
+struct mc_bench_worker {
+	pthread_t thread;
+	struct snvs_mc *mc;
+	long requests;
+	long failed;
+};
+
+static void *mc_bench_worker(void *arg)
+{
+	struct mc_bench_worker *w = arg;
+	uint64_t value;
+	long i;
+
+	for (i = 0; i < w->requests; i++)
+		if (snvs_mc_increment(w->mc, &value))
+			w->failed++;
+
+	return NULL;
+}
+
+static int bench_mc(int argc, char *argv[])
+{
+	int i, threads = argc > 0 ? atoi(argv[0]) : MC_BENCH_THREADS;
+	long requests = argc > 1 ? atol(argv[1]) : MC_BENCH_REQUESTS;
+	int latency_us = argc > 2 ? atoi(argv[2]) : MC_BENCH_LATENCY_US;
+	struct mc_bench_worker *workers;
+	struct timespec t0, t1;
+	struct snvs_mc mc;
+	uint64_t start, end;
+	long failed = 0;
+	int ret = EXIT_SUCCESS;
+
+	if (threads <= 0)
+		threads = MC_BENCH_THREADS;
+	if (requests <= 0)
+		requests = MC_BENCH_REQUESTS;
+
+	//The simulated counter increments at once; give it the board's LP write latency
+	int simulated = snvs_sim && !snvs_backend && latency_us > 0;
+	if (simulated)
+		snvs_sim_mc_latency_us = latency_us;
+	else if (snvs_sim && latency_us > 0 && argc > 2)
+		printf("[INFO] \t The increment latency applies to the local simulator only\n");
+
+	unsigned int *mem = map_SNVS();
+	if (!mem || open_mc(&mc, mem))
+		return EXIT_FAILURE;
+	start = mc.value;
+
+	workers = calloc(threads, sizeof(*workers));
+	if (!workers)
+		return EXIT_FAILURE;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < threads; i++) {
+		workers[i].mc = &mc;
+		workers[i].requests = requests;
+		pthread_create(&workers[i].thread, NULL, mc_bench_worker, &workers[i]);
+	}
+	for (i = 0; i < threads; i++) {
+		pthread_join(workers[i].thread, NULL);
+		failed += workers[i].failed;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	double s = elapsed_ns(&t0, &t1) / 1e9;
+	long total = threads * requests;
+	read_SNVS_mc(mem, &end, NULL);
+
+	double ratio = (double)total / mc.hw_increments;
+	snvs_sim_mc_latency_us = 0;
+
+	printf("[INFO] \t %d threads x %ld increment requests in %.3f s", threads, total / threads, s);
+	if (simulated)
+		printf(", %d us per simulated increment", latency_us);
+	printf("\n");
+	printf("[INFO] \t %.0f requests/s, %llu hardware increments (%.1f requests per increment), %ld failed\n",
+		total / s, (unsigned long long)mc.hw_increments, ratio, failed);
+	printf("[INFO] \t counter advanced by %llu\n", (unsigned long long)(end - start));
+
+	if (failed || end - start != mc.hw_increments) {
+		printf("[ERROR] \t Requests failed or the counter does not match the hardware increments\n");
+		ret = EXIT_FAILURE;
+	} else if (threads > 1 && (!snvs_sim || simulated)) {
+		//Increments that take time must be shared by the threads waiting on them
+		if (ratio > 1) {
+			printf("[SUCCESS] \t Coalescing served %.1f requests per hardware increment\n", ratio);
+		} else {
+			printf("[ERROR] \t No requests were coalesced\n");
+			ret = EXIT_FAILURE;
+		}
+	}
+
+	free(workers);
+	snvs_mc_destroy(&mc);
+
+	return ret;
+}
+
+#define RMW_BENCH_WORKERS		4
+#define RMW_BENCH_UPDATES		100000
+
+struct rmw_bench_worker {
+	pthread_t thread;
+	unsigned int *mem;
+	uint32_t bit;
+	long updates;
+};
+
+static void *rmw_bench_worker(void *arg)
+{
+	struct rmw_bench_worker *w = arg;
+	long i;
+
+	//Every worker owns one bit of SNVS_LPGPR; the bits of the others have to survive its updates
+	for (i = 0; i < w->updates; i++) {
+		modify_SNVS_reg(w->mem, SNVS_LPGPR, 0, w->bit);
+		modify_SNVS_reg(w->mem, SNVS_LPGPR, w->bit, 0);
+	}
+	modify_SNVS_reg(w->mem, SNVS_LPGPR, 0, w->bit);
+	return NULL;
+}
+
+/* One round of the benchmark; returns ns per update */
+static double rmw_bench_round(struct rmw_bench_worker *workers, int count, int procs, struct snvs_sim_rmw_stats *stats)
+{
+	unsigned int *mem = workers[0].mem;
+	struct timespec t0, t1;
+	int i;
+
+	write_SNVS_reg(mem, SNVS_LPGPR, 0);
+	snvs_sim_rmw_stats(mem, stats, 1);
+	fflush(stdout);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < count; i++) {
+		if (!procs) {
+			pthread_create(&workers[i].thread, NULL, rmw_bench_worker, &workers[i]);
+			continue;
+		}
+		//The simulated page is a shared mapping, so forked workers update the same SNVS
+		pid_t pid = fork();
+		if (pid == 0) {
+			rmw_bench_worker(&workers[i]);
+			_exit(0);
+		}
+	}
+	for (i = 0; i < count; i++) {
+		if (procs)
+			wait(NULL);
+		else
+			pthread_join(workers[i].thread, NULL);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	snvs_sim_rmw_stats(mem, stats, 1);
+	return elapsed_ns(&t0, &t1) / (count * (2 * workers[0].updates + 1));
+}
+
+static int bench_rmw(int argc, char *argv[])
+{
+	int i, count = argc > 0 ? atoi(argv[0]) : RMW_BENCH_WORKERS;
+	long updates = argc > 1 ? atol(argv[1]) : RMW_BENCH_UPDATES;
+	int procs = argc > 2 && !strcmp(argv[2], "procs");
+	struct rmw_bench_worker workers[32];
+	struct snvs_sim_rmw_stats stats;
+	double ns[2];
+	int ret = EXIT_SUCCESS;
+
+	if (count <= 0 || count > 32)
+		count = RMW_BENCH_WORKERS;
+	if (updates <= 0)
+		updates = RMW_BENCH_UPDATES;
+
+	unsigned int *mem = map_SNVS();
+	if (!mem)
+		return EXIT_FAILURE;
+	if (!snvs_sim || snvs_backend) {
+		printf("[ERROR] \t rmw-bench needs the local simulator (-s)\n");
+		return EXIT_FAILURE;
+	}
+
+	uint32_t saved = read_SNVS_reg(mem, SNVS_LPGPR), expected = count == 32 ? ~0U : (1U << count) - 1;
+	int saved_atomic = snvs_atomic;
+
+	for (i = 0; i < count; i++) {
+		workers[i].mem = mem;
+		workers[i].bit = 1U << i;
+		workers[i].updates = updates;
+	}
+	printf("[INFO] \t %d %s x %ld set/clear pairs on SNVS_LPGPR\n", count, procs ? "processes" : "threads", updates);
+
+	for (snvs_atomic = 0; snvs_atomic < 2; snvs_atomic++) {
+		ns[snvs_atomic] = rmw_bench_round(workers, count, procs, &stats);
+
+		uint32_t final = read_SNVS_reg(mem, SNVS_LPGPR);
+
+		printf("[INFO] \t %-12s %8.1f ns per update, %llu of %llu updates lost, final SNVS_LPGPR 0x%x", snvs_atomic ?
+			"atomic" : "unprotected", ns[snvs_atomic], (unsigned long long)stats.lost, (unsigned long long)stats.rmw, final);
+		if (stats.lost)
+			printf(" (last: 0x%x at 0x%x)", stats.last_bits, stats.last_offset);
+		printf("\n");
+		if (snvs_atomic && (stats.lost || final != expected))
+			ret = EXIT_FAILURE;
+	}
+	snvs_atomic = saved_atomic;
+	write_SNVS_reg(mem, SNVS_LPGPR, saved);
+
+	if (ret)
+		printf("[ERROR] \t Atomic updates lost bits\n");
+	else
+		printf("[SUCCESS] \t Atomic updates lost nothing, at %.2fx the cost of unprotected ones\n", ns[1] / ns[0]);
+
+	return ret;
+}
+
+static int show_gpr(int argc, char *argv[])
+{
+	struct snvs_gpr_record rec;
+	unsigned int i;
+
+	unsigned int *mem = map_SNVS();
+	if (!mem)
+		return EXIT_FAILURE;
+
+	printf("[INFO] \t SNVS_LPGPR = 0x%x\n", read_SNVS_reg(mem, SNVS_LPGPR));
+	if (snvs_gpr_load(mem, &rec)) {
+		printf("[INFO] \t No valid provisioning record (CRC mismatch)\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("[INFO] \t Provisioning record: step %s, policy 0x%x (%s locks, MASTER_KEY_SEL 0x%x), key fingerprint ",
+		snvs_step_name(rec.step), rec.policy, rec.policy & GPR_POLICY_HARD_LOCKS ? "hard" : "soft",
+		(rec.policy & GPR_POLICY_MKS_MASK) >> GPR_POLICY_MKS_OFFSET);
+	for (i = 0; i < SNVS_GPR_FP_BYTES; i++)
+		printf("%02x", rec.fingerprint[i]);
+	printf("\n");
+
+	return EXIT_SUCCESS;
+}
+
+static int show_tamper(int argc, char *argv[])
+{
+	unsigned int *mem = map_SNVS();
+	if (!mem)
+		return EXIT_FAILURE;
+
+	printf("[INFO] \t SNVS_HPSVCR = 0x%x, SNVS_LPSVCR = 0x%x, SNVS_LPTDCR = 0x%x\n",
+		read_SNVS_reg(mem, SNVS_HPSVCR), read_SNVS_reg(mem, SNVS_LPSVCR), read_SNVS_reg(mem, SNVS_LPTDCR));
+	printf("[INFO] \t SNVS_HPSVSR = 0x%x, SNVS_LPSR = 0x%x\n", read_SNVS_reg(mem, SNVS_HPSVSR), read_SNVS_reg(mem, SNVS_LPSR));
+	if (!print_tamper_events(mem))
+		printf("[INFO] \t\t No security violation or tamper event recorded.\n");
+
+	return EXIT_SUCCESS;
+}
+
+static int apply_tamper(int argc, char *argv[])
+{
+	struct snvs_tamper_result tamper;
+
+	unsigned int *mem = map_SNVS();
+	if (!mem)
+		return EXIT_FAILURE;
+
+	if (snvs_tamper_apply(mem, snvs_default_tamper_policy, snvs_default_tamper_policy_len, &tamper)) {
+		printf("[ERROR] \t Register 0x%x did not accept the security violation / tamper policy.\n", tamper.failed_reg);
+		return EXIT_FAILURE;
+	}
+	printf("[SUCCESS] \t Policy applied with %u register reads and %u writes\n", tamper.reads, tamper.writes);
+
+	return EXIT_SUCCESS;
+}
+
+static void print_key(const char *label, const uint8_t *key)
+{
+	unsigned int i;
+
+	printf("[INFO] \t\t %-14s ", label);
+	for (i = 0; i < MASTER_KEY_BYTES; i++)
+		printf("%02x", key[i]);
+	printf("\n");
+}
+
+static int show_mkey(int argc, char *argv[])
+{
+	uint8_t otpmk[MASTER_KEY_BYTES], zmk[MASTER_KEY_BYTES], key[MASTER_KEY_BYTES];
+
+	unsigned int *mem = map_SNVS();
+	if (!mem)
+		return EXIT_FAILURE;
+
+	uint32_t lpmkcr = read_SNVS_reg(mem, SNVS_LPMKCR);
+	uint32_t hpcomr = read_SNVS_reg(mem, SNVS_HPCOMR);
+	enum snvs_mkey_source source = snvs_mkey_select(lpmkcr, hpcomr);
+
+	printf("[INFO] \t SNVS_LPMKCR = 0x%x, SNVS_HPCOMR = 0x%x\n", lpmkcr, hpcomr);
+	printf("[INFO] \t CAAM master key: %s\n", snvs_mkey_source_name(source));
+
+	//Only the simulator can expose the key inputs
+	if (snvs_sim) {
+		snvs_sim_keys(mem, otpmk, zmk);
+		print_key("OTPMK", otpmk);
+		print_key("ZMK", zmk);
+		if (!snvs_mkey_effective(lpmkcr, hpcomr, otpmk, zmk, key))
+			print_key("effective key", key);
+	}
+
+	return source == MKEY_INVALID ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static int rotate_ZMK(int argc, char *argv[])
+{
+	struct snvs_rotate_config config = { .log = stdout };
+	struct snvs_rotate_result result;
+	char *end;
+
+	for (; argc && argv[0][0] == '-'; argc--, argv++) {
+		if (!strcmp(argv[0], "-n"))
+			config.dry_run = 1;
+		else if (!strcmp(argv[0], "-l"))
+			config.soft_lock = 1;
+		else
+			break;
+	}
+	if (!argc || argc > (int)ARRAY_SIZE(config.zmk)) {
+		fprintf(stderr, "rotate: give 1 to %zu ZMK words\n", ARRAY_SIZE(config.zmk));
+		return EXIT_FAILURE;
+	}
+	for (config.zmk_words = 0; config.zmk_words < (unsigned int)argc; config.zmk_words++) {
+		config.zmk[config.zmk_words] = strtoul(argv[config.zmk_words], &end, 16);
+		if (*end) {
+			fprintf(stderr, "rotate: '%s' is not a hex word\n", argv[config.zmk_words]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	unsigned int *mem = map_SNVS();
+	if (!mem)
+		return EXIT_FAILURE;
+
+	uint64_t start = snvs_sim_timed() ? snvs_sim_clock(mem) : 0;
+	int ret = snvs_rotate(snvs, &config, &result);
+	if (!config.dry_run && result.total_ns)
+		printf("[INFO] \t Staging %.1f us, window %.1f us, total %.1f us\n",
+			result.staging_ns / 1e3, result.window_ns / 1e3, result.total_ns / 1e3);
+	print_predicted(mem, start);
+
+	return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static int reset_sim(int argc, char *argv[])
+{
+	if (!snvs_sim) {
+		fprintf(stderr, "sim-reset: only with -s\n");
+		return EXIT_FAILURE;
+	}
+
+	unsigned int *mem = map_SNVS();
+	if (!mem)
+		return EXIT_FAILURE;
+
+	snvs_sim_system_reset(mem);
+	printf("[INFO] \t System reset: SNVS_HPLR = 0x%x, SNVS_HPCOMR = 0x%x, SNVS_LPLR = 0x%x\n",
+		read_SNVS_reg(mem, SNVS_HPLR), read_SNVS_reg(mem, SNVS_HPCOMR), read_SNVS_reg(mem, SNVS_LPLR));
+	return EXIT_SUCCESS;
+}
+
+#define MKEY_BENCH_BOARDS		100000
+
+static uint32_t xorshift32(uint32_t *state)
+{
+	uint32_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+#define MKEY_SIM_COMBOS			16	//MKS_EN x ZMK_VAL x MASTER_KEY_SEL
+
+/*
+ * Set every MKS_EN / ZMK_VAL / MASTER_KEY_SEL combination through the simulator's registers and
+ * check the model's key for it against the key inputs the simulator holds, selected by the
+ * reference manual table. Returns the number of combinations that differ, or -1.
+ */
+static int mkey_sim_check(uint32_t *seed)
+{
+	uint8_t otpmk[MASTER_KEY_BYTES], zmk[MASTER_KEY_BYTES], model[MASTER_KEY_BYTES], expected[MASTER_KEY_BYTES];
+	uint32_t words[SNVS_LPZMKR_COUNT];
+	unsigned int combo, i;
+	int bad = 0;
+
+	unsigned int *mem = map_SNVS();
+	if (!mem)
+		return -1;
+
+	for (combo = 0; combo < MKEY_SIM_COMBOS; combo++) {
+		uint32_t sel = combo & MASTER_KEY_SEL_MASK;
+		uint32_t zmk_val = combo & 0x4 ? ZMK_VAL_MASK : 0;
+		int mks_en = !!(combo & 0x8);
+
+		snvs_sim_power_on_reset(mem);
+		for (i = 0; i < SNVS_LPZMKR_COUNT; i++) {
+			words[i] = xorshift32(seed);
+			write_SNVS_reg(mem, SNVS_LPZMKRn + 4 * i, words[i]);
+		}
+		write_SNVS_reg(mem, SNVS_LPMKCR, zmk_val | sel);
+		if (mks_en)
+			modify_SNVS_reg(mem, SNVS_HPCOMR, 0, MKS_EN_MASK);
+
+		uint32_t lpmkcr = read_SNVS_reg(mem, SNVS_LPMKCR), hpcomr = read_SNVS_reg(mem, SNVS_HPCOMR);
+		snvs_sim_keys(mem, otpmk, zmk);
+		if ((lpmkcr & (ZMK_VAL_MASK | MASTER_KEY_SEL_MASK)) != (zmk_val | sel) || !!(hpcomr & MKS_EN_MASK) != mks_en ||
+		    memcmp(zmk, words, MASTER_KEY_BYTES)) {
+			printf("[ERROR] \t MKS_EN=%d ZMK_VAL=%d MASTER_KEY_SEL=%u: the simulator did not take the setting\n",
+				mks_en, !!zmk_val, sel);
+			bad++;
+			continue;
+		}
+
+		int valid = !mks_en || sel < 2 || zmk_val;
+		for (i = 0; i < MASTER_KEY_BYTES; i++) {
+			if (!mks_en || sel < 2)
+				expected[i] = otpmk[i];
+			else if (sel == 2)
+				expected[i] = zmk[i];
+			else
+				expected[i] = otpmk[i] ^ zmk[i];
+		}
+
+		int ret = snvs_mkey_effective(lpmkcr, hpcomr, otpmk, zmk, model);
+		if (ret != (valid ? 0 : -1) || (valid && memcmp(model, expected, MASTER_KEY_BYTES))) {
+			printf("[ERROR] \t MKS_EN=%d ZMK_VAL=%d MASTER_KEY_SEL=%u: model says %s\n", mks_en, !!zmk_val, sel,
+				snvs_mkey_source_name(snvs_mkey_select(lpmkcr, hpcomr)));
+			bad++;
+		}
+	}
+	snvs_sim_power_on_reset(mem);
+
+	return bad;
+}
+
+static int bench_mkey(int argc, char *argv[])
+{
+	long i, n = argc > 0 ? atol(argv[0]) : MKEY_BENCH_BOARDS;
+	struct snvs_mkey_board *boards;
+	uint8_t *scalar, *bulk;
+	struct timespec t0, t1;
+	uint32_t seed = 0x2017;
+	long invalid = 0;
+	unsigned int j;
+
+	if (n <= 0)
+		n = MKEY_BENCH_BOARDS;
+
+	boards = malloc(n * sizeof(*boards));
+	scalar = calloc(n, MASTER_KEY_BYTES);
+	bulk = malloc(n * MASTER_KEY_BYTES);
+	if (!boards || !scalar || !bulk)
+		return EXIT_FAILURE;
+
+	for (i = 0; i < n; i++) {
+		uint32_t r = xorshift32(&seed);
+		boards[i].lpmkcr = (r & MASTER_KEY_SEL_MASK) | (r & ZMK_VAL_MASK);
+		boards[i].hpcomr = r & MKS_EN_MASK;
+		for (j = 0; j < MASTER_KEY_BYTES; j++) {
+			boards[i].otpmk[j] = xorshift32(&seed);
+			boards[i].zmk[j] = xorshift32(&seed);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < n; i++)
+		invalid += !!snvs_mkey_effective(boards[i].lpmkcr, boards[i].hpcomr, boards[i].otpmk, boards[i].zmk,
+			scalar + i * MASTER_KEY_BYTES);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	double s_scalar = elapsed_ns(&t0, &t1) / 1e9;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	long invalid_bulk = snvs_mkey_effective_bulk(boards, n, bulk);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	double s_bulk = elapsed_ns(&t0, &t1) / 1e9;
+
+	int match = invalid == invalid_bulk && !memcmp(scalar, bulk, n * MASTER_KEY_BYTES);
+	double gb = (double)n * sizeof(*boards) / 1e9;
+
+	printf("[INFO] \t %ld boards, %ld with an invalid selection\n", n, invalid);
+	printf("[INFO] \t per board : %10.0f boards/s, %6.2f GB/s\n", n / s_scalar, gb / s_scalar);
+	printf("[INFO] \t bulk      : %10.0f boards/s, %6.2f GB/s\n", n / s_bulk, gb / s_bulk);
+	printf("%s \t bulk and per board keys %s\n", match ? "[SUCCESS]" : "[ERROR]", match ? "match" : "differ");
+
+	//The model against the simulator's key inputs, for every selection a board can be in
+	if (snvs_sim && !snvs_backend) {
+		int bad = mkey_sim_check(&seed);
+
+		if (bad)
+			match = 0;
+		else
+			printf("[SUCCESS] \t model matches the simulator for all %d MKS_EN/ZMK_VAL/MASTER_KEY_SEL settings\n",
+				MKEY_SIM_COMBOS);
+	} else {
+		printf("[INFO] \t run with -s to check the model against the simulator\n");
+	}
+
+	free(boards);
+	free(scalar);
+	free(bulk);
+
+	return match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int blob_selftest(int argc, char *argv[])
+{
+	if (test_blob_selftest()) {
+		printf("[ERROR] \t Test blob engine self test failed.\n");
+		return EXIT_FAILURE;
+	}
+	printf("[SUCCESS] \t Test blob engine self test passed (AES-CCM known answer, round trip, tamper and key modifier checks).\n");
+	printf("[INFO] \t Test blobs are not CAAM blobs: they do not open on a board.\n");
+
+	return EXIT_SUCCESS;
+}
+
+#define BLOB_BENCH_COUNT		100000
+#define BLOB_BENCH_SIZE			64
+
+static int bench_blob(int argc, char *argv[])
+{
+	long i, n = argc > 0 ? atol(argv[0]) : BLOB_BENCH_COUNT;
+	long size = argc > 1 ? atol(argv[1]) : BLOB_BENCH_SIZE;
+	long threads = argc > 2 ? atol(argv[2]) : sysconf(_SC_NPROCESSORS_ONLN);
+	uint8_t master_key[MASTER_KEY_BYTES] = { 0 }, modifier[BLOB_KEY_MODIFIER_BYTES] = { 0 };
+	struct test_blob_job *jobs;
+	uint8_t *payload, *blobs, *back;
+	struct timespec t0, t1;
+
+	if (n <= 0)
+		n = BLOB_BENCH_COUNT;
+	if (size <= 0 || size > BLOB_MAX_PAYLOAD)
+		size = BLOB_BENCH_SIZE;
+	if (threads <= 0)
+		threads = 1;
+
+	jobs = malloc(n * sizeof(*jobs));
+	payload = malloc(n * size);
+	blobs = malloc(n * (size + BLOB_OVERHEAD));
+	back = malloc(n * size);
+	if (!jobs || !payload || !blobs || !back)
+		return EXIT_FAILURE;
+	for (i = 0; i < n * size; i++)
+		payload[i] = i;
+
+	for (i = 0; i < n; i++) {
+		jobs[i].in = payload + i * size;
+		jobs[i].len = size;
+		jobs[i].out = blobs + i * (size + BLOB_OVERHEAD);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	size_t failed = test_blob_run(master_key, modifier, jobs, n, 0, threads);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	double s_encap = elapsed_ns(&t0, &t1) / 1e9;
+
+	for (i = 0; i < n; i++) {
+		jobs[i].in = blobs + i * (size + BLOB_OVERHEAD);
+		jobs[i].len = size + BLOB_OVERHEAD;
+		jobs[i].out = back + i * size;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	failed += test_blob_run(master_key, modifier, jobs, n, 1, threads);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	double s_decap = elapsed_ns(&t0, &t1) / 1e9;
+
+	int match = !failed && !memcmp(payload, back, n * size);
+
+	printf("[INFO] \t %ld test blobs (not CAAM format) of %ld bytes on %ld threads\n", n, size, threads);
+	printf("[INFO] \t encap: %10.0f blobs/s, %6.3f GB/s\n", n / s_encap, n * size / s_encap / 1e9);
+	printf("[INFO] \t decap: %10.0f blobs/s, %6.3f GB/s\n", n / s_decap, n * size / s_decap / 1e9);
+	printf("%s \t %zu failed, payloads %s\n", match ? "[SUCCESS]" : "[ERROR]", failed, match ? "match" : "differ");
+
+	free(jobs);
+	free(payload);
+	free(blobs);
+	free(back);
+
+	return match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//Example job: 32-byte key at 0x10000000 encapsulated to 0x10001000 with key modifier "ZMK example km\0\0"
+#define DESC_EXAMPLE_IN			0x10000000
+#define DESC_EXAMPLE_OUT		0x10001000
+#define DESC_EXAMPLE_LEN		32
+
+static const uint8_t desc_example_modifier[CAAM_KEY_MODIFIER_BYTES] = "ZMK example km";
+
+static const uint32_t desc_example_golden[CAAM_BLOB_DESC_WORDS] = {
+	0xB080000B, 0x14C00010, 0x204b4d5a, 0x6d617865, 0x20656c70, 0x00006d6b,
+	0xF0000020, 0x10000000, 0xF8000050, 0x10001000, 0x870D0000,
+};
+
+//Same descriptor, built by the compiler
+static const uint32_t desc_example_const[] = CAAM_BLOB_DESC(CAAM_BLOB_ENCAP,
+	0x204b4d5a, 0x6d617865, 0x20656c70, 0x00006d6b, DESC_EXAMPLE_IN, DESC_EXAMPLE_LEN, DESC_EXAMPLE_OUT);
+
+static int show_desc(int argc, char *argv[])
+{
+	enum caam_blob_op op = argc > 0 && !strcmp(argv[0], "decap") ? CAAM_BLOB_DECAP : CAAM_BLOB_ENCAP;
+	uint32_t in_len = op == CAAM_BLOB_ENCAP ? DESC_EXAMPLE_LEN : DESC_EXAMPLE_LEN + CAAM_BLOB_OVERHEAD;
+	uint32_t desc[CAAM_BLOB_DESC_MAX_WORDS];
+	unsigned int i, n;
+
+	n = caam_blob_desc(desc, CAAM_BLOB_DESC_MAX_WORDS, op, desc_example_modifier, DESC_EXAMPLE_IN, in_len, DESC_EXAMPLE_OUT);
+	printf("[INFO] \t Blob %s job descriptor, %u words:\n", op == CAAM_BLOB_ENCAP ? "encap" : "decap", n);
+	for (i = 0; i < n; i++)
+		printf("[INFO] \t\t [%2u] 0x%08x\n", i, desc[i]);
+
+	return n ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#define DESC_BENCH_COUNT		10000000
+
+static int bench_desc(int argc, char *argv[])
+{
+	long i, n = argc > 0 ? atol(argv[0]) : DESC_BENCH_COUNT;
+	uint32_t desc[CAAM_BLOB_DESC_MAX_WORDS], sink = 0;
+	struct timespec t0, t1;
+
+	if (n <= 0)
+		n = DESC_BENCH_COUNT;
+
+	int golden = !memcmp(desc_example_const, desc_example_golden, sizeof(desc_example_golden)) &&
+		caam_blob_desc(desc, CAAM_BLOB_DESC_MAX_WORDS, CAAM_BLOB_ENCAP, desc_example_modifier,
+			DESC_EXAMPLE_IN, DESC_EXAMPLE_LEN, DESC_EXAMPLE_OUT) == CAAM_BLOB_DESC_WORDS &&
+		!memcmp(desc, desc_example_golden, sizeof(desc_example_golden));
+	printf("%s \t Run time and build time descriptors %s the golden descriptor\n",
+		golden ? "[SUCCESS]" : "[ERROR]", golden ? "match" : "do not match");
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < n; i++) {
+		caam_blob_desc(desc, CAAM_BLOB_DESC_MAX_WORDS, i & 1 ? CAAM_BLOB_DECAP : CAAM_BLOB_ENCAP, desc_example_modifier,
+			DESC_EXAMPLE_IN + i, DESC_EXAMPLE_LEN + CAAM_BLOB_OVERHEAD, DESC_EXAMPLE_OUT + i);
+		__asm__ volatile("" : : "r"(desc) : "memory");
+		sink += desc[8];
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	double s = elapsed_ns(&t0, &t1) / 1e9;
+	printf("[INFO] \t %ld descriptors in %.3f s: %.0f descriptors/s (%.1f ns each, checksum 0x%x)\n",
+		n, s, n / s, s * 1e9 / n, sink);
+
+	return golden ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#define JR_BENCH_COUNT			20000
+#define JR_BENCH_SIZE			64
+#define JR_BENCH_LATENCY_NS		2000
+#define JR_BENCH_JITTER_NS		1000
+
+static int run_jr(struct caam_jr_config *config, struct test_blob_job *jobs, size_t n)
+{
+	uint8_t master_key[MASTER_KEY_BYTES] = { 0 }, modifier[BLOB_KEY_MODIFIER_BYTES] = { 0 };
+	struct caam_jr_stats stats;
+
+	if (caam_jr_sim_run(config, master_key, modifier, jobs, n, CAAM_BLOB_ENCAP, &stats)) {
+		printf("[ERROR] \t Job ring run with depth %u, batch %u failed.\n", config->depth, config->batch);
+		return -1;
+	}
+
+	printf("[INFO] \t %5u %5u %-4s %10.0f %8.1f %8.1f %8.1f %9.1f %8zu %8zu %zu\n",
+		config->depth, config->batch, config->interrupt ? "irq" : "poll", stats.jobs / stats.seconds,
+		stats.p50_ns / 1e3, stats.p99_ns / 1e3, stats.p999_ns / 1e3, stats.max_ns / 1e3,
+		stats.doorbells, stats.interrupts, stats.failed);
+
+	return stats.failed ? -1 : 0;
+}
+
+static int bench_jr(int argc, char *argv[])
+{
+	static const unsigned int depths[] = { 16, 64 }, batches[] = { 1, 4, 16 };
+	long i, n = argc > 0 ? atol(argv[0]) : JR_BENCH_COUNT;
+	struct caam_jr_config config = {
+		.latency_ns = argc > 3 ? atoi(argv[3]) : JR_BENCH_LATENCY_NS,
+		.jitter_ns = argc > 4 ? atoi(argv[4]) : JR_BENCH_JITTER_NS,
+	};
+	struct test_blob_job *jobs;
+	uint8_t *payload, *blobs;
+	unsigned int d, b;
+	int irq, ret = 0;
+
+	if (n <= 0)
+		n = JR_BENCH_COUNT;
+	jobs = malloc(n * sizeof(*jobs));
+	payload = calloc(n, JR_BENCH_SIZE);
+	blobs = malloc(n * (JR_BENCH_SIZE + BLOB_OVERHEAD));
+	if (!jobs || !payload || !blobs)
+		return EXIT_FAILURE;
+	for (i = 0; i < n; i++) {
+		jobs[i].in = payload + i * JR_BENCH_SIZE;
+		jobs[i].len = JR_BENCH_SIZE;
+		jobs[i].out = blobs + i * (JR_BENCH_SIZE + BLOB_OVERHEAD);
+	}
+
+	printf("[INFO] \t %ld test blob encap jobs of %d bytes, completion latency %u ns + up to %u ns jitter\n",
+		n, JR_BENCH_SIZE, config.latency_ns, config.jitter_ns);
+	printf("[INFO] \t depth batch mode     jobs/s  p50(us)  p99(us) p999(us)   max(us) doorbell      irq failed\n");
+
+	if (argc > 2) {
+		//One configuration: N DEPTH BATCH [LATENCY_NS] [JITTER_NS] [poll|irq]
+		config.depth = atoi(argv[1]);
+		config.batch = atoi(argv[2]);
+		config.interrupt = argc > 5 && !strcmp(argv[5], "irq");
+		ret = run_jr(&config, jobs, n);
+	} else {
+		for (d = 0; d < ARRAY_SIZE(depths); d++)
+			for (b = 0; b < ARRAY_SIZE(batches); b++)
+				for (irq = 0; irq < 2; irq++) {
+					config.depth = depths[d];
+					config.batch = batches[b];
+					config.interrupt = irq;
+					ret |= run_jr(&config, jobs, n);
+				}
+	}
+
+	free(jobs);
+	free(payload);
+	free(blobs);
+
+	return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*
+ * Current master key selection of the board; the effective key itself is only known to the
+ * simulator, on hardware key stays untouched and 0 is returned in *known.
+ */
+static enum snvs_mkey_source current_master_key(void *mem, uint8_t *key, int *known)
+{
+	uint8_t otpmk[MASTER_KEY_BYTES], zmk[MASTER_KEY_BYTES];
+	uint32_t lpmkcr = read_SNVS_reg(mem, SNVS_LPMKCR);
+	uint32_t hpcomr = read_SNVS_reg(mem, SNVS_HPCOMR);
+
+	*known = 0;
+	if (snvs_sim) {
+		snvs_sim_keys(mem, otpmk, zmk);
+		*known = !snvs_mkey_effective(lpmkcr, hpcomr, otpmk, zmk, key);
+	}
+
+	return snvs_mkey_select(lpmkcr, hpcomr);
+}
+
+#define BLOB_GEN_SIZE			64
+#define BLOB_GEN_MODIFIERS		4
+#define BLOB_SCAN_QUEUE_DEPTH		64
+#define BLOB_SCAN_MAX_FILE		(64 * 1024)
+
+static int generate_blobs(int argc, char *argv[])
+{
+	uint8_t key[MASTER_KEY_BYTES], modifier[BLOB_KEY_MODIFIER_BYTES] = { 0 };
+	char path[4096];
+	int known;
+	long i;
+
+	if (argc < 2) {
+		printf("[ERROR] \t usage: blob-gen DIR N [SIZE]\n");
+		return EXIT_FAILURE;
+	}
+	long n = atol(argv[1]), size = argc > 2 ? atol(argv[2]) : BLOB_GEN_SIZE;
+	if (size <= 0 || BLOB_FILE_SIZE(size) > BLOB_SCAN_MAX_FILE)
+		size = BLOB_GEN_SIZE;
+
+	unsigned int *mem = map_SNVS();
+	if (!mem)
+		return EXIT_FAILURE;
+	enum snvs_mkey_source source = current_master_key(mem, key, &known);
+	if (!known) {
+		printf("[ERROR] \t The effective master key is only known to the simulator, run with -s.\n");
+		return EXIT_FAILURE;
+	}
+
+	uint8_t *payload = malloc(size);
+	if (!payload)
+		return EXIT_FAILURE;
+	for (i = 0; i < n; i++) {
+		memset(payload, i, size);
+		modifier[0] = i % BLOB_GEN_MODIFIERS;
+		snprintf(path, sizeof(path), "%s/blob%08ld.bin", argv[0], i);
+		if (blob_file_write(path, source, key, modifier, payload, size)) {
+			perror(path);
+			free(payload);
+			return EXIT_FAILURE;
+		}
+	}
+	free(payload);
+
+	printf("[SUCCESS] \t %ld test blobs (not CAAM format) of %ld bytes written to %s under %s\n", n, size, argv[0], snvs_mkey_source_name(source));
+	return EXIT_SUCCESS;
+}
+
+static void report_blob(const char *path, const char *reason)
+{
+	printf("[ERROR] \t\t %s: %s\n", path, reason);
+}
+
+/* Collects the regular files of dir; returns their number or -1 */
+static long list_dir(const char *dir, char ***paths)
+{
+	struct dirent *de;
+	long n = 0, max = 0;
+	char **list = NULL;
+
+	DIR *d = opendir(dir);
+	if (!d)
+		return -1;
+	while ((de = readdir(d))) {
+		if (de->d_name[0] == '.')
+			continue;
+		if (n == max) {
+			max = max ? 2 * max : 1024;
+			char **grown = realloc(list, max * sizeof(*list));
+			if (!grown)
+				break;
+			list = grown;
+		}
+		list[n] = malloc(strlen(dir) + strlen(de->d_name) + 2);
+		if (!list[n])
+			break;
+		sprintf(list[n++], "%s/%s", dir, de->d_name);
+	}
+	closedir(d);
+
+	*paths = list;
+	return n;
+}
+
+static int scan_blobs(int argc, char *argv[])
+{
+	uint8_t key[MASTER_KEY_BYTES];
+	struct blob_scan_stats stats;
+	char **paths;
+	int known;
+	long i;
+
+	if (argc < 1) {
+		printf("[ERROR] \t usage: blob-scan DIR [QUEUE_DEPTH]\n");
+		return EXIT_FAILURE;
+	}
+
+	unsigned int *mem = map_SNVS();
+	if (!mem)
+		return EXIT_FAILURE;
+
+	struct blob_scan_config config = {
+		.queue_depth = argc > 1 && atoi(argv[1]) > 0 ? atoi(argv[1]) : BLOB_SCAN_QUEUE_DEPTH,
+		.max_file = BLOB_SCAN_MAX_FILE,
+		.report = report_blob,
+	};
+	config.source = current_master_key(mem, key, &known);
+	config.master_key = known ? key : NULL;
+
+	long n = list_dir(argv[0], &paths);
+	if (n < 0) {
+		perror(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	printf("[INFO] \t Scanning %ld files, current master key %s%s\n", n, snvs_mkey_source_name(config.source),
+		known ? "" : " (key value unknown, header check only)");
+	int ret = blob_store_scan(&config, paths, n, &stats);
+
+	printf("[INFO] \t %zu files, %zu bytes in %.3f s via %s: %.0f files/s, %.1f MB/s\n", stats.files, stats.bytes,
+		stats.seconds, stats.io_uring ? "io_uring" : "pread", stats.files / stats.seconds, stats.bytes / stats.seconds / 1e6);
+	printf("%s \t %zu decapsulated, %zu under another master key, %zu corrupt\n",
+		!ret && !stats.mismatched && !stats.corrupt ? "[SUCCESS]" : "[ERROR]",
+		stats.decapsulated, stats.mismatched, stats.corrupt);
+
+	for (i = 0; i < n; i++)
+		free(paths[i]);
+	free(paths);
+
+	return !ret && !stats.mismatched && !stats.corrupt ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int migrate_blobs(int argc, char *argv[])
+{
+	uint8_t otpmk[MASTER_KEY_BYTES], zmk[MASTER_KEY_BYTES], old_key[MASTER_KEY_BYTES], new_key[MASTER_KEY_BYTES];
+	struct blob_migrate_stats stats;
+	char **paths;
+	int known;
+	long i;
+
+	if (argc < 3 || (strcmp(argv[2], "otpmk") && strcmp(argv[2], "zmk") && strcmp(argv[2], "xor"))) {
+		printf("[ERROR] \t usage: blob-migrate DIR JOURNAL otpmk|zmk|xor [THREADS]\n");
+		return EXIT_FAILURE;
+	}
+
+	unsigned int *mem = map_SNVS();
+	if (!mem)
+		return EXIT_FAILURE;
+	enum snvs_mkey_source source = current_master_key(mem, new_key, &known);
+	if (!known) {
+		printf("[ERROR] \t The effective master keys are only known to the simulator, run with -s.\n");
+		return EXIT_FAILURE;
+	}
+
+	//Old effective key: the same key inputs under the previous MASTER_KEY_SEL
+	snvs_sim_keys(mem, otpmk, zmk);
+	for (i = 0; i < MASTER_KEY_BYTES; i++)
+		old_key[i] = !strcmp(argv[2], "otpmk") ? otpmk[i] : !strcmp(argv[2], "zmk") ? zmk[i] : otpmk[i] ^ zmk[i];
+
+	struct blob_migrate_config config = {
+		.old_key = old_key,
+		.new_key = new_key,
+		.new_source = source,
+		.threads = argc > 3 && atoi(argv[3]) > 0 ? atoi(argv[3]) : sysconf(_SC_NPROCESSORS_ONLN),
+		.max_file = BLOB_SCAN_MAX_FILE,
+		.journal = argv[1],
+		.report = report_blob,
+	};
+
+	long n = list_dir(argv[0], &paths);
+	if (n < 0) {
+		perror(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	printf("[INFO] \t Re-wrapping %ld test blob files from %s to %s on %u threads\n", n, argv[2],
+		snvs_mkey_source_name(source), config.threads);
+	int ret = blob_migrate(&config, paths, n, &stats);
+
+	printf("[INFO] \t %zu re-wrapped, %zu already under the new key, %zu skipped from the journal, %zu failed\n",
+		stats.migrated, stats.already, stats.resumed, stats.failed);
+	printf("%s \t %.3f s: %.0f blobs/s, %.1f MB/s\n", ret ? "[ERROR]" : "[SUCCESS]", stats.seconds,
+		stats.migrated / stats.seconds, stats.bytes / stats.seconds / 1e6);
+
+	for (i = 0; i < n; i++)
+		free(paths[i]);
+	free(paths);
+
+	return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static uint64_t xorshift64(uint64_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+static int generate_archive(int argc, char *argv[])
+{
+	struct snvs_archive ar;
+	uint64_t i, n = argc > 1 ? strtoull(argv[1], NULL, 0) : 0;
+	uint64_t seed = argc > 2 ? strtoull(argv[2], NULL, 0) : 1;
+
+	if (argc < 2 || !n) {
+		printf("[ERROR] \t usage: archive-gen ARCHIVE N [SEED]\n");
+		return EXIT_FAILURE;
+	}
+	if (snvs_archive_create(argv[0], n, &ar)) {
+		perror(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	//A synthetic fleet: mostly hard locked boards, some soft locked, blank ones and a few lock slips
+	seed |= 1;
+	for (i = 0; i < n; i++) {
+		uint64_t r = xorshift64(&seed);
+		unsigned int kind = r % 1000;
+		uint32_t hplr = 0, lplr = ZMK_WHL_MASK | ZMK_RHL_MASK | MKS_HL_MASK;
+		uint32_t hpcomr = snvs_reg_lookup(SNVS_HPCOMR)->reset | MKS_EN_MASK;
+		uint32_t lpmkcr = ZMK_VAL_MASK | ZMK_ECC_EN | MASTER_KEY_SEL_VALUE;
+
+		if (kind < 50) {
+			hpcomr &= ~MKS_EN_MASK;
+			lplr = lpmkcr = 0;
+		} else if (kind < 150) {
+			hplr = ZMK_WSL_MASK | ZMK_RSL_MASK | MKS_SL_MASK;
+			lplr = 0;
+		} else if (kind < 152) {
+			lplr &= ~ZMK_RHL_MASK;
+		} else if (kind == 152) {
+			lplr &= ~MKS_HL_MASK;
+		}
+		ar.uid[i] = xorshift64(&seed);
+		ar.column[ARCHIVE_HPLR][i] = hplr;
+		ar.column[ARCHIVE_HPCOMR][i] = hpcomr;
+		ar.column[ARCHIVE_LPLR][i] = lplr;
+		ar.column[ARCHIVE_LPMKCR][i] = lpmkcr;
+	}
+	snvs_archive_close(&ar);
+	printf("[SUCCESS] \t %llu snapshots written to %s\n", (unsigned long long)n, argv[0]);
+
+	return EXIT_SUCCESS;
+}
+
+static int show_archive_row(int argc, char *argv[])
+{
+	if (!map_SNVS())
+		return EXIT_FAILURE;
+
+	const struct snvs_identity *id = snvs_identity(snvs);
+
+	printf("%016llx %08x %08x %08x %08x\n", (unsigned long long)id->uid, id->hplr, snvs_read(snvs, SNVS_HPCOMR), id->lplr,
+		id->lpmkcr);
+	return EXIT_SUCCESS;
+}
+
+static int build_archive(int argc, char *argv[])
+{
+	struct snvs_archive ar;
+	unsigned long long uid;
+	unsigned int hplr, hpcomr, lplr, lpmkcr;
+	size_t n = 0, size = 0, line = 0;
+	char text[256];
+	struct {
+		uint64_t uid;
+		uint32_t reg[ARCHIVE_COLUMNS];
+	} *rows = NULL;
+
+	if (argc < 2) {
+		printf("[ERROR] \t usage: archive-build TEXT ARCHIVE (- for stdin)\n");
+		return EXIT_FAILURE;
+	}
+
+	FILE *f = strcmp(argv[0], "-") ? fopen(argv[0], "r") : stdin;
+	if (!f) {
+		perror(argv[0]);
+		return EXIT_FAILURE;
+	}
+	while (fgets(text, sizeof(text), f)) {
+		line++;
+		if (text[0] == '#' || text[0] == '\n')
+			continue;
+		if (sscanf(text, "%llx %x %x %x %x", &uid, &hplr, &hpcomr, &lplr, &lpmkcr) != 5) {
+			printf("[ERROR] \t %s:%zu: expected UID HPLR HPCOMR LPLR LPMKCR\n", argv[0], line);
+			continue;
+		}
+		if (n == size) {
+			void *p = realloc(rows, (size = size ? 2 * size : 1024) * sizeof(*rows));
+			if (!p)
+				break;
+			rows = p;
+		}
+		rows[n].uid = uid;
+		rows[n].reg[ARCHIVE_HPLR] = hplr;
+		rows[n].reg[ARCHIVE_HPCOMR] = hpcomr;
+		rows[n].reg[ARCHIVE_LPLR] = lplr;
+		rows[n++].reg[ARCHIVE_LPMKCR] = lpmkcr;
+	}
+	if (f != stdin)
+		fclose(f);
+
+	if (snvs_archive_create(argv[1], n, &ar)) {
+		perror(argv[1]);
+		free(rows);
+		return EXIT_FAILURE;
+	}
+	for (size_t i = 0; i < n; i++) {
+		unsigned int c;
+
+		ar.uid[i] = rows[i].uid;
+		for (c = 0; c < ARCHIVE_COLUMNS; c++)
+			ar.column[c][i] = rows[i].reg[c];
+	}
+	snvs_archive_close(&ar);
+	free(rows);
+	printf("[SUCCESS] \t %zu snapshots written to %s\n", n, argv[1]);
+
+	return EXIT_SUCCESS;
+}
+
+static int query_archive(int argc, char *argv[])
+{
+	struct snvs_archive_query query = { { 0 } };
+	struct snvs_archive ar;
+	struct timespec t0, t1;
+	int count_only = 0, compare = 0, i;
+
+	for (; argc > 0 && argv[0][0] == '-' && argv[0][1]; argc--, argv++) {
+		if (!strcmp(argv[0], "-c"))
+			count_only = 1;
+		else if (!strcmp(argv[0], "-b"))
+			compare = 1;
+		else
+			break;
+	}
+	if (argc < 1) {
+		printf("[ERROR] \t usage: archive-query [-c] [-b] ARCHIVE [!]FIELD[=VALUE]...\n");
+		return EXIT_FAILURE;
+	}
+	for (i = 1; i < argc; i++) {
+		if (snvs_archive_term(&query, argv[i])) {
+			printf("[ERROR] \t %s: not a field of SNVS_HPLR, SNVS_HPCOMR, SNVS_LPLR or SNVS_LPMKCR\n", argv[i]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (snvs_archive_open(argv[0], &ar)) {
+		perror(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	//First pass on a cold mapping faults the pages in; time the second one
+	size_t matches = snvs_archive_select(&ar, &query, NULL, 0);
+	uint64_t *ids = count_only ? NULL : malloc((matches ? matches : 1) * sizeof(*ids));
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	snvs_archive_select(&ar, &query, ids, ids ? matches : 0);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	double ns = elapsed_ns(&t0, &t1);
+	unsigned int c, columns = 0;
+
+	for (c = 0; c < ARCHIVE_COLUMNS; c++)
+		columns += !!query.mask[c];
+
+	if (ids)
+		for (size_t j = 0; j < matches; j++)
+			printf("%016llx\n", (unsigned long long)ids[j]);
+	if (query.empty)
+		printf("[INFO] \t The terms contradict each other, no snapshot can match\n");
+	else
+		printf("[INFO] \t %zu of %llu snapshots match, %.3f ms, %.2f GB/s over %u columns\n", matches,
+			(unsigned long long)ar.count, ns / 1e6, ar.count * 4.0 * columns / ns, columns);
+
+	int ret = EXIT_SUCCESS;
+
+	if (compare) {
+		uint64_t *ref = malloc((matches ? matches : 1) * sizeof(*ref));
+
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		size_t n = snvs_archive_select_scalar(&ar, &query, ref, ref ? matches : 0);
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+
+		if (!ref || n != matches || (ids && memcmp(ref, ids, matches * sizeof(*ids)))) {
+			printf("[ERROR] \t Row by row evaluation disagrees: %zu matches\n", n);
+			ret = EXIT_FAILURE;
+		} else {
+			printf("[SUCCESS] \t Row by row evaluation agrees, %.3f ms (%.1fx)\n", elapsed_ns(&t0, &t1) / 1e6,
+				elapsed_ns(&t0, &t1) / ns);
+		}
+		free(ref);
+	}
+	free(ids);
+	snvs_archive_close(&ar);
+
+	return ret;
+}
+
+static int serve_board(void *ctx, const char *board, char *reason, size_t size)
+{
+	struct snvs_provision_config config = default_config;
+	struct snvs_gpr_record rec;
+	unsigned int *mem = ctx;
+
+	//On the simulator every request is a new board on the fixture
+	if (snvs_sim)
+		snvs_sim_power_on_reset(mem);
+	if (!snvs_provision(snvs, &config))
+		return 0;
+	if (!snvs_gpr_load(mem, &rec))
+		snprintf(reason, size, "stopped after %s", snvs_step_name(rec.step));
+	return -1;
+}
+
+static int serve(int argc, char *argv[])
+{
+	struct snvs_daemon_stats stats;
+
+	if (argc < 2) {
+		printf("[ERROR] \t usage: serve SOCKET JOURNAL\n");
+		return EXIT_FAILURE;
+	}
+
+	//Map before looking for a running daemon so that a hot restart does not wait for it
+	unsigned int *mem = map_SNVS();
+	if (!mem)
+		return EXIT_FAILURE;
+
+	struct snvs_daemon_config config = {
+		.socket_path = argv[0],
+		.journal = argv[1],
+		.provision = serve_board,
+		.ctx = mem,
+		.log = stdout,
+	};
+
+	int ret = snvs_daemon_run(&config, &stats);
+
+	printf("[INFO] \t %llu boards provisioned, %llu failed\n", stats.boards, stats.failed);
+	return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static uint64_t monotonic_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int submit_boards(int argc, char *argv[])
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	unsigned int n = argc > 1 ? strtoul(argv[1], NULL, 0) : 1;
+	unsigned int interval_ms = argc > 2 ? strtoul(argv[2], NULL, 0) : 0;
+	unsigned int window = argc > 3 ? strtoul(argv[3], NULL, 0) : 8;
+	unsigned int next = 0, replied = 0, ok = 0, failed = 0;
+	double max_ms = 0, sum_ms = 0;
+	char buf[4 * SNVS_DAEMON_LINE];
+	size_t len = 0;
+
+	if (argc < 1 || !n || !window || strlen(argv[0]) >= sizeof(addr.sun_path)) {
+		printf("[ERROR] \t usage: submit SOCKET [N [INTERVAL_MS [WINDOW]]]\n");
+		return EXIT_FAILURE;
+	}
+	strcpy(addr.sun_path, argv[0]);
+
+	uint64_t *sent = calloc(n, sizeof(*sent));
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (!sent || fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+		perror(argv[0]);
+		free(sent);
+		if (fd >= 0)
+			close(fd);
+		return EXIT_FAILURE;
+	}
+
+	//Requests go out every INTERVAL_MS with at most WINDOW unanswered; replies come back in order
+	uint64_t due = monotonic_ns();
+
+	while (replied < n) {
+		uint64_t now = monotonic_ns();
+		int timeout = -1;
+
+		if (next < n && next - replied < window) {
+			if (now >= due) {
+				char line[SNVS_DAEMON_LINE];
+				int l = snprintf(line, sizeof(line), "provision board-%d-%u\n", (int)getpid(), next);
+
+				if (send(fd, line, l, MSG_NOSIGNAL) != l)
+					break;
+				sent[next++] = now;
+				due += interval_ms * 1000000ULL;
+				continue;
+			}
+			timeout = (due - now + 999999) / 1000000;
+		}
+
+		struct pollfd pfd = { .fd = fd, .events = POLLIN };
+
+		if (poll(&pfd, 1, timeout) < 0)
+			break;
+		if (!(pfd.revents & (POLLIN | POLLHUP)))
+			continue;
+
+		ssize_t r = read(fd, buf + len, sizeof(buf) - len);
+		if (r <= 0)
+			break;
+		len += r;
+
+		char *start = buf, *nl;
+		while ((nl = memchr(start, '\n', buf + len - start)) && replied < next) {
+			double ms = (monotonic_ns() - sent[replied++]) / 1e6;
+
+			*nl = '\0';
+			if (!strncmp(start, "OK ", 3)) {
+				ok++;
+			} else {
+				failed++;
+				printf("[ERROR] \t %s\n", start);
+			}
+			sum_ms += ms;
+			if (ms > max_ms)
+				max_ms = ms;
+			start = nl + 1;
+		}
+		len -= start - buf;
+		memmove(buf, start, len);
+	}
+	close(fd);
+	free(sent);
+
+	unsigned int lost = n - ok - failed;
+
+	printf("%s \t %u boards: %u OK, %u failed, %u without a reply\n", failed || lost ? "[ERROR]" : "[SUCCESS]", n, ok,
+		failed, lost);
+	if (replied)
+		printf("[INFO] \t reply latency %.3f ms average, %.3f ms max\n", sum_ms / replied, max_ms);
+
+	return failed || lost ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static int run_script(int argc, char *argv[])
+{
+	struct snvs_script script;
+	struct timespec t0, t1;
+	unsigned int i;
+
+	if (argc < 1) {
+		printf("[ERROR] \t usage: run SCRIPT (- for stdin)\n");
+		return EXIT_FAILURE;
+	}
+
+	FILE *f = strcmp(argv[0], "-") ? fopen(argv[0], "r") : stdin;
+	if (!f) {
+		perror(argv[0]);
+		return EXIT_FAILURE;
+	}
+	int ret = snvs_script_parse(f, argv[0], &script);
+	if (f != stdin)
+		fclose(f);
+	if (ret)
+		return EXIT_FAILURE;
+
+	struct snvs_op_result *results = calloc(script.count ? script.count : 1, sizeof(*results));
+	if (!results || !map_SNVS()) {
+		free(results);
+		snvs_script_free(&script);
+		return EXIT_FAILURE;
+	}
+
+	uint64_t start = snvs_sim_timed() ? snvs_sim_clock(snvs_base(snvs)) : 0;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	unsigned int failed = snvs_script_run(snvs, &script, results);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	for (i = 0; i < script.count; i++) {
+		const struct snvs_op *op = &script.ops[i];
+		const struct snvs_op_result *r = &results[i];
+
+		char detail[32] = "";
+
+		if (op->code != SNVS_OP_READ)
+			snprintf(detail, sizeof(detail), "(%s 0x%x)", op->code == SNVS_OP_SET ? "wrote" : "want", op->value);
+		printf("%s \t %4u: %-6s %-28s = 0x%-8x %-18s %10.1f ns\n", r->failed ? "[ERROR]" : "[INFO]", op->line,
+			snvs_op_name(op->code), op->name, r->value, detail, r->ns);
+	}
+	printf("%s \t %u operations, %u failed, %.1f us in one mapping\n", failed ? "[ERROR]" : "[SUCCESS]",
+		script.count, failed, elapsed_ns(&t0, &t1) / 1e3);
+	print_predicted(snvs_base(snvs), start);
+
+	free(results);
+	snvs_script_free(&script);
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+struct command {
+	const char *name;
+	int (*run)(int argc, char *argv[]);
+	const char *help;
+};
+
+static const struct command commands[] = {
+	{ "provision",	provision_ZMK,	"run the A/B ZMK programming sequence (default)" },
+	{ "id",		show_id,	"print the SoC unique ID, SNVS version and lock state" },
+	{ "regs",	show_regs,	"dump and decode every SNVS register" },
+	{ "srtc",	show_srtc,	"print the secure real time counter" },
+	{ "srtc-bench",	bench_srtc,	"[N] compare N SRTC reads with clock_gettime" },
+	{ "mmio-bench",	bench_mmio,	"[N [FILE [ZEROIZE_NS]]] time register accesses, write a timing calibration" },
+	{ "mc",		show_mc,	"print the monotonic counter" },
+	{ "mc-inc",	increment_mc,	"increment the monotonic counter once" },
+	{ "mc-bench",	bench_mc,	"[THREADS] [N] [US] coalesced increment throughput, US per simulated increment" },
+	{ "rmw-bench",	bench_rmw,	"[WORKERS [N [procs]]] lost read-modify-write updates, unprotected vs atomic (-s)" },
+	{ "tamper",	show_tamper,	"show security violation / tamper configuration and events" },
+	{ "tamper-apply", apply_tamper,	"apply the default security violation / tamper policy (A.4)" },
+	{ "rotate",	rotate_ZMK,	"[-n] [-l] WORD... replace the ZMK with a minimal master key switch window" },
+	{ "sim-reset",	reset_sim,	"apply a system reset to the simulator (keeps SNVS_LP, needs ZMK_SIM_STATE)" },
+	{ "mkey",	show_mkey,	"show which master key CAAM uses (key values with -s)" },
+	{ "mkey-bench",	bench_mkey,	"[N] bulk effective master key computation for N boards, model vs simulator (-s, resets it)" },
+	{ "blob-selftest", blob_selftest, "self test of the software test blob engine (not CAAM compatible)" },
+	{ "blob-bench",	bench_blob,	"[N] [SIZE] [THREADS] software test blob encap/decap throughput" },
+	{ "desc",	show_desc,	"[encap|decap] dump an example CAAM blob job descriptor" },
+	{ "desc-bench",	bench_desc,	"[N] golden check and descriptor build rate" },
+	{ "jr-bench",	bench_jr,	"[N [DEPTH BATCH [LAT_NS [JITTER_NS [poll|irq]]]]] simulated job ring" },
+	{ "blob-gen",	generate_blobs,	"DIR N [SIZE] write N test blob files (not CAAM blobs) under the current master key (-s)" },
+	{ "blob-scan",	scan_blobs,	"DIR [QUEUE_DEPTH] check every test blob file against the current master key" },
+	{ "blob-migrate", migrate_blobs, "DIR JOURNAL otpmk|zmk|xor [THREADS] re-wrap test blobs to the current master key (-s)" },
+	{ "bc",		show_bc,	"[FILE] compile the provisioning sequence to bytecode, list it, write it to FILE" },
+	{ "bc-run",	run_bc,		"FILE run a provisioning bytecode program" },
+	{ "bc-bench",	bench_bc,	"[N] check bytecode against native provisioning, time it against a native replay (-s)" },
+	{ "async-bench", bench_async,	"[BOARDS [LATENCY_US [page]]] provision boards one by one, then all from one event loop" },
+	{ "archive-gen", generate_archive, "ARCHIVE N [SEED] write a synthetic snapshot archive of N boards" },
+	{ "archive-row", show_archive_row, "print this board's archive line (UID HPLR HPCOMR LPLR LPMKCR)" },
+	{ "archive-build", build_archive, "TEXT ARCHIVE build a snapshot archive from archive-row lines" },
+	{ "archive-query", query_archive, "[-c] [-b] ARCHIVE [!]FIELD[=VALUE]... IDs of the boards matching every term" },
+	{ "serve",	serve,		"SOCKET JOURNAL provisioning daemon, hands over to a newer one started on SOCKET" },
+	{ "submit",	submit_boards,	"SOCKET [N [INTERVAL_MS [WINDOW]]] send N provisioning requests to the daemon" },
+	{ "fault",	inject_faults,	"SPEC... provision with injected faults, check the board and recover it (-s)" },
+	{ "fault-bench", bench_faults,	"[N [SEED [FAULTS]]] N random fault scenarios, outcomes and recovery latency (-s)" },
+	{ "run",	run_script,	"SCRIPT run read/set/poll/expect register operations from SCRIPT (- for stdin)" },
+	{ "gpr",	show_gpr,	"decode the provisioning record in SNVS_LPGPR" },
+};
+
+static void usage(const char *prog)
+{
+	unsigned int i;
+
+	printf("usage: %s [-s | -m | -t] [-a] [-T FILE] [command] [args]\n", prog);
+	printf("\t-s           run against the SNVS simulator instead of /dev/mem\n");
+	printf("\t-m           reach the simulator through a messaging unit controller stand-in (i.MX8)\n");
+	printf("\t-t           reach the simulator through a TEE trusted application stand-in\n");
+	printf("\t-a           atomic read-modify-writes between threads and processes\n");
+	printf("\t-T FILE      write a Chrome trace JSON timeline of the run to FILE\n");
+	for (i = 0; i < ARRAY_SIZE(commands); i++)
+		printf("\t%-12s %s\n", commands[i].name, commands[i].help);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *trace = NULL;
+	unsigned int i;
+	int ret;
+
+	while (argc > 1 && argv[1][0] == '-') {
+		if (!strcmp(argv[1], "-s")) {
+			open_flags |= SNVS_OPEN_SIM;
+		} else if (!strcmp(argv[1], "-m")) {
+			open_flags |= SNVS_OPEN_MU;
+		} else if (!strcmp(argv[1], "-t")) {
+			open_flags |= SNVS_OPEN_TEE;
+		} else if (!strcmp(argv[1], "-a")) {
+			open_flags |= SNVS_OPEN_ATOMIC;
+		} else if (!strcmp(argv[1], "-T") && argc > 2) {
+			trace = argv[2];
+			argv[2] = argv[0];
+			argc--;
+			argv++;
+		} else {
+			break;
+		}
+		argv[1] = argv[0];
+		argc--;
+		argv++;
+	}
+
+	//The simulator behind a backend runs in the stand-in process, not in this one
+	if (open_flags & SNVS_OPEN_TEE)
+		open_flags = SNVS_OPEN_TEE | (open_flags & SNVS_OPEN_ATOMIC);
+	else if (open_flags & SNVS_OPEN_MU)
+		open_flags = SNVS_OPEN_MU | (open_flags & SNVS_OPEN_ATOMIC);
+	snvs_sim = !!(open_flags & SNVS_OPEN_SIM);
+
+	const char *name = argc > 1 ? argv[1] : commands[0].name;
+
+	for (i = 0; i < ARRAY_SIZE(commands); i++)
+		if (!strcmp(name, commands[i].name))
+			break;
+	if (i == ARRAY_SIZE(commands)) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (trace && snvs_trace_start()) {
+		perror("trace");
+		return EXIT_FAILURE;
+	}
+	ret = commands[i].run(argc > 1 ? argc - 2 : 0, argv + (argc > 1 ? 2 : argc));
+	if (snvs_backend) {
+		struct snvs_backend_stats stats;
+
+		//The library only latches a lost backend; the tool treats it as a failed command
+		if (snvs_backend->flush())
+			ret = EXIT_FAILURE;
+		snvs_backend->stats(&stats);
+		printf("[INFO] \t SNVS %s: %llu round trips, %llu messages, %llu register operations", snvs_backend->name,
+			(unsigned long long)stats.round_trips, (unsigned long long)stats.messages, (unsigned long long)stats.ops);
+		if (stats.world_switches)
+			printf(", %llu world switches", (unsigned long long)stats.world_switches);
+		printf("\n");
+	}
+	if (trace) {
+		int n = snvs_trace_save(trace);
+		if (n < 0)
+			perror(trace);
+		else
+			fprintf(stderr, "[INFO] \t %d trace spans written to %s\n", n, trace);
+	}
+
+	return ret;
+}